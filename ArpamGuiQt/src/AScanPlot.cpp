@@ -19,13 +19,57 @@
 #include <span>
 #include <uspam/reconParams.hpp>
 
+namespace {
+
+// Points of (x, y)[first, last) to draw in `buckets` pixel columns. If there
+// are more than two points per column, only the min and max of each column
+// are kept (in their original order), which draws the same envelope.
+void minMaxDecimate(const QVector<AScanPlot::FloatType> &x,
+                    const QVector<AScanPlot::FloatType> &y, qsizetype first,
+                    qsizetype last, int buckets, QVector<QCPGraphData> &out) {
+  out.clear();
+  const auto count = last - first;
+  if (count <= 2 * static_cast<qsizetype>(buckets)) {
+    for (auto i = first; i < last; ++i) {
+      out.append({x[i], y[i]});
+    }
+    return;
+  }
+
+  for (int b = 0; b < buckets; ++b) {
+    const auto i0 = first + count * b / buckets;
+    const auto i1 = first + count * (b + 1) / buckets;
+    auto iMin = i0;
+    auto iMax = i0;
+    for (auto i = i0 + 1; i < i1; ++i) {
+      if (y[i] < y[iMin]) {
+        iMin = i;
+      }
+      if (y[i] > y[iMax]) {
+        iMax = i;
+      }
+    }
+    const auto [a, c] = std::minmax(iMin, iMax);
+    out.append({x[a], y[a]});
+    if (c != a) {
+      out.append({x[c], y[c]});
+    }
+  }
+}
+
+} // namespace
+
 template <typename T>
 FWHM<T> AScanFWHMTracers::updateData(const QVector<T> &x, const QVector<T> &y,
                                      int graphIdx) {
   const auto fwhm = calcFWHM<T>(x, y);
 
-  peakTracer->setGraph(customPlot->graph(graphIdx));
-  peakTracer->setGraphKey(x[fwhm.peakIdx]);
+  // Placed at the full resolution peak, the graph may be decimated
+  peakTracer->setGraph(nullptr);
+  peakTracer->position->setType(QCPItemPosition::ptPlotCoords);
+  peakTracer->position->setAxes(customPlot->graph(graphIdx)->keyAxis(),
+                                customPlot->graph(graphIdx)->valueAxis());
+  peakTracer->position->setCoords(x[fwhm.peakIdx], fwhm.maxY);
 
   lineLower->start->setCoords(fwhm.lowerX, 0);
   lineLower->end->setCoords(fwhm.lowerX, y[fwhm.lowerIdx]);
@@ -103,6 +147,15 @@ AScanPlot::AScanPlot(ReconParamsController *reconParams, QWidget *parent)
 
     customPlot->setMinimumHeight(200); // NOLINT(*-magic-numbers)
 
+    // Zooming in shows more of the full resolution data
+    connect(customPlot->xAxis,
+            QOverload<const QCPRange &>::of(&QCPAxis::rangeChanged), this,
+            [this] {
+              if (!m_settingRange) {
+                updateGraphData();
+              }
+            });
+
     // generate some data
     {
       constexpr int N = 201;
@@ -252,12 +305,49 @@ void AScanPlot::showPointToolTip(QMouseEvent *event) {
 }
 
 void AScanPlot::ensureX(int size) {
-  if (m_x.size() != size) {
-    m_x.resize(size);
-    std::iota(m_x.begin(), m_x.end(), 0);
+  // Sample indices, kept for every length seen (PA, US, envelope, log)
+  auto &x = m_xCache[size];
+  if (x.size() != size) {
+    x.resize(size);
+    std::iota(x.begin(), x.end(), 0);
+  }
+  m_x = x; // Shared, not copied
+}
+
+void AScanPlot::updateGraphData() {
+  if (m_y.isEmpty()) {
+    return;
+  }
+
+  // Visible samples (and one on either side so the line reaches the edges)
+  const auto range = customPlot->xAxis->range();
+  const auto first = std::max<qsizetype>(
+      std::lower_bound(m_x.cbegin(), m_x.cend(), range.lower) -
+          m_x.cbegin() - 1,
+      0);
+  const auto last = std::min<qsizetype>(
+      std::upper_bound(m_x.cbegin(), m_x.cend(), range.upper) -
+          m_x.cbegin() + 1,
+      m_x.size());
+
+  minMaxDecimate(m_x, m_y, first, std::max(first, last),
+                 std::max(1, customPlot->width()), m_graphData);
+
+  // Overwrite the points in place when the count didn't change
+  auto data = customPlot->graph(0)->data();
+  if (data->size() == m_graphData.size()) {
+    std::copy(m_graphData.cbegin(), m_graphData.cend(), data->begin());
+  } else {
+    data->set(m_graphData, true);
   }
 }
 
+void AScanPlot::resizeEvent(QResizeEvent *event) {
+  QWidget::resizeEvent(event);
+  updateGraphData();
+  customPlot->replot(QCustomPlot::rpQueuedReplot);
+}
+
 template <typename T> void AScanPlot::plot(std::span<const T> y) {
   ensureX(y.size());
 
@@ -281,7 +371,15 @@ template <typename T> void AScanPlot::plot(std::span<const T> y) {
 void AScanPlot::plot(const QVector<FloatType> &x, const QVector<FloatType> &y) {
   assert(x.size() == y.size());
 
-  // Compute FWHM
+  // Shared, not copied
+  if (&x != &m_x) {
+    m_x = x;
+  }
+  if (&y != &m_y) {
+    m_y = y;
+  }
+
+  // Compute FWHM at full resolution
   const auto fwhm = m_FWHMtracers.updateData(x, y);
   // FWHM width in X
   const auto width = fwhm.width();
@@ -302,19 +400,22 @@ void AScanPlot::plot(const QVector<FloatType> &x, const QVector<FloatType> &y) {
   customPlot->graph(0)->setName(m_plotMeta.name);
 
   // replot
-  customPlot->graph(0)->setData(x, y, true);
   m_plotMeta.xMin = x.front();
   m_plotMeta.xMax = x.back();
+  m_settingRange = true;
   customPlot->xAxis->setRange(m_plotMeta.xMin, m_plotMeta.xMax);
+  m_settingRange = false;
+  updateGraphData();
 
   if (m_plotMeta.autoScaleY) {
-    const auto [min, max] = std::minmax_element(x.cbegin(), y.cend());
+    const auto [min, max] = std::minmax_element(y.cbegin(), y.cend());
     m_plotMeta.yMin = *min;
     m_plotMeta.yMax = *max;
   }
   customPlot->yAxis->setRange(m_plotMeta.yMin, m_plotMeta.yMax);
 
-  customPlot->replot();
+  // Selection events (e.g. hovering the canvas) are coalesced into one replot
+  customPlot->replot(QCustomPlot::rpQueuedReplot);
 }
 
 void AScanPlot::plotCurrentAScan() {
@@ -322,29 +423,30 @@ void AScanPlot::plotCurrentAScan() {
     return;
   }
 
-  // Correct for flip and rotation in the selected AScan idx
-  // and store result in m_AScanPlotIdx
-  {
-    const bool flip = uspam::recon::ReconParams::flip(m_data->frameIdx);
-    auto idx = m_AScanPlotIdx_canvas;
-    if (flip) {
-      idx -= m_reconParams->params.PA.rotateOffset;
-
-      constexpr int AScansPerBScan = 1000;
-      if (idx < 0) {
-        idx += AScansPerBScan;
-      } else if (idx >= AScansPerBScan) {
-        idx -= AScansPerBScan;
-      }
-
-      idx = AScansPerBScan - 1 - idx;
-    }
-
-    const auto msg =
-        QString("AScan: %1. Flip: %2").arg(idx).arg(flip ? "true" : "false");
-
-    m_AScanPlotIdx = idx;
+  // Map the selected A-line from display order (flip and rotation) to the
+  // acquisition order of the data. PA and US may have different offsets.
+  const auto alineIdx = [this](const BScanData_<DataProcWorker::FloatType> &d) {
+    const auto n = static_cast<int>(d.rfLog.n_cols);
+    return n > 0 ? d.perm.src(std::clamp(m_AScanPlotIdx_canvas, 0, n - 1), n)
+                 : 0;
+  };
+  m_AScanPlotIdx = alineIdx(m_data->PA);
+  const int idxPA = m_AScanPlotIdx;
+  const int idxUS = alineIdx(m_data->US);
+
+  // Lean frames only keep one A-line of the intermediates (rfLog is
+  // complete). Ask for the selected ones and plot when they arrive.
+  const bool lean = m_data->PA.aline >= 0;
+  const bool needsIntermediates =
+      m_type != PlotType::RFLogPA && m_type != PlotType::RFLogUS;
+  if (lean && needsIntermediates &&
+      (m_data->PA.aline != idxPA || m_data->US.aline != idxUS)) {
+    emit alineRequested(m_data, idxPA, idxUS);
+    return;
   }
+  // Column of rf, rfBeamformed and rfEnv
+  const int colPA = lean ? 0 : idxPA;
+  const int colUS = lean ? 0 : idxUS;
 
   /*
    * Plot AScan
@@ -357,7 +459,7 @@ void AScanPlot::plotCurrentAScan() {
   case PlotType::RFRaw: {
     // Original RF
     const auto &rf = m_data->rf;
-    const std::span y{rf.colptr(m_AScanPlotIdx), rf.n_rows};
+    const std::span y{rf.colptr(colPA), rf.n_rows};
     customPlot->xAxis->setLabel("Samples");
     customPlot->yAxis->setLabel("Signal (V)");
     m_plotMeta.name = "Raw RF";
@@ -369,7 +471,7 @@ void AScanPlot::plotCurrentAScan() {
     const auto &rf = m_data->PA.rfBeamformed;
     customPlot->xAxis->setLabel("Samples");
     customPlot->yAxis->setLabel("Signal (V)");
-    const std::span y{rf.colptr(m_AScanPlotIdx_canvas), rf.n_rows};
+    const std::span y{rf.colptr(colPA), rf.n_rows};
     m_plotMeta.xScaler = MM_PER_PIXEL_PA;
     m_plotMeta.xUnit = "mm";
     m_plotMeta.name = "Beamformed RF (PA)";
@@ -381,7 +483,7 @@ void AScanPlot::plotCurrentAScan() {
     const auto &rf = m_data->US.rfBeamformed;
     customPlot->xAxis->setLabel("Samples");
     customPlot->yAxis->setLabel("Signal (V)");
-    const std::span y{rf.colptr(m_AScanPlotIdx_canvas), rf.n_rows};
+    const std::span y{rf.colptr(colUS), rf.n_rows};
     m_plotMeta.xScaler = MM_PER_PIXEL_US;
     m_plotMeta.xUnit = "mm";
     m_plotMeta.name = "Beamformed RF (US)";
@@ -393,8 +495,11 @@ void AScanPlot::plotCurrentAScan() {
     const auto &rf = m_data->PA.rfEnv;
     customPlot->xAxis->setLabel("Samples");
     customPlot->yAxis->setLabel("Signal (V)");
-    const std::span y{rf.colptr(m_AScanPlotIdx_canvas), rf.n_rows};
-    m_plotMeta.xScaler = MM_PER_PIXEL_PA;
+    const std::span y{rf.colptr(colPA), rf.n_rows};
+    // The IQ envelope is decimated relative to the RF
+    m_plotMeta.xScaler = MM_PER_PIXEL_PA *
+                         static_cast<double>(m_data->PA.rfBeamformed.n_rows) /
+                         static_cast<double>(rf.n_rows);
     m_plotMeta.xUnit = "mm";
     m_plotMeta.name = "RF Envelope (PA)";
     plot(y);
@@ -404,8 +509,11 @@ void AScanPlot::plotCurrentAScan() {
     const auto &rf = m_data->US.rfEnv;
     customPlot->xAxis->setLabel("Samples");
     customPlot->yAxis->setLabel("Signal (V)");
-    const std::span y{rf.colptr(m_AScanPlotIdx_canvas), rf.n_rows};
-    m_plotMeta.xScaler = MM_PER_PIXEL_US;
+    const std::span y{rf.colptr(colUS), rf.n_rows};
+    // The IQ envelope is decimated relative to the RF
+    m_plotMeta.xScaler = MM_PER_PIXEL_US *
+                         static_cast<double>(m_data->US.rfBeamformed.n_rows) /
+                         static_cast<double>(rf.n_rows);
     m_plotMeta.xUnit = "mm";
     m_plotMeta.name = "RF Envelope (US)";
     plot(y);
@@ -414,13 +522,16 @@ void AScanPlot::plotCurrentAScan() {
   case PlotType::RFLogPA: {
     // US rfLog
     const auto &rf = m_data->PA.rfLog;
-    const std::span y{rf.colptr(m_AScanPlotIdx_canvas), rf.n_rows};
+    const std::span y{rf.colptr(idxPA), rf.n_rows};
     customPlot->xAxis->setLabel("Samples");
     customPlot->yAxis->setLabel("Signal");
     m_plotMeta.autoScaleY = false;
     m_plotMeta.yMax = 0;
     m_plotMeta.yMax = 256; // NOLINT(*-magic-numbers)
-    m_plotMeta.xScaler = MM_PER_PIXEL_PA;
+    // rfLog may be decimated relative to the RF
+    m_plotMeta.xScaler = MM_PER_PIXEL_PA *
+                         static_cast<double>(m_data->PA.rfBeamformed.n_rows) /
+                         static_cast<double>(rf.n_rows);
     m_plotMeta.xUnit = "mm";
     m_plotMeta.name = "RF Log (PA)";
     plot(y);
@@ -431,11 +542,14 @@ void AScanPlot::plotCurrentAScan() {
     const auto &rf = m_data->US.rfLog;
     customPlot->xAxis->setLabel("Samples");
     customPlot->yAxis->setLabel("Signal");
-    const std::span y{rf.colptr(m_AScanPlotIdx_canvas), rf.n_rows};
+    const std::span y{rf.colptr(idxUS), rf.n_rows};
     m_plotMeta.autoScaleY = false;
     m_plotMeta.yMax = 0;
     m_plotMeta.yMax = 256; // NOLINT(*-magic-numbers)
-    m_plotMeta.xScaler = MM_PER_PIXEL_US;
+    // rfLog may be decimated relative to the RF
+    m_plotMeta.xScaler = MM_PER_PIXEL_US *
+                         static_cast<double>(m_data->US.rfBeamformed.n_rows) /
+                         static_cast<double>(rf.n_rows);
     m_plotMeta.xUnit = "mm";
     m_plotMeta.name = "RF Log (US)";
     plot(y);
@@ -447,6 +561,16 @@ void AScanPlot::plotCurrentAScan() {
   }
 }
 
+void AScanPlot::setAlineData(
+    std::shared_ptr<BScanData<DataProcWorker::FloatType>> data) {
+  // Drop A-lines of a frame that is no longer shown
+  if (m_data == nullptr || data->frameIdx != m_data->frameIdx) {
+    return;
+  }
+  m_data = std::move(data);
+  plotCurrentAScan();
+}
+
 void AScanPlot::handleAScanSelected(int idx) {
   // The index received here is in canvas pixmap coordinates (i.e. doesn't
   // account for flip and rotation offset)
@@ -3,10 +3,12 @@
 #include "DataProcWorker.hpp"
 #include "Metrics/FWHM.hpp"
 #include <QMouseEvent>
+#include <QResizeEvent>
 #include <QString>
 #include <QVector>
 #include <QWidget>
 #include <ReconParamsController.hpp>
+#include <map>
 #include <memory>
 #include <qcustomplot.h>
 #include <span>
@@ -100,12 +102,28 @@ public slots:
 
   void plotCurrentAScan();
 
+  // A-lines recomputed for alineRequested
+  void setAlineData(std::shared_ptr<BScanData<DataProcWorker::FloatType>> data);
+
   void handleAScanSelected(int idx);
 
+signals:
+  // The selected A-lines of a lean frame (see DataProcWorker::setLeanMode)
+  // need to be recomputed
+  void alineRequested(std::shared_ptr<BScanData<DataProcWorker::FloatType>>,
+                      int idxPA, int idxUS);
+
+protected:
+  void resizeEvent(QResizeEvent *event) override;
+
 private:
   // Makes sure m_x is properly generated
   void ensureX(int size);
 
+  // Write the visible range of m_x/m_y to the graph, decimated to the plot
+  // width. Full resolution when zoomed in far enough.
+  void updateGraphData();
+
   ReconParamsController *m_reconParams;
   std::shared_ptr<BScanData<DataProcWorker::FloatType>> m_data;
 
@@ -113,6 +131,9 @@ private:
   PlotMeta m_plotMeta;
   QVector<FloatType> m_x;
   QVector<FloatType> m_y;
+  std::map<int, QVector<FloatType>> m_xCache;
+  QVector<QCPGraphData> m_graphData; // Decimated points, reused
+  bool m_settingRange{false};
 
   int m_AScanPlotIdx_canvas{}; // Received from canvas, not corrected for flip
                                // and rotation
@@ -18,7 +18,7 @@
 
 Canvas::Canvas(QWidget *parent)
     : QGraphicsView(parent), m_scene(new QGraphicsScene),
-      m_overlay(new CanvasOverlay(viewport()))
+      m_overlay(new CanvasOverlay(viewport())), m_image(new TiledImageItem)
 
 {
   setBackgroundBrush(QBrush(Qt::black));
@@ -44,6 +44,10 @@ Canvas::Canvas(QWidget *parent)
   setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
   setScene(m_scene);
 
+  // Use negative Z value to make sure the image is at the bottom
+  m_image->setZValue(-1);
+  m_scene->addItem(m_image);
+
   // Hide the overlay at init since no images are shown yet.
   m_overlay->hide();
 }
@@ -87,18 +91,18 @@ void Canvas::setModel(AnnotationModel *model) {
 void Canvas::imshow(const cv::Mat &cv_img, double pix2m) {
   QImage qi(cv_img.data, cv_img.cols, cv_img.rows,
             static_cast<int>(cv_img.step), QImage::Format_BGR888);
-  this->imshow(QPixmap::fromImage(qi), pix2m);
+  this->imshow(qi.copy(), pix2m);
 }
 
 void Canvas::updateMinScaleFactor() {
-  if (m_Pixmap.isNull()) [[unlikely]] {
+  if (m_image->isNull()) [[unlikely]] {
     return;
   }
 
   const auto w = width();
   const auto h = height();
-  const auto pw = m_Pixmap.width();
-  const auto ph = m_Pixmap.height();
+  const auto pw = m_image->size().width();
+  const auto ph = m_image->size().height();
 
   // Calculate the scaleFactor needed to fill the viewport with the image
   // This is also the minimum scale factor
@@ -115,33 +119,22 @@ void Canvas::scaleToSize() {
 }
 
 void Canvas::imshow(const QImage &img, double pix2m) {
-  this->imshow(QPixmap::fromImage(img), pix2m);
-}
-
-void Canvas::imshow(const QPixmap &pixmap, double pix2m) {
-  m_Pixmap = pixmap;
+  m_image->setImage(img);
   m_pix2m = pix2m;
 
-  // Remove current image
-  if (m_PixmapItem != nullptr) {
-    m_scene->removeItem(m_PixmapItem);
-    delete m_PixmapItem;
-  }
-
-  // Add image pixmap to scene
-  m_PixmapItem = m_scene->addPixmap(m_Pixmap);
-  // Use negative Z value to make sure pixmap is at the bottom
-  m_PixmapItem->setZValue(-1);
-
   if (m_resetZoomOnNextImshow) {
     scaleToSize();
     m_resetZoomOnNextImshow = false;
   }
 
-  m_overlay->setSize(m_Pixmap.size());
+  m_overlay->setSize(m_image->size());
   m_overlay->show();
 }
 
+void Canvas::imshow(const QPixmap &pixmap, double pix2m) {
+  this->imshow(pixmap.toImage(), pix2m);
+}
+
 // NOLINTBEGIN(*-casting, *-narrowing-conversions)
 
 // Compute the distance between two points in the scaled pixmap domain
@@ -191,7 +184,7 @@ void Canvas::undo() {
 
 void Canvas::mousePressEvent(QMouseEvent *event) {
   // Compute position in the pixmap domain
-  m_cursor.startPos = m_PixmapItem->mapFromScene(mapToScene(event->pos()));
+  m_cursor.startPos = m_image->mapFromScene(mapToScene(event->pos()));
   m_cursor.pos = m_cursor.startPos;
 
   if (event->button() == Qt::LeftButton) {
@@ -207,7 +200,7 @@ void Canvas::mousePressEvent(QMouseEvent *event) {
       // Add a graphics item represending the AScan
       // Emit a signal to tell the AScan plot
 
-      const auto [idx, line] = m_cursor.selectAScan(m_Pixmap.rect());
+      const auto [idx, line] = m_cursor.selectAScan(m_image->rect());
 
       // Insert ALine graphics here in canvas
       const auto color = Qt::green;
@@ -252,10 +245,10 @@ void Canvas::mousePressEvent(QMouseEvent *event) {
       // Convert mouse pos to angle
       m_cursor.angleOffset = 0;
       m_cursor.lastAngle = 180.0; // NOLINT(*-magic-numbers)
-      const auto angle = m_cursor.angleDeg(m_Pixmap.rect());
+      const auto angle = m_cursor.angleDeg(m_image->rect());
 
       m_currItem = new annotation::FanItem(
-          Annotation(annotation::Arc{angle, 0}, m_Pixmap.rect(), Qt::white));
+          Annotation(annotation::Arc{angle, 0}, m_image->rect(), Qt::white));
       m_currItem->updateScaleFactor(m_scaleFactor);
       m_scene->addItem(m_currItem);
 
@@ -278,10 +271,10 @@ void Canvas::mousePressEvent(QMouseEvent *event) {
 
 void Canvas::mouseMoveEvent(QMouseEvent *event) {
   // Compute position in the pixmap domain
-  m_cursor.pos = m_PixmapItem->mapFromScene(mapToScene(event->pos()));
+  m_cursor.pos = m_image->mapFromScene(mapToScene(event->pos()));
 
   // [px] Compute distance to center
-  const auto center = m_Pixmap.rect().center();
+  const auto center = m_image->rect().center();
   const auto distanceToCenter_mm = computeDistance_mm(center, m_cursor.pos);
   emit mouseMoved(m_cursor.pos.toPoint(), distanceToCenter_mm);
 
@@ -292,7 +285,7 @@ void Canvas::mouseMoveEvent(QMouseEvent *event) {
       break;
 
     case (CursorMode::SelectAScan): {
-      const auto [idx, line] = m_cursor.selectAScan(m_Pixmap.rect());
+      const auto [idx, line] = m_cursor.selectAScan(m_image->rect());
 
       // Move ALine graphics here in canvas
       if (auto *lineItem = dynamic_cast<annotation::LineItem *>(m_currItem);
@@ -341,7 +334,7 @@ void Canvas::mouseMoveEvent(QMouseEvent *event) {
         constexpr double UPPER_THRESH = 340.0;
         constexpr double LOWER_THRESH = 20.0;
 
-        const double angle = m_cursor.angleDeg(m_Pixmap.rect());
+        const double angle = m_cursor.angleDeg(m_image->rect());
 
         if ((m_cursor.lastAngle > UPPER_THRESH && angle < LOWER_THRESH)) {
           m_cursor.angleOffset += FULL_CIRCLE;
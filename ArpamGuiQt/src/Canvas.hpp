@@ -5,6 +5,7 @@
 #include "CanvasCursorState.hpp"
 #include "CanvasOverlay.hpp"
 #include "CanvasTicks.hpp"
+#include "TiledImageItem.hpp"
 #include <QAbstractListModel>
 #include <QCursor>
 #include <QEvent>
@@ -156,9 +157,9 @@ private:
   QPointF m_lastPanPoint;
   QCursor m_panLastCursor;
 
-  // Image
-  QPixmap m_Pixmap; // Image pixmap
-  QGraphicsPixmapItem *m_PixmapItem{nullptr};
+  // Image, drawn as a tiled pyramid so only the visible tiles at the current
+  // zoom are uploaded
+  TiledImageItem *m_image;
 
   double m_pix2m{}; // [m] Factor converting pixel (in m_pixmap) to meters
 
@@ -5,20 +5,41 @@
 #include <QtDebug>
 #include <QtLogging>
 #include <armadillo>
+#include <cmath>
 #include <cstdio>
 #include <future>
+#include <latch>
+#include <memory>
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 #include <uspam/fft.hpp>
 #include <uspam/imutil.hpp>
 #include <uspam/timeit.hpp>
 #include <uspam/uspam.hpp>
 #include <utility>
+#include <vector>
 
 namespace io = uspam::io;
 
 namespace {
 
+// QImage that shares the pixels of `mat` (no copy). The QImage keeps a
+// reference to the cv::Mat data, so writing to `mat` afterwards shows in the
+// image: only use it for buffers that are not written again.
+QImage cvMatToQImageShared(const cv::Mat &mat, QImage::Format format) {
+  auto *ref = new cv::Mat(mat); // NOLINT(*-owning-memory)
+  return {ref->data,
+          ref->cols,
+          ref->rows,
+          static_cast<qsizetype>(ref->step),
+          format,
+          [](void *info) {
+            delete static_cast<cv::Mat *>(info); // NOLINT(*-owning-memory)
+          },
+          ref};
+}
+
 QImage cvMatToQImage(const cv::Mat &mat) {
   switch (mat.type()) {
   // 8-bit, 4 channel
@@ -27,18 +48,12 @@ QImage cvMatToQImage(const cv::Mat &mat) {
                  QImage::Format_ARGB32);
     return image.copy(); // Use copy to detach from original data
   }
-  // 8-bit, 3 channel
-  case CV_8UC3: {
-    QImage image(mat.data, mat.cols, mat.rows, static_cast<qsizetype>(mat.step),
-                 QImage::Format_RGB888);
-    return image.rgbSwapped(); // Convert BGR to RGB
-  }
+  // 8-bit, 3 channel (BGR)
+  case CV_8UC3:
+    return cvMatToQImageShared(mat, QImage::Format_BGR888);
   // 8-bit, 1 channel
-  case CV_8UC1: {
-    QImage image(mat.data, mat.cols, mat.rows, static_cast<qsizetype>(mat.step),
-                 QImage::Format_Grayscale8);
-    return image.copy();
-  }
+  case CV_8UC1:
+    return cvMatToQImageShared(mat, QImage::Format_Grayscale8);
   // 64F, 1 channel
   case CV_64FC1: {
     cv::Mat mat_normalized = mat * 255; // NOLINT
@@ -55,8 +70,58 @@ QImage cvMatToQImage(const cv::Mat &mat) {
   return {};
 }
 
+// Run func on pool and get its result through a future
+template <typename Func>
+auto runOn(QThreadPool &pool, Func &&func)
+    -> std::future<std::invoke_result_t<Func>> {
+  using R = std::invoke_result_t<Func>;
+  auto task =
+      std::make_shared<std::packaged_task<R()>>(std::forward<Func>(func));
+  auto future = task->get_future();
+  pool.start([task = std::move(task)] { (*task)(); });
+  return future;
+}
+
 } // namespace
 
+DataProcWorker::DataProcWorker()
+    : m_params(uspam::recon::ReconParams2::system2024v1()),
+      m_ioparams(uspam::io::IOParams::system2024v1()) {
+  m_reconPool.setMaxThreadCount(2);
+  m_reconPool.setExpiryTimeout(-1); // Never expire idle threads
+}
+
+void DataProcWorker::warmup() {
+  if (m_warmedUp) {
+    return;
+  }
+
+  // Marked with the copy, so params replaced while warming up clear it again
+  const auto ioparams = [&] {
+    QMutexLocker lock(&m_paramsMutex);
+    m_warmedUp = true;
+    return m_ioparams;
+  }();
+
+  // Hold both tasks at the latch until each has a thread of its own, so every
+  // pool thread gets warmed up.
+  const uspam::TimeIt timeit;
+  const int nThreads = m_reconPool.maxThreadCount();
+  std::latch started(nThreads);
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < nThreads; ++i) {
+    futures.push_back(runOn(m_reconPool, [&] {
+      started.arrive_and_wait();
+      uspam::recon::warmup<FloatType>(ioparams, io::NUM_ALINES_DETAULT);
+    }));
+  }
+  for (auto &future : futures) {
+    future.get();
+  }
+
+  qInfo() << "Recon warm-up took" << timeit.get_ms() << "ms";
+}
+
 void DataProcWorker::initDataBuffers() {
   QMutexLocker lock(&m_paramsMutex);
   m_data = std::make_shared<BScanData<FloatType>>();
@@ -65,8 +130,24 @@ void DataProcWorker::initDataBuffers() {
 }
 
 void DataProcWorker::setBinfile(const fs::path &binfile) {
-  m_binfilePath = binfile;
-  m_imageSaveDir = m_binfilePath.parent_path() / m_binfilePath.stem();
+  setBinfiles({binfile});
+}
+
+void DataProcWorker::setBinfiles(const std::vector<fs::path> &binfiles) {
+  if (binfiles.empty()) {
+    return;
+  }
+
+  m_binfilePaths = binfiles;
+  m_binfilePath = binfiles.front();
+  if (binfiles.size() == 1) {
+    m_imageSaveDir = m_binfilePath.parent_path() / m_binfilePath.stem();
+  } else {
+    // e.g. "scan_001-scan_004"
+    m_imageSaveDir =
+        m_binfilePath.parent_path() / (m_binfilePath.stem().string() + "-" +
+                                       binfiles.back().stem().string());
+  }
 
   if (!fs::create_directory(m_imageSaveDir) && !fs::exists(m_imageSaveDir)) {
     emit error(tr("Failed to create imageSaveDir ") +
@@ -76,19 +157,39 @@ void DataProcWorker::setBinfile(const fs::path &binfile) {
   }
 
   try {
-    // Init loader
+    // Init loader. Files are only opened when frames are read from them
     m_loader.setParams(m_ioparams);
-    m_loader.open(m_binfilePath);
+    m_loader.open(m_binfilePaths);
     emit maxFramesChanged(m_loader.size());
 
+    // Don't carry the gain or frame history of the previous file over
+    m_autoGainPA.reset();
+    m_autoGainUS.reset();
+    m_temporalPA.reset();
+    m_temporalUS.reset();
+
+    // New volume for the new sequence, opened on its first frame
+    m_volume->close();
+    m_volumeFailed = false;
+
     // Save init params
     saveParamsToFile();
 
+    // Plan FFTs before the first frame
+    warmup();
+
+    m_haveThumbnail.assign(m_loader.size(), false);
+    m_nextThumbnail = 0;
+    m_displaySize = 0;
+
     // Process the first frame
     playOne(0);
 
     m_ready = true;
 
+    // Thumbnails of the other frames while idle
+    schedulePreviews();
+
   } catch (const std::runtime_error &e) {
     const auto msg = QString("DataProcWorker exception: ") +
                      QString::fromStdString(e.what());
@@ -101,8 +202,13 @@ void DataProcWorker::play() {
   m_isPlaying = true;
 
   while (m_isPlaying && m_frameIdx < m_loader.size()) {
-    playOne(m_frameIdx);
-    m_frameIdx++;
+    // Seeking while playing continues from the requested frame
+    if (const auto idx = takeRequestedFrame(); idx != NO_REQUEST) {
+      m_frameIdx = idx;
+    }
+    if (processCurrentFrame()) {
+      m_frameIdx++;
+    }
   }
 
   if (m_isPlaying) {
@@ -113,6 +219,8 @@ void DataProcWorker::play() {
   m_isPlaying = false;
 
   emit finishedPlaying();
+
+  schedulePreviews();
 }
 
 void DataProcWorker::playOne(int idx) {
@@ -122,6 +230,79 @@ void DataProcWorker::playOne(int idx) {
 }
 void DataProcWorker::replayOne() { processCurrentFrame(); }
 
+void DataProcWorker::requestFrame(int idx) {
+  // Only wake the worker if the slot was empty. Otherwise the pending wakeup
+  // will pick up this request instead of the one it replaced.
+  const auto prev = m_requestedFrame.exchange(idx, std::memory_order_acq_rel);
+  if (prev == NO_REQUEST) {
+    QMetaObject::invokeMethod(this, &DataProcWorker::processRequestedFrame,
+                              Qt::QueuedConnection);
+  }
+}
+
+void DataProcWorker::processRequestedFrame() {
+  // A superseded frame returns early and the loop moves on to the newer one
+  for (auto idx = takeRequestedFrame(); idx != NO_REQUEST;
+       idx = takeRequestedFrame()) {
+    m_frameIdx = idx;
+    processCurrentFrame(true);
+  }
+
+  schedulePreviews();
+}
+
+void DataProcWorker::requestAline(std::shared_ptr<BScanData<FloatType>> data,
+                                  int idxPA, int idxUS) {
+  bool wake{};
+  {
+    QMutexLocker lock(&m_alineMutex);
+    wake = !m_alineRequest.has_value();
+    m_alineRequest = AlineRequest{std::move(data), idxPA, idxUS};
+  }
+  if (wake) {
+    QMetaObject::invokeMethod(this, &DataProcWorker::processRequestedAline,
+                              Qt::QueuedConnection);
+  }
+}
+
+void DataProcWorker::processRequestedAline() {
+  std::optional<AlineRequest> request;
+  {
+    QMutexLocker lock(&m_alineMutex);
+    request.swap(m_alineRequest);
+  }
+  if (!request || request->data == nullptr) {
+    return;
+  }
+
+  // Copy of the frame (the images are shared) with the A-lines recomputed
+  // from the raw RF, split and reconstructed with the params of the frame
+  // even if they changed since
+  auto data = std::make_shared<BScanData<FloatType>>(*request->data);
+  PerformanceMetrics perfMetrics{};
+  readFrame(data->frameIdx, data->ioparams, *data, perfMetrics);
+
+  const auto recompute = [](BScanData_<FloatType> &d, int j) {
+    uspam::recon::reconOneAline<FloatType>(d.params, d.rf, j, d.rfBeamformed,
+                                           d.rfEnv);
+    d.rf.reset();
+    d.aline = j;
+  };
+  recompute(data->PA, request->idxPA);
+  recompute(data->US, request->idxUS);
+  data->rf = arma::Mat<FloatType>(data->rf.col(request->idxPA));
+
+  emit alineReady(data);
+}
+
+void DataProcWorker::schedulePreviews() {
+  if (!m_previewsScheduled) {
+    m_previewsScheduled = true;
+    QMetaObject::invokeMethod(this, &DataProcWorker::buildNextPreview,
+                              Qt::QueuedConnection);
+  }
+}
+
 void DataProcWorker::pause() { m_isPlaying = false; }
 
 void DataProcWorker::updateParams(uspam::recon::ReconParams2 params,
@@ -129,6 +310,32 @@ void DataProcWorker::updateParams(uspam::recon::ReconParams2 params,
   QMutexLocker lock(&m_paramsMutex);
   this->m_params = std::move(params);
   this->m_ioparams = ioparams;
+  this->m_overlay = makeOverlayCompositor(this->m_params);
+  // The FFT plans and FIR dispatch were tuned for the previous sizes
+  m_warmedUp = false;
+}
+
+bool DataProcWorker::startVideoExport(const fs::path &filename,
+                                      const uspam::io::VideoSinkParams &params,
+                                      VideoExportSource source) {
+  QMutexLocker lock(&m_videoMutex);
+  m_videoSource = source;
+  return m_videoSink.open(filename, params);
+}
+
+int DataProcWorker::stopVideoExport() {
+  QMutexLocker lock(&m_videoMutex);
+  m_videoSink.close();
+
+  if (const auto err = m_videoSink.error(); !err.empty()) {
+    emit error(QString::fromStdString(err));
+  }
+  return m_videoSink.framesWritten();
+}
+
+bool DataProcWorker::isExportingVideo() const {
+  QMutexLocker lock(&m_videoMutex);
+  return m_videoSink.isOpen();
 }
 
 void DataProcWorker::saveParamsToFile() {
@@ -140,9 +347,16 @@ void DataProcWorker::saveParamsToFile() {
 
 namespace {
 
-template <uspam::Floating T>
+// `cancelled()` is polled between stages. The remaining stages are skipped
+// once it returns true and `data` is left incomplete.
+template <uspam::Floating T, typename Cancelled>
 auto procOne(const uspam::recon::ReconParams &params, BScanData_<T> &data,
-             bool flip) {
+             int frameIdx, bool flip, bool computeFWHM,
+             uspam::recon::AutoGain &autoGain,
+             uspam::recon::TemporalFilter &temporal,
+             const Cancelled &cancelled) {
+  data.perm = params.permutation(flip);
+  data.params = params;
 
   float beamform_ms{};
   float recon_ms{};
@@ -153,16 +367,54 @@ auto procOne(const uspam::recon::ReconParams &params, BScanData_<T> &data,
     beamform_ms = timeit.get_ms();
   }
 
+  if (cancelled()) {
+    return std::tuple{beamform_ms, recon_ms, imageConversion_ms};
+  }
+
   {
     uspam::TimeIt timeit;
     uspam::recon::reconOneScan<T>(params, data.rfBeamformed, data.rfEnv,
-                                  data.rfLog, flip);
+                                  data.rfLog, &autoGain, &data.enface);
+    data.perm.apply(data.enface.alines);
+
+    // Blend with the previous frames (a no-op if the filter is off)
+    temporal.apply(params, frameIdx, data.rfLog, data.perm);
     recon_ms = timeit.get_ms();
   }
 
+  // Axial resolution of every A-line, only if shown. Skip the truncated
+  // pulser/laser artifact, which is usually the highest peak.
+  {
+    const auto rfRows = static_cast<double>(data.rfBeamformed.n_rows);
+    const auto envRows = static_cast<double>(data.rfEnv.n_rows);
+    data.mmPerEnvRow =
+        static_cast<float>(params.mmPerSample * rfRows / envRows);
+    if (computeFWHM) {
+      const auto startRow =
+          static_cast<int>(std::ceil(params.truncate * envRows / rfRows));
+      uspam::metrics::fwhm<T>(data.rfEnv, data.fwhm, startRow);
+      data.perm.apply(data.fwhm); // Same A-line order as the image
+    } else {
+      data.fwhm.clear();
+    }
+  }
+
+  if (params.autoGain && autoGain.initialized()) {
+    const auto gain = autoGain.result();
+    data.noiseFloor_mV = gain.noiseFloor_mV;
+    data.dynamicRange = gain.dynamicRange_dB;
+  } else {
+    data.noiseFloor_mV = params.noiseFloor_mV;
+    data.dynamicRange = params.desiredDynamicRange;
+  }
+
+  if (cancelled()) {
+    return std::tuple{beamform_ms, recon_ms, imageConversion_ms};
+  }
+
   {
     uspam::TimeIt timeit;
-    data.radial = uspam::imutil::makeRadial(data.rfLog);
+    data.radial = uspam::imutil::makeRadial(data.rfLog, 0, data.perm);
     data.radial_img = cvMatToQImage(data.radial);
     imageConversion_ms = timeit.get_ms();
   }
@@ -170,6 +422,35 @@ auto procOne(const uspam::recon::ReconParams &params, BScanData_<T> &data,
   return std::tuple{beamform_ms, recon_ms, imageConversion_ms};
 }
 
+// Radial size [px] of previews and thumbnails
+constexpr int PREVIEW_SIZE = 256;
+constexpr int THUMBNAIL_SIZE = 64;
+
+// Preview of one channel, with about PREVIEW_SIZE A-lines and samples
+template <uspam::Floating T>
+void previewOne(const uspam::recon::ReconParams &params,
+                const arma::Mat<T> &rf, BScanData_<T> &data, bool flip,
+                const uspam::recon::AutoGain &autoGain) {
+  const auto alineStep =
+      std::max(1, static_cast<int>(rf.n_cols) / PREVIEW_SIZE);
+  const auto sampleStep =
+      std::max(1, static_cast<int>(rf.n_rows) / PREVIEW_SIZE);
+  uspam::recon::reconPreview<T>(params, rf, data.rfLog, alineStep,
+                                sampleStep, &autoGain);
+
+  // Rotation in decimated A-lines
+  const auto perm = params.permutation(flip);
+  data.perm = {perm.flip, perm.rotate / alineStep};
+  data.radial = uspam::imutil::makeRadial(data.rfLog, PREVIEW_SIZE, data.perm);
+}
+
+QImage makeThumbnail(const cv::Mat &PAUSradial) {
+  cv::Mat thumb;
+  cv::resize(PAUSradial, thumb, {THUMBNAIL_SIZE, THUMBNAIL_SIZE}, 0, 0,
+             cv::INTER_AREA);
+  return cvMatToQImage(thumb);
+}
+
 class ImageWriteTask : public QRunnable {
   QImage img;
   QString fname;
@@ -182,47 +463,165 @@ public:
 
 } // namespace
 
-void DataProcWorker::processCurrentFrame() {
-  PerformanceMetrics perfMetrics{};
-  uspam::TimeIt timeit;
+auto DataProcWorker::loadFrame(int idx, BScanData<FloatType> &data,
+                               PerformanceMetrics &perfMetrics)
+    -> FrameParams {
+  // this->params and this->ioparams are read under paramsMutex. The frame
+  // keeps copies.
+  uspam::io::IOParams ioparams;
+  FrameParams params;
+  {
+    QMutexLocker lock(&m_paramsMutex);
+    ioparams = m_ioparams;
+    params = {m_params.PA, m_params.US, m_overlay};
+  }
 
-  // Init buffers in m_data
-  initDataBuffers();
+  readFrame(idx, ioparams, data, perfMetrics);
+  return params;
+}
 
+void DataProcWorker::readFrame(int idx, const uspam::io::IOParams &ioparams,
+                               BScanData<FloatType> &data,
+                               PerformanceMetrics &perfMetrics) {
   // Read next RF scan from file
   {
     const uspam::TimeIt timeit;
-    m_data->rf = m_loader.get<FloatType>(m_frameIdx);
+    data.rf = m_loader.get<FloatType>(idx);
     perfMetrics.fileloader_ms = timeit.get_ms();
   }
 
-  const auto [paramsPA, paramsUS] = [&] {
-    // Estimate background from current RF
-    const arma::Col<FloatType> background_aline = arma::mean(m_data->rf, 1);
+  // Estimate background from current RF
+  const arma::Col<FloatType> background_aline = arma::mean(data.rf, 1);
 
-    // this->params and this->ioparams are used in this block
-    // lock with paramsMutex
-    QMutexLocker lock(&m_paramsMutex);
-    {
-      // Split RF into PA and US scan lines
-      const uspam::TimeIt timeit;
-      m_ioparams.splitRfPAUS_sub(m_data->rf, background_aline, m_data->PA.rf,
-                                 m_data->US.rf);
-      perfMetrics.splitRf_ms = timeit.get_ms();
+  {
+    // Split RF into PA and US scan lines
+    const uspam::TimeIt timeit;
+    ioparams.splitRfPAUS_sub(data.rf, background_aline, data.PA.rf,
+                             data.US.rf);
+    perfMetrics.splitRf_ms = timeit.get_ms();
+  }
+  data.ioparams = ioparams;
+}
+
+auto DataProcWorker::makePreview(const BScanData<FloatType> &data,
+                                 const FrameParams &params, bool flip) const
+    -> std::shared_ptr<BScanData<FloatType>> {
+  const auto &[paramsPA, paramsUS, overlay] = params;
+
+  auto preview = std::make_shared<BScanData<FloatType>>();
+  preview->frameIdx = data.frameIdx;
+  preview->flip = flip;
+  preview->fct = m_displayFct;
+
+  previewOne<FloatType>(paramsPA, data.PA.rf, preview->PA, flip,
+                        m_autoGainPA);
+  previewOne<FloatType>(paramsUS, data.US.rf, preview->US, flip,
+                        m_autoGainUS);
+  overlay.compose(preview->US.radial, preview->PA.radial,
+                  preview->PAUSradial);
+
+  return preview;
+}
+
+void DataProcWorker::buildNextPreview() {
+  m_previewsScheduled = false;
+
+  // Frame requests come first. Scheduled again after they are done
+  if (!m_ready || superseded()) {
+    return;
+  }
+
+  const auto n = static_cast<int>(m_haveThumbnail.size());
+  while (m_nextThumbnail < n && m_haveThumbnail[m_nextThumbnail]) {
+    ++m_nextThumbnail;
+  }
+  if (m_nextThumbnail >= n) {
+    return;
+  }
+  const int idx = m_nextThumbnail;
+
+  BScanData<FloatType> data;
+  data.frameIdx = idx;
+  PerformanceMetrics perfMetrics{};
+  const auto params = loadFrame(idx, data, perfMetrics);
+  const bool flip = uspam::recon::ReconParams::flip(m_loader.localIndex(idx));
+  const auto preview = makePreview(data, params, flip);
+
+  m_haveThumbnail[idx] = true;
+  emit thumbnailReady(idx, makeThumbnail(preview->PAUSradial));
+
+  schedulePreviews();
+}
+
+bool DataProcWorker::processCurrentFrame(bool previewFirst) {
+  PerformanceMetrics perfMetrics{};
+  uspam::TimeIt timeit;
+
+  // Init buffers in m_data
+  initDataBuffers();
+
+  const auto frameParams = loadFrame(m_frameIdx, *m_data, perfMetrics);
+  const auto &[paramsPA, paramsUS, overlay] = frameParams;
+
+  // Another frame was requested while this one was being read
+  if (superseded()) {
+    return false;
+  }
+
+  const bool flip =
+      uspam::recon::ReconParams::flip(m_loader.localIndex(m_frameIdx));
+  m_data->flip = flip;
+
+  // Show a preview first, at the size of the last full quality frame
+  if (previewFirst && m_displaySize > 0) {
+    auto preview = makePreview(*m_data, frameParams, flip);
+    if (m_frameIdx < static_cast<int>(m_haveThumbnail.size()) &&
+        !m_haveThumbnail[m_frameIdx]) {
+      m_haveThumbnail[m_frameIdx] = true;
+      emit thumbnailReady(m_frameIdx, makeThumbnail(preview->PAUSradial));
     }
 
-    return std::tuple(m_params.PA, m_params.US);
-  }();
+    const cv::Size size(m_displaySize, m_displaySize);
+    for (auto *d : {&preview->PA, &preview->US}) {
+      cv::resize(d->radial, d->radial, size, 0, 0, cv::INTER_LINEAR);
+      d->radial_img = cvMatToQImage(d->radial);
+    }
+    cv::resize(preview->PAUSradial, preview->PAUSradial, size, 0, 0,
+               cv::INTER_LINEAR);
+    preview->PAUSradial_img = cvMatToQImage(preview->PAUSradial);
 
-  const bool flip = uspam::recon::ReconParams::flip(m_frameIdx);
+    emit previewReady(preview);
+    emit frameIdxChanged(m_frameIdx);
+
+    if (superseded()) {
+      return false;
+    }
+  }
+
+  const auto cancelled = [this] { return superseded(); };
+  const bool computeFWHM = m_fwhmEnabled;
+
+  // The frames update copies of the auto gain and temporal filter state,
+  // committed only if the frame is shown. A superseded frame doesn't move the
+  // smoothed estimate or enter the temporal history.
+  auto autoGainPA = m_autoGainPA;
+  auto autoGainUS = m_autoGainUS;
+  auto temporalPA = m_temporalPA; // Shares the frames, see TemporalFilter
+  auto temporalUS = m_temporalUS;
 
   constexpr bool USE_ASYNC = true;
   if constexpr (USE_ASYNC) {
-    auto a1 = std::async(std::launch::async, procOne<FloatType>,
-                         std::ref(paramsPA), std::ref(m_data->PA), flip);
-
-    auto a2 = std::async(std::launch::async, procOne<FloatType>,
-                         std::ref(paramsUS), std::ref(m_data->US), flip);
+    auto a1 = runOn(m_reconPool, [&, &params = paramsPA] {
+      return procOne<FloatType>(params, m_data->PA, m_frameIdx, flip,
+                                computeFWHM, autoGainPA, temporalPA,
+                                cancelled);
+    });
+
+    auto a2 = runOn(m_reconPool, [&, &params = paramsUS] {
+      return procOne<FloatType>(params, m_data->US, m_frameIdx, flip,
+                                computeFWHM, autoGainUS, temporalUS,
+                                cancelled);
+    });
 
     {
       const auto [beamform_ms, recon_ms, imageConversion_ms] = a1.get();
@@ -242,7 +641,9 @@ void DataProcWorker::processCurrentFrame() {
 
     {
       const auto [beamform_ms, recon_ms, imageConversion_ms] =
-          procOne<FloatType>(paramsPA, m_data->PA, flip);
+          procOne<FloatType>(paramsPA, m_data->PA, m_frameIdx, flip,
+                             computeFWHM, autoGainPA, temporalPA,
+                             cancelled);
       perfMetrics.beamform_ms = beamform_ms;
       perfMetrics.recon_ms = recon_ms;
       perfMetrics.imageConversion_ms = imageConversion_ms;
@@ -250,13 +651,24 @@ void DataProcWorker::processCurrentFrame() {
 
     {
       const auto [beamform_ms, recon_ms, imageConversion_ms] =
-          procOne<FloatType>(paramsUS, m_data->US, flip);
+          procOne<FloatType>(paramsUS, m_data->US, m_frameIdx, flip,
+                             computeFWHM, autoGainUS, temporalUS,
+                             cancelled);
       perfMetrics.beamform_ms += beamform_ms;
       perfMetrics.recon_ms += recon_ms;
       perfMetrics.imageConversion_ms += imageConversion_ms;
     }
   }
 
+  // Don't render a frame the user has already moved past
+  if (superseded()) {
+    return false;
+  }
+  m_autoGainPA = autoGainPA;
+  m_autoGainUS = autoGainUS;
+  m_temporalPA = std::move(temporalPA);
+  m_temporalUS = std::move(temporalUS);
+
   // Compute scalebar scalar
   // fct is the depth [m] of one radial pixel
   m_data->fct = [&] {
@@ -278,19 +690,86 @@ void DataProcWorker::processCurrentFrame() {
     return fctRadial;
   }();
 
+  // Lean mode: keep only the selected A-line of the intermediates
+  if (m_lean) {
+    const int selected = m_selectedAline;
+    for (auto *d : {&m_data->PA, &m_data->US}) {
+      const auto n = static_cast<int>(d->rfBeamformed.n_cols);
+      d->aline = d->perm.src(std::clamp(selected, 0, n - 1), n);
+      d->rf.reset();
+      d->rfBeamformed = arma::Mat<FloatType>(d->rfBeamformed.col(d->aline));
+      d->rfEnv = arma::Mat<FloatType>(d->rfEnv.col(d->aline));
+    }
+    m_data->rf = arma::Mat<FloatType>(m_data->rf.col(m_data->PA.aline));
+  }
+
   {
     const uspam::TimeIt timeit;
-    uspam::imutil::makeOverlay(m_data->US.radial, m_data->PA.radial,
-                               m_data->PAUSradial);
+    overlay.compose(m_data->US.radial, m_data->PA.radial,
+                    m_data->PAUSradial);
     perfMetrics.makeOverlay_ms = timeit.get_ms();
   }
 
   m_data->PAUSradial_img = cvMatToQImage(m_data->PAUSradial);
 
+  m_displaySize = m_data->PAUSradial.rows;
+  m_displayFct = m_data->fct;
+  if (m_frameIdx < static_cast<int>(m_haveThumbnail.size())) {
+    m_haveThumbnail[m_frameIdx] = true;
+    emit thumbnailReady(m_frameIdx, makeThumbnail(m_data->PAUSradial));
+  }
+
   // Send images to GUI thread
   emit resultReady(m_data);
   emit frameIdxChanged(m_frameIdx);
 
+  // Add the frame to the volume for views across frames. The volume is
+  // opened on the first frame of the binfile(s), when the shape is known, and
+  // again only if the shape changes. A failure is reported once.
+  if (m_volumeEnabled && !m_volumeFailed) {
+    const uspam::io::VolumeStore::Shape shape{
+        m_loader.size(),
+        static_cast<int>(m_data->PA.rfLog.n_cols),
+        {static_cast<int>(m_data->PA.rfLog.n_rows),
+         static_cast<int>(m_data->US.rfLog.n_rows)}};
+    if (!m_volume->isOpen() || m_volume->shape() != shape) {
+      const auto path = m_imageSaveDir / "volume.bin";
+      if (!m_volume->open(path, shape)) {
+        m_volumeFailed = true;
+        emit error(tr("Failed to open volume ") + path2QString(path));
+      }
+    }
+
+    using uspam::io::VolumeStore;
+    if (m_volume->isOpen() &&
+        m_volume->put(VolumeStore::PA, m_frameIdx, m_data->PA.rfLog,
+                      m_data->PA.perm) &&
+        m_volume->put(VolumeStore::US, m_frameIdx, m_data->US.rfLog,
+                      m_data->US.perm)) {
+      emit volumeUpdated(m_frameIdx);
+    }
+  } else if (!m_volumeEnabled && m_volume->isOpen()) {
+    m_volume->close();
+  }
+
+  // Send frame to the video sink. Encoding happens on the sink's thread
+  {
+    QMutexLocker lock(&m_videoMutex);
+    if (m_videoSink.isOpen()) {
+      switch (m_videoSource) {
+      case VideoExportSource::US:
+        m_videoSink.push(m_frameIdx, m_data->US.radial);
+        break;
+      case VideoExportSource::PA:
+        m_videoSink.push(m_frameIdx, m_data->PA.radial);
+        break;
+      case VideoExportSource::PAUS:
+      default:
+        m_videoSink.push(m_frameIdx, m_data->PAUSradial);
+      }
+    }
+  }
+
   // Save to file
   {
     const uspam::TimeIt timeit;
@@ -333,5 +812,14 @@ void DataProcWorker::processCurrentFrame() {
   QTextStream stream(&msg);
   stream << perfMetrics;
 
+  if (paramsPA.autoGain || paramsUS.autoGain) {
+    stream << QString(". Auto gain PA %1 mV/%2 dB, US %3 mV/%4 dB")
+                  .arg(m_data->PA.noiseFloor_mV, 0, 'f', 1)
+                  .arg(m_data->PA.dynamicRange, 0, 'f', 1)
+                  .arg(m_data->US.noiseFloor_mV, 0, 'f', 1)
+                  .arg(m_data->US.dynamicRange, 0, 'f', 1);
+  }
+
   emit error(msg);
+  return true;
 }
@@ -4,16 +4,34 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QObject>
+#include <QThreadPool>
 #include <QWaitCondition>
+#include <algorithm>
 #include <atomic>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <tuple>
+#include <uspam/binfileSequence.hpp>
+#include <uspam/enface.hpp>
+#include <uspam/fwhm.hpp>
 #include <uspam/io.hpp>
 #include <uspam/recon.hpp>
+#include <uspam/temporalFilter.hpp>
 #include <uspam/uspam.hpp>
+#include <uspam/videoSink.hpp>
+#include <uspam/volumeStore.hpp>
+#include <vector>
 
 namespace fs = std::filesystem;
 
+// Which image of the BScan to send to the video sink
+enum class VideoExportSource {
+  PAUS,
+  US,
+  PA,
+};
+
 struct PerformanceMetrics {
   float fileloader_ms{};
 
@@ -49,6 +67,32 @@ template <uspam::Floating T> struct BScanData_ {
   arma::Mat<T> rfEnv;
   arma::Mat<uint8_t> rfLog;
 
+  // In lean mode (aline >= 0) the intermediates are dropped after use: rf is
+  // empty and rfBeamformed and rfEnv only hold A-line `aline` (one column).
+  // rfLog is always complete.
+  int aline{-1};
+
+  // Params the frame was reconstructed with
+  uspam::recon::ReconParams params;
+
+  // The matrices above are in acquisition order. Column j of the images is
+  // A-line perm.src(j, n)
+  uspam::imutil::ColumnPermutation perm;
+
+  // Noise floor and dynamic range rfLog was compressed with (differ from the
+  // ReconParams if auto gain is on)
+  float noiseFloor_mV{};
+  float dynamicRange{};
+
+  // Axial FWHM of every A-line of rfEnv (empty unless the worker's FWHM is
+  // enabled), and the depth [mm] of one rfEnv row
+  std::vector<uspam::metrics::AlineFWHM> fwhm;
+  float mmPerEnvRow{};
+
+  // Max/mean projection of every A-line of rfLog over the en-face depth
+  // window (display order, like fwhm)
+  uspam::metrics::FrameProjection enface;
+
   // Images
   cv::Mat radial;
   QImage radial_img;
@@ -62,7 +106,7 @@ template <uspam::Floating T> struct BScanData_ {
  * `rf` will be overwritten, and cv::Mat and QImage have default constructors
  */
 template <uspam::Floating T> struct BScanData {
-  // RF data
+  // RF data. In lean mode only A-line PA.aline (one column)
   arma::Mat<T> rf;
 
   BScanData_<T> PA;
@@ -76,6 +120,12 @@ template <uspam::Floating T> struct BScanData {
 
   // Frame idx
   int frameIdx{};
+
+  // Scan direction of this frame (alternates within each binfile)
+  bool flip{};
+
+  // How the RF of this frame was split into PA and US (see loadFrame)
+  uspam::io::IOParams ioparams;
 };
 
 /**
@@ -87,9 +137,7 @@ class DataProcWorker : public QObject {
 public:
   using FloatType = float;
 
-  DataProcWorker()
-      : m_params(uspam::recon::ReconParams2::system2024v1()),
-        m_ioparams(uspam::io::IOParams::system2024v1()) {}
+  DataProcWorker();
 
   // Returns true if the worker is currently playing (sequentially processing)
   inline bool isPlaying() { return m_isPlaying; }
@@ -101,11 +149,18 @@ public slots:
   // Begin post processing data using the currentBinfile
   void setBinfile(const fs::path &binfile);
 
+  // Begin post processing a sequence of binfiles concatenated in order
+  void setBinfiles(const std::vector<fs::path> &binfiles);
+
   // Start processing frames sequentially
   // By default start playing at current frameIdx
   void play();
   // Process frame at idx.
   void playOne(int idx);
+  // Process the latest frame passed to requestFrame, if any. A preview is
+  // shown first, then refined to full quality unless a newer frame was
+  // requested in the meantime.
+  void processRequestedFrame();
   // Replay the current frame (without advancing the index)
   void replayOne();
 
@@ -120,8 +175,11 @@ public slots:
 
   // Reset the ReconParams and IOParams to the default
   void resetParams() {
+    QMutexLocker lock(&m_paramsMutex);
     m_ioparams = uspam::io::IOParams::system2024v1();
     m_params = uspam::recon::ReconParams2::system2024v1();
+    m_overlay = makeOverlayCompositor(m_params);
+    m_warmedUp = false;
   }
 
   // Save the ReconParams and IOParams to the image output directory
@@ -132,8 +190,61 @@ public slots:
     return this->m_imageSaveDir;
   }
 
+  // (thread safe) Start writing every processed frame to a video file.
+  // Frames are encoded on the sink's own thread.
+  bool startVideoExport(const fs::path &filename,
+                        const uspam::io::VideoSinkParams &params,
+                        VideoExportSource source = VideoExportSource::PAUS);
+
+  // (thread safe) Flush and close the video file. Returns the number of frames
+  // written.
+  int stopVideoExport();
+
+  // (thread safe)
+  bool isExportingVideo() const;
+
   void initDataBuffers();
 
+  // (thread safe) Ask for frame idx to be shown. Only the latest request is
+  // kept: a request made while another is pending replaces it, and a frame
+  // being processed is abandoned at the next stage boundary when a newer
+  // request arrives. Call this from the GUI thread instead of queueing a
+  // playOne per slider/key event.
+  void requestFrame(int idx);
+
+  // (thread safe) In lean mode only the A-line selected with setSelectedAline
+  // is kept of rf, rfBeamformed and rfEnv. Other A-lines are recomputed on
+  // request (see requestAline).
+  void setLeanMode(bool lean) { m_lean = lean; }
+  [[nodiscard]] bool leanMode() const { return m_lean; }
+
+  // (thread safe) Compute the FWHM of every A-line of full quality frames
+  // (BScanData_::fwhm). Off while nothing shows it.
+  void setFWHMEnabled(bool enabled) { m_fwhmEnabled = enabled; }
+
+  // (thread safe) A-line selected in the canvas (display order)
+  void setSelectedAline(int canvasIdx) { m_selectedAline = canvasIdx; }
+
+  // (thread safe) Recompute A-lines idxPA and idxUS (acquisition order) of a
+  // lean frame. The result is a copy of `data` sent with alineReady. Only the
+  // latest request is kept.
+  void requestAline(std::shared_ptr<BScanData<FloatType>> data, int idxPA,
+                    int idxUS);
+
+  // rfLog of the full quality frames of the current binfile(s), in
+  // imageSaveDir/volume.bin. Reading is thread safe.
+  [[nodiscard]] auto volume() const { return m_volume; }
+
+  // (thread safe) Store full quality frames in volume(). Off by default: the
+  // file takes frames x A-lines x (PA + US samples) bytes. Turning it off
+  // closes the volume.
+  void setVolumeEnabled(bool enabled) { m_volumeEnabled = enabled; }
+  [[nodiscard]] bool volumeEnabled() const { return m_volumeEnabled; }
+
+  // Build FFT plans/engines and FIR dispatch entries for the current IOParams
+  // on both recon threads, so the first frame doesn't stall on planning.
+  void warmup();
+
 signals:
   void maxFramesChanged(int);
   void frameIdxChanged(int);
@@ -141,28 +252,145 @@ signals:
   // pix2m is the depth [m] of each radial pixel
   void resultReady(std::shared_ptr<BScanData<FloatType>>);
 
+  // Low resolution images of a requested frame, upscaled to the size of the
+  // full quality images. Only the radial images, fct and frameIdx are set.
+  void previewReady(std::shared_ptr<BScanData<FloatType>>);
+
+  // A-lines recomputed for requestAline
+  void alineReady(std::shared_ptr<BScanData<FloatType>>);
+
+  // Small PAUS image of a frame. Previews of the whole sequence are made when
+  // the worker is idle.
+  void thumbnailReady(int frameIdx, QImage thumbnail);
+
+  // Frame frameIdx was added to volume()
+  void volumeUpdated(int frameIdx);
+
   void finishedPlaying();
   void error(QString err);
 
 private:
-  void processCurrentFrame();
+  // Returns false if the frame was superseded by a requestFrame and not shown
+  bool processCurrentFrame(bool previewFirst = false);
+
+  // PA, US recon params and the overlay a frame is processed with
+  using FrameParams =
+      std::tuple<uspam::recon::ReconParams, uspam::recon::ReconParams,
+                 uspam::imutil::OverlayCompositor>;
+
+  // Read frame idx into data.rf and split it into data.PA.rf and data.US.rf
+  // with the current ioparams
+  FrameParams loadFrame(int idx, BScanData<FloatType> &data,
+                        PerformanceMetrics &perfMetrics);
+
+  // Same with the given ioparams, stored in data.ioparams
+  void readFrame(int idx, const uspam::io::IOParams &ioparams,
+                 BScanData<FloatType> &data, PerformanceMetrics &perfMetrics);
+
+  // Preview of the frame in `data` (see uspam::recon::reconPreview)
+  std::shared_ptr<BScanData<FloatType>>
+  makePreview(const BScanData<FloatType> &data, const FrameParams &params,
+              bool flip) const;
+
+  void processRequestedAline();
+
+  // Preview the next frame without a thumbnail, then schedule the one after
+  void buildNextPreview();
+  void schedulePreviews();
+
+  static constexpr int NO_REQUEST = -1;
+
+  // Take the pending request (NO_REQUEST if none)
+  int takeRequestedFrame() {
+    return m_requestedFrame.exchange(NO_REQUEST, std::memory_order_acq_rel);
+  }
+  // True if a different frame was requested than the one being processed.
+  // A request for the same frame doesn't cancel it.
+  [[nodiscard]] bool superseded() const {
+    const auto idx = m_requestedFrame.load(std::memory_order_acquire);
+    return idx != NO_REQUEST && idx != m_frameIdx;
+  }
 
   int m_frameIdx{0};
+
+  // Single slot mailbox written by requestFrame, polled by the worker
+  std::atomic<int> m_requestedFrame{NO_REQUEST};
+
+  std::atomic<bool> m_lean{false};
+  std::atomic<bool> m_fwhmEnabled{false};
+  std::atomic<int> m_selectedAline{0};
+
+  struct AlineRequest {
+    std::shared_ptr<BScanData<FloatType>> data;
+    int idxPA{};
+    int idxUS{};
+  };
+  QMutex m_alineMutex;
+  std::optional<AlineRequest> m_alineRequest;
   std::atomic<bool> m_ready{false};
   std::atomic<bool> m_isPlaying{false};
 
-  // Post processing binfile
-  uspam::io::BinfileLoader<uint16_t> m_loader;
+  // Post processing binfile(s). m_binfilePath is the first file
+  uspam::io::BinfileSequence<uint16_t> m_loader;
+  std::vector<fs::path> m_binfilePaths;
   fs::path m_binfilePath;
   fs::path m_imageSaveDir;
 
   // Buffers;
   std::shared_ptr<BScanData<FloatType>> m_data;
 
+  // Radial image size and fct of the last full quality frame. Previews are
+  // upscaled to this size so the view doesn't jump.
+  int m_displaySize{};
+  double m_displayFct{};
+
+  // Frames that have a thumbnail, and where to look for the next one
+  std::vector<bool> m_haveThumbnail;
+  int m_nextThumbnail{};
+  bool m_previewsScheduled{false};
+
+  // Opened on the first frame of a binfile if m_volumeEnabled. Not retried
+  // after a failure until the next setBinfiles.
+  std::shared_ptr<uspam::io::VolumeStore> m_volume{
+      std::make_shared<uspam::io::VolumeStore>()};
+  std::atomic<bool> m_volumeEnabled{false};
+  bool m_volumeFailed{false};
+
   // mutex for ReconParams2 and IOParams
   QMutex m_paramsMutex;
   QWaitCondition m_waitCondition;
 
   uspam::recon::ReconParams2 m_params;
   uspam::io::IOParams m_ioparams;
+
+  // PAUS overlay table for the current m_params (also under m_paramsMutex)
+  static uspam::imutil::OverlayCompositor
+  makeOverlayCompositor(const uspam::recon::ReconParams2 &params) {
+    return uspam::imutil::OverlayCompositor(
+        static_cast<uint8_t>(std::clamp(params.overlayThreshold, 0, 255)),
+        params.overlayRamp);
+  }
+  uspam::imutil::OverlayCompositor m_overlay{makeOverlayCompositor(m_params)};
+
+  // Persistent threads for the PA and US recon. FFT engines are cached per
+  // thread, so the threads must outlive a frame (std::async may start a new
+  // thread for every call).
+  QThreadPool m_reconPool;
+  // Set by warmup() for the current m_ioparams, cleared when they're replaced
+  std::atomic<bool> m_warmedUp{false};
+
+  // Auto gain state (smoothed across frames) for each channel. Only touched
+  // by the recon task of its channel.
+  uspam::recon::AutoGain m_autoGainPA;
+  uspam::recon::AutoGain m_autoGainUS;
+
+  // Temporal filter history of each channel. Only touched by the recon task
+  // of its channel.
+  uspam::recon::TemporalFilter m_temporalPA;
+  uspam::recon::TemporalFilter m_temporalUS;
+
+  // Video export
+  mutable QMutex m_videoMutex;
+  uspam::io::VideoSink m_videoSink;
+  VideoExportSource m_videoSource{VideoExportSource::PAUS};
 };
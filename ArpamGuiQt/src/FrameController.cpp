@@ -2,26 +2,134 @@
 #include "AScanPlot.hpp"
 #include "CoregDisplay.hpp"
 #include "strConvUtils.hpp"
+#include <QCollator>
+#include <QComboBox>
+#include <QCoreApplication>
 #include <QDebug>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
 #include <QFileDialog>
+#include <QFormLayout>
 #include <QHBoxLayout>
+#include <QImage>
 #include <QKeySequence>
 #include <QLabel>
+#include <QLineEdit>
 #include <QMenu>
 #include <QMessageBox>
 #include <QPlainTextEdit>
+#include <QPointer>
 #include <QSlider>
 #include <QSpinBox>
+#include <QStringList>
+#include <QThreadPool>
 #include <QToolTip>
 #include <QVBoxLayout>
 #include <Qt>
+#include <algorithm>
 #include <cassert>
 #include <filesystem>
 #include <memory>
 #include <rapidjson/document.h>
 #include <rapidjson/rapidjson.h>
 #include <string>
+#include <uspam/binfileIndex.hpp>
 #include <uspam/json.hpp>
+#include <uspam/videoSink.hpp>
+
+namespace {
+
+struct VideoExportOptions {
+  fs::path filename;
+  uspam::io::VideoSinkParams params;
+  VideoExportSource source{VideoExportSource::PAUS};
+};
+
+// Dialog to select the output file and encoding params for video export.
+// Returns false if cancelled.
+bool getVideoExportOptions(QWidget *parent, VideoExportOptions &opts) {
+  QDialog dialog(parent);
+  dialog.setWindowTitle("Export video");
+  auto *layout = new QFormLayout(&dialog);
+
+  auto *pathEdit = new QLineEdit(path2QString(opts.filename));
+  {
+    auto *btn = new QPushButton("...");
+    QObject::connect(btn, &QPushButton::clicked, &dialog, [&] {
+      const auto fname = QFileDialog::getSaveFileName(
+          &dialog, "Export video", pathEdit->text(),
+          "Videos (*.avi *.mkv)");
+      if (!fname.isEmpty()) {
+        pathEdit->setText(fname);
+      }
+    });
+    auto *hlayout = new QHBoxLayout;
+    hlayout->addWidget(pathEdit);
+    hlayout->addWidget(btn);
+    layout->addRow("File", hlayout);
+  }
+
+  auto *sourceBox = new QComboBox;
+  sourceBox->addItem("PAUS", QVariant::fromValue(VideoExportSource::PAUS));
+  sourceBox->addItem("US", QVariant::fromValue(VideoExportSource::US));
+  sourceBox->addItem("PA", QVariant::fromValue(VideoExportSource::PA));
+  layout->addRow("Image", sourceBox);
+
+  using uspam::io::VideoCodec;
+  auto *codecBox = new QComboBox;
+  codecBox->addItem("MJPG (lossy)", QVariant::fromValue(VideoCodec::MJPG));
+  codecBox->addItem("FFV1 (lossless)", QVariant::fromValue(VideoCodec::FFV1));
+  layout->addRow("Codec", codecBox);
+
+  // NOLINTBEGIN(*-magic-numbers)
+  auto *fpsBox = new QDoubleSpinBox;
+  fpsBox->setRange(1.0, 120.0);
+  fpsBox->setValue(opts.params.fps);
+  layout->addRow("FPS", fpsBox);
+
+  auto *qualityBox = new QSpinBox;
+  qualityBox->setRange(0, 100);
+  qualityBox->setValue(opts.params.quality);
+  layout->addRow("Quality", qualityBox);
+  // NOLINTEND(*-magic-numbers)
+
+  auto *buttons =
+      new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+  QObject::connect(buttons, &QDialogButtonBox::accepted, &dialog,
+                   &QDialog::accept);
+  QObject::connect(buttons, &QDialogButtonBox::rejected, &dialog,
+                   &QDialog::reject);
+  layout->addRow(buttons);
+
+  if (dialog.exec() != QDialog::Accepted || pathEdit->text().isEmpty()) {
+    return false;
+  }
+
+  opts.filename = qString2Path(pathEdit->text());
+  opts.source = qvariant_cast<VideoExportSource>(sourceBox->currentData());
+  opts.params.codec = qvariant_cast<VideoCodec>(codecBox->currentData());
+  opts.params.fps = fpsBox->value();
+  opts.params.quality = qualityBox->value();
+  return true;
+}
+
+QString frameFlagsToString(uint32_t flags) {
+  using namespace uspam::io; // NOLINT(*-using-namespace)
+  QStringList reasons;
+  if ((flags & FRAME_FLAT) != 0) {
+    reasons << "flat (no signal)";
+  }
+  if ((flags & FRAME_SATURATED) != 0) {
+    reasons << "saturated";
+  }
+  if ((flags & FRAME_DUPLICATE) != 0) {
+    reasons << "duplicate of previous frame";
+  }
+  return reasons.join(", ");
+}
+
+} // namespace
 
 FrameController::FrameController(ReconParamsController *paramsController,
                                  DataProcWorker *worker, AScanPlot *ascanPlot,
@@ -35,7 +143,8 @@ FrameController::FrameController(ReconParamsController *paramsController,
       m_actOpenFileSelectDialog(new QAction("Open binfile")),
       m_actPlayPause(new QAction("Play/Pause")),
       m_actNextFrame(new QAction("Next Frame")),
-      m_actPrevFrame(new QAction("Prev Frame"))
+      m_actPrevFrame(new QAction("Prev Frame")),
+      m_actExportVideo(new QAction("Export video"))
 
 {
 
@@ -54,6 +163,13 @@ FrameController::FrameController(ReconParamsController *paramsController,
             plotCurrentBScan();
           });
 
+  // Preview while scrubbing. The full quality result follows
+  connect(worker, &DataProcWorker::previewReady, this,
+          [this](std::shared_ptr<BScanData<DataProcWorker::FloatType>> data) {
+            m_coregDisplay->imshow(data->PAUSradial_img, data->US.radial_img,
+                                   data->fct);
+          });
+
   // UI
   auto *vlayout = new QVBoxLayout;
   this->setLayout(vlayout);
@@ -78,10 +194,16 @@ FrameController::FrameController(ReconParamsController *paramsController,
         const auto val = m_frameSlider->value();
         QToolTip::showText(QCursor::pos(), QString::number(val));
         // m_frameNumSpinBox->setValue(val);
+
+        // Scrub while dragging. Stale requests are dropped by the worker
+        emit sigFrameNumUpdated(val);
       });
 
       connect(m_frameSlider, &QSlider::sliderReleased, this,
               [&] { emit sigFrameNumUpdated(m_frameSlider->value()); });
+
+      m_frameCountLabel = new QLabel;
+      hlayout->addWidget(m_frameCountLabel);
     }
 
     // Play/pause action and button
@@ -108,6 +230,54 @@ FrameController::FrameController(ReconParamsController *paramsController,
       m_menu->addAction(m_actNextFrame);
     }
 
+    // Video export action
+    {
+      m_menu->addSeparator();
+      m_actExportVideo->setCheckable(true);
+      connect(m_actExportVideo, &QAction::triggered, this,
+              &FrameController::toggleVideoExport);
+      m_menu->addAction(m_actExportVideo);
+    }
+
+    // Lean mode action
+    {
+      auto *actLeanMode = new QAction("Lean mode (recompute A-scans)", this);
+      actLeanMode->setCheckable(true);
+      actLeanMode->setToolTip(
+          "Only keep the selected A-line of the intermediate RF data of each "
+          "frame. Other A-lines are recomputed when selected.");
+      connect(actLeanMode, &QAction::toggled, this,
+              [this](bool checked) { m_worker->setLeanMode(checked); });
+      m_menu->addAction(actLeanMode);
+    }
+
+    // Volume store action
+    {
+      auto *actVolume = new QAction("Store volume (longitudinal view)", this);
+      actVolume->setCheckable(true);
+      actVolume->setChecked(m_worker->volumeEnabled());
+      actVolume->setToolTip(
+          "Write the log compressed frames to volume.bin in the image output "
+          "directory for the longitudinal view. The file is about frames x "
+          "A-lines x samples bytes.");
+      connect(actVolume, &QAction::toggled, this,
+              [this](bool checked) { m_worker->setVolumeEnabled(checked); });
+      m_menu->addAction(actVolume);
+    }
+
+    // Thumbnail overview of the sequence from the binfile index
+    {
+      m_thumbnailStrip = new ThumbnailStrip;
+      vlayout->addWidget(m_thumbnailStrip);
+
+      connect(m_thumbnailStrip, &ThumbnailStrip::frameSelected, this,
+              [this](int idx) {
+                updatePlayingState(false);
+                setFrameNum(idx);
+                emit sigFrameNumUpdated(idx);
+              });
+    }
+
     // Before a binfile is loaded, disable frame control
     m_frameSlider->setDisabled(true);
     m_btnPlayPause->setDisabled(true);
@@ -118,28 +288,35 @@ FrameController::FrameController(ReconParamsController *paramsController,
   // Frame controller signals
   {
 
-    // Action for when a new binfile is selected
-    connect(this, &FrameController::sigBinfileSelected,
-            [this](const QString &filepath) {
-              const auto pathUtf8 = filepath.toUtf8();
-              std::filesystem::path path(pathUtf8.constData());
+    // Action for when new binfile(s) are selected
+    connect(this, &FrameController::sigBinfilesSelected,
+            [this](const QStringList &filepaths) {
+              std::vector<fs::path> paths;
+              for (const auto &filepath : filepaths) {
+                paths.push_back(qString2Path(filepath));
+              }
 
-              // Worker: load file
-              QMetaObject::invokeMethod(m_worker, &DataProcWorker::setBinfile,
-                                        path);
+              // Worker: load file(s)
+              QMetaObject::invokeMethod(m_worker, &DataProcWorker::setBinfiles,
+                                        paths);
 
               // Update canvas dipslay
               {
-                const auto seq =
+                const auto &path = paths.front();
+                auto seq =
                     path2QString(path.parent_path().stem() / path.stem());
+                if (paths.size() > 1) {
+                  seq += QString(" (+%1 files)").arg(paths.size() - 1);
+                }
                 m_coregDisplay->setSequenceName(seq);
               }
             });
 
     // When frameController's changes it's frame number (through the drag bar
-    // or play), tell the worker to process the right image
-    connect(this, &FrameController::sigFrameNumUpdated, worker,
-            &DataProcWorker::playOne);
+    // or play), tell the worker to process the right image. Requests are
+    // coalesced in the worker so only the latest one is rendered.
+    connect(this, &FrameController::sigFrameNumUpdated, this,
+            [this](int idx) { m_worker->requestFrame(idx); });
 
     // Signal to start playing
     connect(this, &FrameController::sigPlay, this, [this] {
@@ -158,10 +335,21 @@ FrameController::FrameController(ReconParamsController *paramsController,
             [this](int maxIdx) {
               this->setMaxFrameNum(maxIdx);
               m_coregDisplay->setMaxIdx(maxIdx);
+              if (m_thumbnailStrip->numFrames() != maxIdx) {
+                m_thumbnailStrip->setNumFrames(maxIdx);
+              }
             });
 
+    // Thumbnails reconstructed by the worker replace the ones from the index
+    connect(m_worker, &DataProcWorker::thumbnailReady, m_thumbnailStrip,
+            &ThumbnailStrip::setThumbnail);
+
     connect(m_worker, &DataProcWorker::frameIdxChanged, this, [this](int idx) {
-      this->setFrameNum(idx);
+      // Don't pull the slider from under the user while scrubbing. The frame
+      // at release is set when it arrives.
+      if (!m_frameSlider->isSliderDown()) {
+        this->setFrameNum(idx);
+      }
       m_coregDisplay->setIdx(idx);
     });
 
@@ -173,27 +361,61 @@ FrameController::FrameController(ReconParamsController *paramsController,
   {
     connect(m_coregDisplay, &CoregDisplay::AScanSelected, m_AScanPlot,
             &AScanPlot::handleAScanSelected);
+
+    // The A-line kept by the worker in lean mode
+    connect(m_coregDisplay, &CoregDisplay::AScanSelected, this,
+            [this](int idx) { m_worker->setSelectedAline(idx); });
+  }
+
+  // A-line recompute for lean frames
+  {
+    connect(m_AScanPlot, &AScanPlot::alineRequested, this,
+            [this](std::shared_ptr<BScanData<DataProcWorker::FloatType>> data,
+                   int idxPA, int idxUS) {
+              m_worker->requestAline(std::move(data), idxPA, idxUS);
+            });
+    connect(m_worker, &DataProcWorker::alineReady, m_AScanPlot,
+            &AScanPlot::setAlineData);
   }
 }
 
 void FrameController::openFileSelectDialog() {
-  const QString filename = QFileDialog::getOpenFileName(
-      this, tr("Open Bin File"), QString(), tr("Binfiles (*.bin)"));
+  // Selecting several files opens them as one sequence
+  const QStringList filenames = QFileDialog::getOpenFileNames(
+      this, tr("Open Bin File(s)"), QString(), tr("Binfiles (*.bin)"));
 
-  acceptNewBinfile(filename);
+  acceptNewBinfiles(filenames);
 }
 
 void FrameController::acceptNewBinfile(const QString &filename) {
+  acceptNewBinfiles(filename.isEmpty() ? QStringList{}
+                                       : QStringList{filename});
+}
+
+void FrameController::acceptNewBinfiles(QStringList filenames) {
+  if (filenames.isEmpty()) {
+    return;
+  }
+
   // Update GUI
   updatePlayingState(false);
 
+  QCollator collator;
+  collator.setNumericMode(true);
+  std::sort(filenames.begin(), filenames.end(), collator);
+
   // Emit signal
-  if (!filename.isEmpty()) {
-    emit sigBinfileSelected(filename);
+  emit sigBinfilesSelected(filenames);
+
+  m_binPaths.clear();
+  for (const auto &filename : filenames) {
+    m_binPaths.push_back(qString2Path(filename));
   }
+  loadBinfileIndex(m_binPaths);
 
-  // Try to load the annotation file
-  m_binPath = qString2Path(filename);
+  // Try to load the annotation file. For a sequence, annotations are stored
+  // next to the first file with global frame indices.
+  m_binPath = m_binPaths.front();
   m_annoPath = m_binPath.parent_path() /
                (m_binPath.stem().string() + "_annotations.json");
 
@@ -226,6 +448,7 @@ void FrameController::setFrameNum(int frame) {
   // Update GUI
   // m_frameNumSpinBox->setValue(frame);
   m_frameSlider->setValue(frame);
+  m_thumbnailStrip->setCurrentFrame(frame);
 }
 
 int FrameController::maxFrameNum() const {
@@ -296,3 +519,138 @@ void FrameController::plotCurrentBScan() {
   m_coregDisplay->imshow(m_data->PAUSradial_img, m_data->US.radial_img,
                          m_data->fct);
 }
+
+void FrameController::toggleVideoExport(bool start) {
+  if (!start) {
+    // Encoding happens on the sink's thread, so closing only has to flush the
+    // remaining queued frames.
+    const auto nFrames = m_worker->stopVideoExport();
+    emit message(QString("Video export finished: %1 frames").arg(nFrames));
+    m_actExportVideo->setChecked(false);
+    return;
+  }
+
+  VideoExportOptions opts;
+  opts.filename = m_worker->getImageSaveDir() / "PAUS.avi";
+  if (!getVideoExportOptions(this, opts)) {
+    m_actExportVideo->setChecked(false);
+    return;
+  }
+
+  if (!m_worker->startVideoExport(opts.filename, opts.params, opts.source)) {
+    emit message("Failed to start video export");
+    m_actExportVideo->setChecked(false);
+    return;
+  }
+
+  emit message(QString("Exporting video to %1. Play the sequence to record, "
+                       "toggle the action again to finish.")
+                   .arg(path2QString(opts.filename)));
+}
+
+void FrameController::loadBinfileIndex(const std::vector<fs::path> &binfiles) {
+  m_thumbnailStrip->setNumFrames(0);
+  m_frameCountLabel->setText("Indexing...");
+
+  // Building an index reads the whole binfile once (in parallel). After that
+  // the sidecar file is only memory mapped.
+  const auto byteOffset = m_reconParams->ioparams.byte_offset;
+  // The controller may be destroyed while a large file is indexed: the
+  // result is posted to the application object and dropped if `self` is gone.
+  QThreadPool::globalInstance()->start([self = QPointer<FrameController>(this),
+                                        binfiles, byteOffset] {
+    auto indices = std::make_shared<std::vector<uspam::io::BinfileIndex>>(
+        binfiles.size());
+    fs::path failed;
+    for (size_t i = 0; i < binfiles.size(); ++i) {
+      if (!(*indices)[i].open(binfiles[i], byteOffset)) {
+        failed = binfiles[i];
+        break;
+      }
+    }
+
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [self, binfiles, failed, indices] {
+          // Destroyed, or different binfiles were selected in the meantime
+          if (self.isNull() || binfiles != self->m_binPaths) {
+            return;
+          }
+          if (!failed.empty()) {
+            self->m_frameCountLabel->clear();
+            emit self->message(QString("Failed to index binfile %1")
+                                   .arg(path2QString(failed)));
+            return;
+          }
+          self->showBinfileIndex(*indices);
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void FrameController::showBinfileIndex(
+    const std::vector<uspam::io::BinfileIndex> &indices) {
+  int numFrames = 0;
+  for (const auto &index : indices) {
+    numFrames += index.size();
+  }
+
+  auto label = QString("%1 frames").arg(numFrames);
+  if (indices.size() > 1) {
+    label += QString(" in %1 files").arg(indices.size());
+  }
+  m_frameCountLabel->setText(label);
+  if (numFrames > 0) {
+    setMaxFrameNum(numFrames);
+    m_coregDisplay->setMaxIdx(numFrames);
+  }
+
+  // The worker may have sent thumbnails already
+  if (m_thumbnailStrip->numFrames() != numFrames) {
+    m_thumbnailStrip->setNumFrames(numFrames);
+  }
+
+  QStringList warnings;
+  int flaggedCount = 0;
+  int start = 0; // Global index of the first frame in the current file
+  for (size_t f = 0; f < indices.size(); ++f) {
+    const auto &index = indices[f];
+    const auto &header = index.header();
+
+    // Thumbnails. Copied since the index is unmapped after this returns
+    for (int i = 0; i < index.size(); ++i) {
+      if (m_thumbnailStrip->hasThumbnail(start + i)) {
+        continue;
+      }
+      const auto thumb = index.thumbnail(i);
+      const QImage img(thumb.data(), header.thumbWidth, header.thumbHeight,
+                       header.thumbWidth, QImage::Format_Grayscale8);
+      m_thumbnailStrip->setThumbnail(start + i, img.copy());
+    }
+
+    // Integrity warnings
+    for (const auto idx : index.flaggedFrames()) {
+      const auto reason = frameFlagsToString(index.entry(idx).flags);
+      m_thumbnailStrip->setFrameWarning(start + idx, reason);
+      warnings << QString("  Frame %1: %2").arg(start + idx).arg(reason);
+      ++flaggedCount;
+    }
+
+    if (header.trailingBytes > 0) {
+      warnings << QString("  %1 is truncated. %2 bytes after the last "
+                          "complete frame are ignored.")
+                      .arg(path2QString(m_binPaths[f].filename()))
+                      .arg(header.trailingBytes);
+    }
+
+    start += index.size();
+  }
+  m_thumbnailStrip->setCurrentFrame(frameNum());
+
+  if (!warnings.isEmpty()) {
+    emit message(QString("Warning: %1 of %2 frames may be corrupt\n%3")
+                     .arg(flaggedCount)
+                     .arg(numFrames)
+                     .arg(warnings.join("\n")));
+  }
+}
@@ -4,15 +4,20 @@
 #include "CoregDisplay.hpp"
 #include "DataProcWorker.hpp"
 #include "ReconParamsController.hpp"
+#include "ThumbnailStrip.hpp"
 #include <Annotation/AnnotationJsonFile.hpp>
 #include <QAction>
+#include <QLabel>
 #include <QMenu>
 #include <QPushButton>
 #include <QSlider>
 #include <QSpinBox>
 #include <QString>
+#include <QStringList>
 #include <memory>
+#include <vector>
 #include <rapidjson/document.h>
+#include <uspam/binfileIndex.hpp>
 
 class FrameController : public QWidget {
   Q_OBJECT
@@ -33,6 +38,10 @@ public slots:
   // Accept a binfile
   void acceptNewBinfile(const QString &filename);
 
+  // Accept several binfiles to be played as one continuous sequence. They are
+  // sorted by name (numerically, so "scan_10" comes after "scan_9").
+  void acceptNewBinfiles(QStringList filenames);
+
   [[nodiscard]] int frameNum() const;
   void setFrameNum(int frameNum);
 
@@ -47,10 +56,13 @@ public slots:
 
   void plotCurrentBScan();
 
+  // Start/stop writing processed frames to a video file
+  void toggleVideoExport(bool start);
+
 signals:
   void message(QString);
   void statusMessage(QString message, int timeout = 0);
-  void sigBinfileSelected(QString);
+  void sigBinfilesSelected(QStringList);
   void sigPlay();
   void sigPause();
   void sigFrameNumUpdated(int);
@@ -62,6 +74,11 @@ private:
   void saveFrameAnnotationsFromModelToDoc(int frame);
   void loadFrameAnnotationsFromDocToModel(int frame);
 
+  // Build/load the binfiles' sidecar indices on the thread pool, then show
+  // the frame count, thumbnails and integrity warnings.
+  void loadBinfileIndex(const std::vector<fs::path> &binfiles);
+  void showBinfileIndex(const std::vector<uspam::io::BinfileIndex> &indices);
+
   ReconParamsController *m_reconParams;
   DataProcWorker *m_worker;
 
@@ -74,6 +91,8 @@ private:
   // UI elements
   QPushButton *m_btnPlayPause;
   QSlider *m_frameSlider;
+  QLabel *m_frameCountLabel;
+  ThumbnailStrip *m_thumbnailStrip;
   bool m_isPlaying{false};
 
   // Actions
@@ -82,6 +101,7 @@ private:
   QAction *m_actPlayPause;
   QAction *m_actNextFrame;
   QAction *m_actPrevFrame;
+  QAction *m_actExportVideo;
 
   // Bscan Data. Processing is done in the worker, and a pointer of the current
   // result is stored here
@@ -90,7 +110,8 @@ private:
   // Annotation JSON document
   annotation::AnnotationJsonFile m_doc;
 
-  // Binfile path
+  // Binfile path (first file of the sequence) and all files in the sequence
   fs::path m_binPath;
+  std::vector<fs::path> m_binPaths;
   fs::path m_annoPath;
 };
@@ -0,0 +1,101 @@
+#include "LongitudinalView.hpp"
+#include <QHBoxLayout>
+#include <QImage>
+#include <QPixmap>
+#include <QVBoxLayout>
+#include <opencv2/opencv.hpp>
+#include <utility>
+
+// NOLINTBEGIN(*-magic-numbers)
+
+LongitudinalView::LongitudinalView(
+    std::shared_ptr<uspam::io::VolumeStore> volume, QWidget *parent)
+    : QWidget(parent), m_volume(std::move(volume)), m_channel(new QComboBox),
+      m_aline(new QSpinBox), m_image(new QLabel) {
+  auto *layout = new QVBoxLayout;
+  setLayout(layout);
+
+  {
+    auto *hlayout = new QHBoxLayout;
+    layout->addLayout(hlayout);
+
+    m_channel->addItem("US");
+    m_channel->addItem("PA");
+    hlayout->addWidget(m_channel);
+    connect(m_channel, &QComboBox::currentIndexChanged, this,
+            &LongitudinalView::scheduleRender);
+
+    hlayout->addWidget(new QLabel("A-line"));
+    m_aline->setRange(0, 0);
+    m_aline->setWrapping(true);
+    m_aline->setToolTip("A-line (display order) the cut goes through. Also "
+                        "set by selecting an A-line in the image.");
+    hlayout->addWidget(m_aline);
+    connect(m_aline, &QSpinBox::valueChanged, this,
+            &LongitudinalView::scheduleRender);
+
+    hlayout->addStretch();
+  }
+
+  m_image->setScaledContents(true);
+  m_image->setMinimumSize(100, 100);
+  m_image->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+  m_image->setToolTip("x: frame, y: depth along the selected A-line (below "
+                      "the centre) and the opposite one (above).");
+  layout->addWidget(m_image, 1);
+
+  m_renderTimer.setSingleShot(true);
+  m_renderTimer.setInterval(0);
+  connect(&m_renderTimer, &QTimer::timeout, this, &LongitudinalView::render);
+}
+
+void LongitudinalView::setAline(int idx) {
+  // The range is only known once the volume has frames
+  const auto numAlines = m_volume->shape().numAlines;
+  if (numAlines > 0) {
+    m_aline->setMaximum(numAlines - 1);
+  }
+  m_aline->setValue(idx);
+}
+
+void LongitudinalView::frameAdded(int frameIdx) {
+  m_currentFrame = frameIdx;
+  scheduleRender();
+}
+
+void LongitudinalView::render() {
+  const auto shape = m_volume->shape();
+  if (shape.numAlines <= 0) {
+    m_image->clear();
+    return;
+  }
+  m_aline->setMaximum(shape.numAlines - 1);
+
+  const auto ch = m_channel->currentIndex() == 1 ? uspam::io::VolumeStore::PA
+                                                 : uspam::io::VolumeStore::US;
+  const cv::Mat cut = m_volume->longitudinal(ch, m_aline->value());
+  if (cut.empty()) {
+    m_image->clear();
+    return;
+  }
+
+  // Frames along x
+  cv::Mat gray;
+  cv::transpose(cut, gray);
+  cv::Mat bgr;
+  if (ch == uspam::io::VolumeStore::PA) {
+    cv::applyColorMap(gray, bgr, cv::COLORMAP_HOT);
+  } else {
+    cv::cvtColor(gray, bgr, cv::COLOR_GRAY2BGR);
+  }
+
+  if (m_currentFrame >= 0 && m_currentFrame < bgr.cols) {
+    bgr.col(m_currentFrame).setTo(cv::Scalar(0, 255, 255));
+  }
+
+  QImage img(bgr.data, bgr.cols, bgr.rows, static_cast<qsizetype>(bgr.step),
+             QImage::Format_BGR888);
+  m_image->setPixmap(QPixmap::fromImage(img));
+}
+
+// NOLINTEND(*-magic-numbers)
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QComboBox>
+#include <QLabel>
+#include <QSpinBox>
+#include <QTimer>
+#include <QWidget>
+#include <memory>
+#include <uspam/volumeStore.hpp>
+
+/**
+Longitudinal (L-mode) cut through all frames of a pullback: the selected
+A-line and the opposite one, frames along x and depth along y with the
+catheter in the middle. Frames not processed yet are black, and the current
+frame is marked with a yellow line.
+
+The cut is read from the worker's volume store, so it grows as frames are
+processed and spans the whole sequence without keeping the frames in memory.
+Frames are only stored while "Store volume" is checked in the Frames menu.
+*/
+class LongitudinalView : public QWidget {
+  Q_OBJECT
+public:
+  explicit LongitudinalView(std::shared_ptr<uspam::io::VolumeStore> volume,
+                            QWidget *parent = nullptr);
+
+public slots:
+  // A-line (display order) the cut goes through
+  void setAline(int idx);
+
+  // Frame frameIdx was added to the volume (and is the current frame)
+  void frameAdded(int frameIdx);
+
+private:
+  // Render at most once per event loop pass, however many frames came in
+  void scheduleRender() { m_renderTimer.start(); }
+  void render();
+
+  std::shared_ptr<uspam::io::VolumeStore> m_volume;
+  int m_currentFrame{-1};
+
+  QComboBox *m_channel;
+  QSpinBox *m_aline;
+  QLabel *m_image;
+  QTimer m_renderTimer;
+};
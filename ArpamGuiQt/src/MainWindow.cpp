@@ -15,12 +15,15 @@
 #include <QScrollArea>
 #include <QSizePolicy>
 #include <QSlider>
+#include <QStringList>
 #include <QTabWidget>
+#include <QUrl>
 #include <QVBoxLayout>
 #include <QWidget>
 #include <Qt>
 #include <QtDebug>
 #include <QtLogging>
+#include <algorithm>
 #include <opencv2/opencv.hpp>
 #include <uspam/defer.h>
 #include <utility>
@@ -45,7 +48,9 @@ MainWindow::MainWindow(QWidget *parent)
       m_AScanPlot(new AScanPlot(reconParamsController)),
       m_coregDisplay(new CoregDisplay(m_AScanPlot)),
       m_frameController(new FrameController(reconParamsController, worker,
-                                            m_AScanPlot, m_coregDisplay))
+                                            m_AScanPlot, m_coregDisplay)),
+      m_fwhmMap(new FWHMMap), m_enfaceView(new EnFaceView),
+      m_longitudinalView(new LongitudinalView(worker->volume()))
 
 {
   menuBar()->addMenu(m_frameController->frameMenu());
@@ -182,6 +187,52 @@ MainWindow::MainWindow(QWidget *parent)
     m_viewMenu->addAction(dock->toggleViewAction());
 
     dock->setWidget(m_AScanPlot);
+
+    // FWHM map, tabified with the AScan plot
+    auto *fwhmDock = new QDockWidget("FWHM Map", this);
+    this->addDockWidget(Qt::RightDockWidgetArea, fwhmDock);
+    m_viewMenu->addAction(fwhmDock->toggleViewAction());
+    this->tabifyDockWidget(dock, fwhmDock);
+    dock->raise();
+
+    fwhmDock->setWidget(m_fwhmMap);
+
+    connect(worker, &DataProcWorker::maxFramesChanged, m_fwhmMap,
+            &FWHMMap::setNumFrames);
+    connect(worker, &DataProcWorker::resultReady, m_fwhmMap,
+            &FWHMMap::setData);
+    connect(m_fwhmMap, &FWHMMap::message, this, &MainWindow::logError);
+    // Only compute the FWHM while the map is shown
+    connect(fwhmDock, &QDockWidget::visibilityChanged, this,
+            [this](bool visible) { worker->setFWHMEnabled(visible); });
+
+    // En-face map, tabified with the FWHM map
+    auto *enfaceDock = new QDockWidget("En-face", this);
+    this->addDockWidget(Qt::RightDockWidgetArea, enfaceDock);
+    m_viewMenu->addAction(enfaceDock->toggleViewAction());
+    this->tabifyDockWidget(fwhmDock, enfaceDock);
+
+    enfaceDock->setWidget(m_enfaceView);
+
+    connect(worker, &DataProcWorker::maxFramesChanged, m_enfaceView,
+            &EnFaceView::setNumFrames);
+    connect(worker, &DataProcWorker::resultReady, m_enfaceView,
+            &EnFaceView::setData);
+    connect(m_enfaceView, &EnFaceView::message, this, &MainWindow::logError);
+
+    // Longitudinal cut, tabified with the FWHM map
+    auto *lDock = new QDockWidget("Longitudinal", this);
+    this->addDockWidget(Qt::RightDockWidgetArea, lDock);
+    m_viewMenu->addAction(lDock->toggleViewAction());
+    this->tabifyDockWidget(fwhmDock, lDock);
+    dock->raise();
+
+    lDock->setWidget(m_longitudinalView);
+
+    connect(worker, &DataProcWorker::volumeUpdated, m_longitudinalView,
+            &LongitudinalView::frameAdded);
+    connect(m_coregDisplay, &CoregDisplay::AScanSelected, m_longitudinalView,
+            &LongitudinalView::setAline);
   }
 
   auto *fullscreenAction = new QAction("Full Screen");
@@ -227,14 +278,13 @@ void MainWindow::dragEnterEvent(QDragEnterEvent *event) {
   const auto *mimeData = event->mimeData();
   if (mimeData->hasUrls()) {
     const auto &urls = mimeData->urls();
-    // Only allow dropping a single file
-    if (urls.size() == 1) {
-      const auto filepath = urls[0].toLocalFile();
-
-      // Only allow a specific extension
-      if (filepath.endsWith(".bin")) {
-        event->acceptProposedAction();
-      }
+    // Only allow binfiles. Several files are opened as one sequence
+    const bool allBinfiles =
+        std::all_of(urls.cbegin(), urls.cend(), [](const QUrl &url) {
+          return url.toLocalFile().endsWith(".bin");
+        });
+    if (!urls.isEmpty() && allBinfiles) {
+      event->acceptProposedAction();
     }
   }
 }
@@ -242,9 +292,11 @@ void MainWindow::dragEnterEvent(QDragEnterEvent *event) {
 void MainWindow::dropEvent(QDropEvent *event) {
   const auto *mimeData = event->mimeData();
   if (mimeData->hasUrls()) {
-    const auto &urls = mimeData->urls();
-    const auto filepath = urls[0].toLocalFile();
-    m_frameController->acceptNewBinfile(filepath);
+    QStringList filepaths;
+    for (const auto &url : mimeData->urls()) {
+      filepaths << url.toLocalFile();
+    }
+    m_frameController->acceptNewBinfiles(filepaths);
 
     event->acceptProposedAction();
   }
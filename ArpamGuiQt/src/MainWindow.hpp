@@ -4,6 +4,9 @@
 #include "CoregDisplay.hpp"
 #include "DataProcWorker.hpp"
 #include "FrameController.hpp"
+#include "LongitudinalView.hpp"
+#include "Metrics/EnFaceView.hpp"
+#include "Metrics/FWHMMap.hpp"
 #include <QAction>
 #include <QActionGroup>
 #include <QContextMenuEvent>
@@ -55,4 +58,10 @@ private:
   CoregDisplay *m_coregDisplay;
   // Controller
   FrameController *m_frameController;
+  // Axial FWHM of all A-lines/frames
+  FWHMMap *m_fwhmMap;
+  // En-face MIP/mean/depth of max of all A-lines/frames
+  EnFaceView *m_enfaceView;
+  // Longitudinal cut through all frames
+  LongitudinalView *m_longitudinalView;
 };
@@ -0,0 +1,47 @@
+#include "Metrics/EnFaceView.hpp"
+#include <cmath>
+#include <opencv2/opencv.hpp>
+
+// NOLINTBEGIN(*-magic-numbers)
+
+EnFaceView::EnFaceView(QWidget *parent)
+    : FrameMapView({"En-face", "enface.npy", true,
+                    "x: A-line, y: frame. Black: not processed yet. The "
+                    "depth window is set in the recon parameters."},
+                   parent),
+      m_field(new QComboBox) {
+  setTables(&m_PA, &m_US);
+
+  using Field = uspam::metrics::EnFaceMap::Field;
+  m_field->addItem("Max (MIP)", static_cast<int>(Field::Max));
+  m_field->addItem("Mean", static_cast<int>(Field::Mean));
+  m_field->addItem("Depth of max", static_cast<int>(Field::DepthOfMax));
+  addControl(m_field);
+  connect(m_field, &QComboBox::currentIndexChanged, this,
+          &EnFaceView::scheduleRender);
+}
+
+bool EnFaceView::addFrame(Channel ch,
+                          const BScanData_<DataProcWorker::FloatType> &data,
+                          int frameIdx) {
+  auto &map = ch == Channel::PA ? m_PA : m_US;
+  const auto &alines = data.enface.alines;
+  map.fit(numFrames(), static_cast<int>(alines.size()), frameIdx);
+  map.setFrame(frameIdx, alines, data.enface.mmPerRow);
+  return true;
+}
+
+EnFaceView::Style EnFaceView::style(Channel ch) const {
+  using Field = uspam::metrics::EnFaceMap::Field;
+  const auto field = static_cast<Field>(m_field->currentData().toInt());
+
+  // Intensities are already 0-255. Depths are scaled to the deepest max.
+  if (field == Field::DepthOfMax) {
+    const float maxDepth = table(ch).max(field);
+    const float scale = maxDepth > 0 ? 255.0F / maxDepth : 1.0F;
+    return {field, scale, cv::COLORMAP_JET};
+  }
+  return {field, 1.0F, ch == Channel::PA ? cv::COLORMAP_HOT : -1};
+}
+
+// NOLINTEND(*-magic-numbers)
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Metrics/FrameMapView.hpp"
+#include <QComboBox>
+#include <uspam/enface.hpp>
+
+/**
+En-face map (A-line x frame) of the maximum intensity, mean intensity or
+depth of the maximum of every A-line over the en-face depth window
+(ReconParams::enfaceDepthBegin_mm), filled in as frames are processed. The
+current frame is marked with a white line. The maps can be exported to CSV
+or NPY.
+*/
+class EnFaceView : public FrameMapView {
+  Q_OBJECT
+public:
+  explicit EnFaceView(QWidget *parent = nullptr);
+
+protected:
+  bool addFrame(Channel ch, const BScanData_<DataProcWorker::FloatType> &data,
+                int frameIdx) override;
+  [[nodiscard]] Style style(Channel ch) const override;
+
+private:
+  uspam::metrics::EnFaceMap m_PA;
+  uspam::metrics::EnFaceMap m_US;
+
+  QComboBox *m_field;
+};
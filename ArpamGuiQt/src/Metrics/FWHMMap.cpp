@@ -0,0 +1,78 @@
+#include "Metrics/FWHMMap.hpp"
+#include <QLabel>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// NOLINTBEGIN(*-magic-numbers)
+
+FWHMMap::FWHMMap(QWidget *parent)
+    : FrameMapView({"FWHM", "fwhm.csv", false,
+                    "x: A-line, y: frame, color: axial FWHM. Black: no "
+                    "data or no half max crossing inside the A-line."},
+                   parent),
+      m_maxWidth(new QDoubleSpinBox) {
+  setTables(&m_PA, &m_US);
+  setChannel(Channel::US);
+
+  addControl(new QLabel("Color max"));
+  m_maxWidth->setRange(0.01, 5.0);
+  m_maxWidth->setSingleStep(0.05);
+  m_maxWidth->setDecimals(2);
+  m_maxWidth->setValue(0.5);
+  m_maxWidth->setSuffix(" mm");
+  addControl(m_maxWidth);
+  connect(m_maxWidth, &QDoubleSpinBox::valueChanged, this,
+          &FWHMMap::scheduleRender);
+}
+
+bool FWHMMap::addFrame(Channel ch,
+                       const BScanData_<DataProcWorker::FloatType> &data,
+                       int frameIdx) {
+  // Not computed while the map is hidden
+  if (data.fwhm.empty()) {
+    return false;
+  }
+  auto &table = ch == Channel::PA ? m_PA : m_US;
+  table.fit(numFrames(), static_cast<int>(data.fwhm.size()), frameIdx);
+  table.setFrame(frameIdx, data.fwhm, data.mmPerEnvRow);
+  return true;
+}
+
+FWHMMap::Style FWHMMap::style(Channel /*ch*/) const {
+  const auto maxWidth = static_cast<float>(m_maxWidth->value());
+  return {uspam::metrics::FWHMTable::Width, 255.0F / maxWidth,
+          cv::COLORMAP_JET};
+}
+
+QString FWHMMap::stats(Channel ch) const {
+  const auto &table = this->table(ch);
+  const int frame = currentFrame();
+  if (frame < 0 || frame >= table.numFrames()) {
+    return {};
+  }
+
+  std::vector<float> widths;
+  widths.reserve(table.numAlines());
+  for (int j = 0; j < table.numAlines(); ++j) {
+    const float w = table.get(frame, j, uspam::metrics::FWHMTable::Width);
+    if (!std::isnan(w)) {
+      widths.push_back(w);
+    }
+  }
+  if (widths.empty()) {
+    return {};
+  }
+
+  const auto mid = widths.begin() + widths.size() / 2;
+  std::nth_element(widths.begin(), mid, widths.end());
+  return QString("Frame %1: median FWHM %2 %3 (%4/%5 A-lines)")
+      .arg(frame)
+      .arg(*mid, 0, 'f', 3)
+      .arg(QString::fromStdString(table.unit()))
+      .arg(static_cast<int>(widths.size()))
+      .arg(table.numAlines());
+}
+
+// NOLINTEND(*-magic-numbers)
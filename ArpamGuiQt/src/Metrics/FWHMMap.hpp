@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Metrics/FrameMapView.hpp"
+#include <QDoubleSpinBox>
+#include <uspam/fwhm.hpp>
+
+/**
+Heat map of the axial FWHM of every A-line (x) of every processed frame (y),
+for resolution characterisation. The current frame is marked with a white
+line. The tables can be exported to CSV or NPY.
+*/
+class FWHMMap : public FrameMapView {
+  Q_OBJECT
+public:
+  explicit FWHMMap(QWidget *parent = nullptr);
+
+protected:
+  bool addFrame(Channel ch, const BScanData_<DataProcWorker::FloatType> &data,
+                int frameIdx) override;
+  [[nodiscard]] Style style(Channel ch) const override;
+  [[nodiscard]] QString stats(Channel ch) const override;
+
+private:
+  uspam::metrics::FWHMTable m_PA;
+  uspam::metrics::FWHMTable m_US;
+
+  QDoubleSpinBox *m_maxWidth;
+};
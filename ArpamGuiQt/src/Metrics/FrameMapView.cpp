@@ -0,0 +1,187 @@
+#include "Metrics/FrameMapView.hpp"
+#include "strConvUtils.hpp"
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QPixmap>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <utility>
+
+// NOLINTBEGIN(*-magic-numbers)
+
+FrameMapView::FrameMapView(Options options, QWidget *parent)
+    : QWidget(parent), m_options(std::move(options)),
+      m_controls(new QHBoxLayout), m_channel(new QComboBox),
+      m_image(new QLabel), m_stats(new QLabel) {
+  auto *layout = new QVBoxLayout;
+  setLayout(layout);
+
+  {
+    layout->addLayout(m_controls);
+
+    m_channel->addItem("PA", static_cast<int>(Channel::PA));
+    m_channel->addItem("US", static_cast<int>(Channel::US));
+    m_controls->addWidget(m_channel);
+    connect(m_channel, &QComboBox::currentIndexChanged, this,
+            &FrameMapView::scheduleRender);
+
+    auto *btn = new QPushButton("Export...");
+    m_controls->addWidget(btn);
+    connect(btn, &QPushButton::clicked, this, &FrameMapView::exportTables);
+
+    m_controls->addStretch();
+  }
+
+  m_image->setScaledContents(true);
+  m_image->setMinimumSize(100, 100);
+  m_image->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+  m_image->setToolTip(m_options.tooltip);
+  layout->addWidget(m_image, 1);
+  layout->addWidget(m_stats);
+  m_stats->hide();
+
+  m_renderTimer.setSingleShot(true);
+  m_renderTimer.setInterval(0);
+  connect(&m_renderTimer, &QTimer::timeout, this, &FrameMapView::render);
+}
+
+void FrameMapView::addControl(QWidget *widget) {
+  // Before the export button and the stretch
+  m_controls->insertWidget(m_controls->count() - 2, widget);
+}
+
+FrameMapView::Channel FrameMapView::channel() const {
+  return static_cast<Channel>(m_channel->currentData().toInt());
+}
+
+void FrameMapView::setChannel(Channel ch) {
+  m_channel->setCurrentIndex(m_channel->findData(static_cast<int>(ch)));
+}
+
+void FrameMapView::scheduleRender() {
+  // showEvent renders a hidden map when it's shown again
+  if (isVisible()) {
+    m_renderTimer.start();
+  }
+}
+
+void FrameMapView::showEvent(QShowEvent *event) {
+  QWidget::showEvent(event);
+  m_renderTimer.start();
+}
+
+void FrameMapView::setNumFrames(int numFrames) {
+  m_numFrames = numFrames;
+  m_currentFrame = -1;
+  // Number of A-lines is known with the first frame
+  for (auto *t : m_tables) {
+    t->resize(0, 0);
+  }
+  scheduleRender();
+}
+
+void FrameMapView::setData(
+    std::shared_ptr<BScanData<DataProcWorker::FloatType>> data) {
+  const bool addedPA = addFrame(Channel::PA, data->PA, data->frameIdx);
+  const bool addedUS = addFrame(Channel::US, data->US, data->frameIdx);
+  if (!addedPA && !addedUS) {
+    return;
+  }
+
+  m_currentFrame = data->frameIdx;
+  scheduleRender();
+}
+
+void FrameMapView::render() {
+  const auto ch = channel();
+  const auto &table = this->table(ch);
+  const int rows = table.numFrames();
+  const int cols = table.numAlines();
+  if (rows == 0 || cols == 0) {
+    m_image->clear();
+    m_stats->hide();
+    return;
+  }
+
+  const Style st = style(ch);
+
+  cv::Mat u8(rows, cols, CV_8UC1);
+  cv::Mat invalid(rows, cols, CV_8UC1);
+  cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; ++i) {
+      auto *dst = u8.ptr<uint8_t>(i);
+      auto *mask = invalid.ptr<uint8_t>(i);
+      for (int j = 0; j < cols; ++j) {
+        const float v = table.get(i, j, st.field);
+        const bool bad = std::isnan(v);
+        mask[j] = bad ? 255 : 0;
+        dst[j] = bad ? 0
+                     : static_cast<uint8_t>(
+                           std::clamp(v * st.scale, 0.0F, 255.0F));
+      }
+    }
+  });
+
+  cv::Mat bgr;
+  if (st.colormap >= 0) {
+    cv::applyColorMap(u8, bgr, st.colormap);
+  } else {
+    cv::cvtColor(u8, bgr, cv::COLOR_GRAY2BGR);
+  }
+  bgr.setTo(cv::Scalar::all(0), invalid);
+
+  if (m_currentFrame >= 0 && m_currentFrame < rows) {
+    bgr.row(m_currentFrame).setTo(cv::Scalar::all(255));
+  }
+
+  QImage img(bgr.data, bgr.cols, bgr.rows, static_cast<qsizetype>(bgr.step),
+             QImage::Format_BGR888);
+  m_image->setPixmap(QPixmap::fromImage(img));
+
+  const auto text = stats(ch);
+  m_stats->setText(text);
+  m_stats->setVisible(!text.isEmpty());
+}
+
+void FrameMapView::exportTables() {
+  if (table(Channel::PA).numFrames() == 0 &&
+      table(Channel::US).numFrames() == 0) {
+    emit message(QString("%1: nothing to export yet").arg(m_options.name));
+    return;
+  }
+
+  QString filter;
+  const auto filters = m_options.npyFirst ? "NumPy (*.npy);;CSV (*.csv)"
+                                          : "CSV (*.csv);;NumPy (*.npy)";
+  const auto fname = QFileDialog::getSaveFileName(
+      this, QString("Export %1").arg(m_options.name), m_options.exportFile,
+      filters, &filter);
+  if (fname.isEmpty()) {
+    return;
+  }
+
+  // name.csv -> name_PA.csv and name_US.csv
+  const QFileInfo info(fname);
+  const auto suffix = info.suffix().toLower();
+  const bool npy =
+      suffix == "npy" || (suffix != "csv" && filter.startsWith("NumPy"));
+  const QString ext = npy ? "npy" : "csv";
+  const auto base = info.dir().filePath(info.completeBaseName());
+
+  const auto save = [&](Channel ch, const QString &name) {
+    const auto path = QString("%1_%2.%3").arg(base, name, ext);
+    const auto p = qString2Path(path);
+    const bool ok = npy ? table(ch).saveNpy(p) : table(ch).saveCSV(p);
+    emit message(ok ? QString("%1: wrote %2").arg(m_options.name, path)
+                    : QString("%1: failed to write %2")
+                          .arg(m_options.name, path));
+  };
+  save(Channel::PA, "PA");
+  save(Channel::US, "US");
+}
+
+// NOLINTEND(*-magic-numbers)
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "DataProcWorker.hpp"
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QString>
+#include <QTimer>
+#include <QWidget>
+#include <array>
+#include <memory>
+#include <uspam/frameTable.hpp>
+
+/**
+Base of the maps (A-line x frame) of a per A-line metric of every processed
+frame (FWHMMap, EnFaceView). Keeps a PA and a US table, renders the selected
+one as a color mapped image with the current frame marked by a white line,
+and exports both to CSV or NPY.
+
+Renders are coalesced to at most one per event loop pass, and skipped while
+the widget is hidden (e.g. its dock is closed or behind another tab). The
+tables are still filled in, and the map is rendered when it is shown.
+*/
+class FrameMapView : public QWidget {
+  Q_OBJECT
+public:
+  enum Channel { PA = 0, US };
+
+  struct Options {
+    QString name;       // Prefix of messages, title of the export dialog
+    QString exportFile; // Default export filename
+    bool npyFirst;      // NPY is the default export format
+    QString tooltip;
+  };
+
+  explicit FrameMapView(Options options, QWidget *parent = nullptr);
+
+public slots:
+  // Clear the maps for a sequence of `numFrames` frames
+  void setNumFrames(int numFrames);
+
+  // Add a processed frame
+  void setData(std::shared_ptr<BScanData<DataProcWorker::FloatType>> data);
+
+  // Ask for a filename and write the PA and US tables
+  void exportTables();
+
+signals:
+  void message(QString);
+
+protected:
+  // Color mapping of the selected table
+  struct Style {
+    int field;    // Field shown
+    float scale;  // Value -> 0-255
+    int colormap; // cv::ColormapTypes, or -1 for gray
+  };
+
+  // The tables of the derived class, set in its constructor
+  void setTables(uspam::metrics::FrameTable *tablePA,
+                 uspam::metrics::FrameTable *tableUS) {
+    m_tables = {tablePA, tableUS};
+  }
+  [[nodiscard]] const uspam::metrics::FrameTable &table(Channel ch) const {
+    return *m_tables.at(ch);
+  }
+
+  // Add channel `ch` of a processed frame to its table. Returns false if the
+  // frame has nothing for this map (e.g. not computed).
+  virtual bool addFrame(Channel ch,
+                        const BScanData_<DataProcWorker::FloatType> &data,
+                        int frameIdx) = 0;
+
+  [[nodiscard]] virtual Style style(Channel ch) const = 0;
+
+  // Text below the map for the current frame (empty to hide it)
+  [[nodiscard]] virtual QString stats(Channel /*ch*/) const { return {}; }
+
+  // Add a control next to the channel selector
+  void addControl(QWidget *widget);
+
+  [[nodiscard]] Channel channel() const;
+  void setChannel(Channel ch);
+  [[nodiscard]] int numFrames() const { return m_numFrames; }
+  [[nodiscard]] int currentFrame() const { return m_currentFrame; }
+
+  // Render at most once per event loop pass, however many frames came in
+  void scheduleRender();
+
+  void showEvent(QShowEvent *event) override;
+
+private:
+  void render();
+
+  Options m_options;
+  std::array<uspam::metrics::FrameTable *, 2> m_tables{};
+  int m_numFrames{};
+  int m_currentFrame{-1};
+
+  QHBoxLayout *m_controls;
+  QComboBox *m_channel;
+  QLabel *m_image;
+  QLabel *m_stats;
+  QTimer m_renderTimer;
+};
@@ -1,6 +1,7 @@
 #include "ReconParamsController.hpp"
 #include "uspam/beamformer/beamformer.hpp"
 #include "uspam/reconParams.hpp"
+#include "uspam/temporalFilter.hpp"
 #include <QCheckBox>
 #include <QComboBox>
 #include <QDoubleSpinBox>
@@ -107,7 +108,33 @@ ReconParamsController::ReconParamsController(QWidget *parent)
       "Noise floor (mV) is the maximum noise level that will be cut out.";
   const QString &help_DynamicRange =
       "Dynamic range above the noisefloor that will be displayed.";
+  const QString &help_TGC =
+      "Time-gain compensation: gain (dB) added per mm of depth before log "
+      "compression, to make up for attenuation.";
+  const QString &help_AutoGain =
+      "Set the noise floor and dynamic range of every frame from its envelope "
+      "histogram (median and 99.9th percentile), smoothed over frames. The "
+      "noise floor and dynamic range above are ignored.";
+  const QString &help_EnFace =
+      "Depth window of the en-face maximum/mean projections (En-face dock). "
+      "An end at or above the start means to the end of the A-line.";
+  const QString &help_Temporal =
+      "Blend each frame with the previous ones to reduce flicker: mean of the "
+      "last N frames, exponential persistence (weight of the history), or "
+      "median of the last 3 frames. Restarts after a seek.";
+  const QString &help_Speckle =
+      "Reduce speckle in depth x angle before scan conversion (wraps around "
+      "in angle): median or bilateral filter of the given radius, or "
+      "anisotropic diffusion. Strength (levels of 255) is the edge contrast "
+      "kept by the bilateral filter and diffusion.";
   const QString &help_SAFT = "Use SAFT";
+  const QString &help_Envelope =
+      "Hilbert: bandpass filter + FFT Hilbert transform at full resolution. "
+      "IQ demod: mix down at the centre of the filter passband, low-pass and "
+      "decimate (faster, lower resolution envelope).";
+  const QString &help_Decimate =
+      "Low-pass and decimate the envelope to the display resolution before "
+      "log compression. Faster, and reduces aliasing in the image.";
 
   const auto makeReconParamsControl = [&](const QString &groupBoxName,
                                           uspam::recon::ReconParams &p) {
@@ -192,6 +219,46 @@ ReconParamsController::ReconParamsController(QWidget *parent)
           [this, spinBox, &p] { spinBox->setValue(p.desiredDynamicRange); });
     }
 
+    {
+      auto *label = new QLabel("TGC slope");
+      label->setToolTip(help_TGC);
+      layout->addWidget(label, row, 1);
+
+      auto *spinBox =
+          makeQDoubleSpinBox({0.0F, 10.0F}, 0.1F, p.tgcSlope_dBmm, this);
+      layout->addWidget(spinBox, row++, 2);
+      spinBox->setSuffix(" dB/mm");
+
+      updateGuiFromParamsCallbacks.emplace_back([this, spinBox, &p] {
+        spinBox->setValue(static_cast<double>(p.tgcSlope_dBmm));
+      });
+    }
+
+    {
+      auto *label = new QLabel("En-face depth");
+      label->setToolTip(help_EnFace);
+      layout->addWidget(label, row, 1);
+
+      auto *hlayout = new QHBoxLayout;
+      layout->addLayout(hlayout, row++, 2);
+
+      auto *begin = makeQDoubleSpinBox({0.0F, 20.0F}, 0.1F,
+                                       p.enfaceDepthBegin_mm, this);
+      begin->setSuffix(" mm");
+      hlayout->addWidget(begin);
+
+      auto *end =
+          makeQDoubleSpinBox({0.0F, 20.0F}, 0.1F, p.enfaceDepthEnd_mm, this);
+      end->setSuffix(" mm");
+      end->setSpecialValueText("End");
+      hlayout->addWidget(end);
+
+      updateGuiFromParamsCallbacks.emplace_back([this, begin, end, &p] {
+        begin->setValue(static_cast<double>(p.enfaceDepthBegin_mm));
+        end->setValue(static_cast<double>(p.enfaceDepthEnd_mm));
+      });
+    }
+
     // Beamformer
     {
       auto *label = new QLabel("Beamformer");
@@ -204,6 +271,10 @@ ReconParamsController::ReconParamsController(QWidget *parent)
       cbox->addItem("None", QVariant::fromValue(BeamformerType::NONE));
       cbox->addItem("SAFT", QVariant::fromValue(BeamformerType::SAFT));
       cbox->addItem("SAFT CF", QVariant::fromValue(BeamformerType::SAFT_CF));
+      cbox->addItem("SAFT GCF",
+                    QVariant::fromValue(BeamformerType::SAFT_GCF));
+      cbox->addItem("SAFT SLSC",
+                    QVariant::fromValue(BeamformerType::SAFT_SLSC));
 
       QObject::connect(
           cbox, QOverload<int>::of(&QComboBox::currentIndexChanged),
@@ -222,6 +293,168 @@ ReconParamsController::ReconParamsController(QWidget *parent)
         }
       });
     }
+
+    // Envelope detection
+    {
+      auto *label = new QLabel("Envelope");
+      label->setToolTip(help_Envelope);
+      layout->addWidget(label, row, 1);
+      using uspam::recon::EnvelopeMethod;
+
+      auto *cbox = new QComboBox;
+      layout->addWidget(cbox, row++, 2);
+      cbox->addItem("Hilbert", QVariant::fromValue(EnvelopeMethod::Hilbert));
+      cbox->addItem("IQ demod", QVariant::fromValue(EnvelopeMethod::IQ));
+
+      QObject::connect(
+          cbox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+          [&, cbox](int index) {
+            p.envelopeMethod =
+                qvariant_cast<EnvelopeMethod>(cbox->itemData(index));
+            this->_paramsUpdatedInternal();
+          });
+
+      updateGuiFromParamsCallbacks.emplace_back([this, cbox, &p] {
+        for (int i = 0; i < cbox->count(); ++i) {
+          if (qvariant_cast<EnvelopeMethod>(cbox->itemData(i)) ==
+              p.envelopeMethod) {
+            cbox->setCurrentIndex(i);
+          }
+        }
+      });
+    }
+
+    {
+      auto *checkBox = new QCheckBox("Decimate envelope");
+      checkBox->setToolTip(help_Decimate);
+      checkBox->setChecked(p.decimateEnvelope);
+      layout->addWidget(checkBox, row++, 1, 1, 2);
+
+      connect(checkBox, &QCheckBox::toggled, this, [this, &p](bool checked) {
+        p.decimateEnvelope = checked;
+        this->_paramsUpdatedInternal();
+      });
+
+      updateGuiFromParamsCallbacks.emplace_back([checkBox, &p] {
+        checkBox->setChecked(p.decimateEnvelope);
+      });
+    }
+
+    {
+      auto *checkBox = new QCheckBox("Auto gain");
+      checkBox->setToolTip(help_AutoGain);
+      checkBox->setChecked(p.autoGain);
+      layout->addWidget(checkBox, row++, 1, 1, 2);
+
+      connect(checkBox, &QCheckBox::toggled, this, [this, &p](bool checked) {
+        p.autoGain = checked;
+        this->_paramsUpdatedInternal();
+      });
+
+      updateGuiFromParamsCallbacks.emplace_back(
+          [checkBox, &p] { checkBox->setChecked(p.autoGain); });
+    }
+
+    // Temporal filter
+    {
+      auto *label = new QLabel("Temporal filter");
+      label->setToolTip(help_Temporal);
+      layout->addWidget(label, row, 1);
+      using uspam::recon::TemporalFilterType;
+
+      auto *cbox = new QComboBox;
+      layout->addWidget(cbox, row++, 2);
+      cbox->addItem("None", QVariant::fromValue(TemporalFilterType::None));
+      cbox->addItem("Mean of N", QVariant::fromValue(TemporalFilterType::Box));
+      cbox->addItem("Persistence",
+                    QVariant::fromValue(TemporalFilterType::Exponential));
+      cbox->addItem("Median of 3",
+                    QVariant::fromValue(TemporalFilterType::Median3));
+
+      QObject::connect(
+          cbox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+          [&, cbox](int index) {
+            p.temporalFilter =
+                qvariant_cast<TemporalFilterType>(cbox->itemData(index));
+            this->_paramsUpdatedInternal();
+          });
+
+      auto *hlayout = new QHBoxLayout;
+      layout->addLayout(hlayout, row++, 2);
+
+      auto *frames = makeQSpinBox({2, uspam::recon::TemporalFilter::MAX_FRAMES},
+                                  p.temporalFrames, this);
+      frames->setSuffix(" frames");
+      hlayout->addWidget(frames);
+
+      auto *persistence =
+          makeQDoubleSpinBox({0.0F, 0.95F}, 0.05F, p.temporalPersistence, this);
+      persistence->setToolTip("Persistence: weight of the previous frames");
+      hlayout->addWidget(persistence);
+
+      updateGuiFromParamsCallbacks.emplace_back(
+          [this, cbox, frames, persistence, &p] {
+            for (int i = 0; i < cbox->count(); ++i) {
+              if (qvariant_cast<TemporalFilterType>(cbox->itemData(i)) ==
+                  p.temporalFilter) {
+                cbox->setCurrentIndex(i);
+              }
+            }
+            frames->setValue(p.temporalFrames);
+            persistence->setValue(
+                static_cast<double>(p.temporalPersistence));
+          });
+    }
+
+    // Speckle filter
+    {
+      auto *label = new QLabel("Speckle filter");
+      label->setToolTip(help_Speckle);
+      layout->addWidget(label, row, 1);
+      using uspam::recon::SpeckleFilterType;
+
+      auto *cbox = new QComboBox;
+      layout->addWidget(cbox, row++, 2);
+      cbox->addItem("None", QVariant::fromValue(SpeckleFilterType::None));
+      cbox->addItem("Median", QVariant::fromValue(SpeckleFilterType::Median));
+      cbox->addItem("Bilateral",
+                    QVariant::fromValue(SpeckleFilterType::Bilateral));
+      cbox->addItem("Diffusion",
+                    QVariant::fromValue(SpeckleFilterType::Diffusion));
+
+      QObject::connect(
+          cbox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+          [&, cbox](int index) {
+            p.speckleFilter =
+                qvariant_cast<SpeckleFilterType>(cbox->itemData(index));
+            this->_paramsUpdatedInternal();
+          });
+
+      auto *hlayout = new QHBoxLayout;
+      layout->addLayout(hlayout, row++, 2);
+
+      auto *radius = makeQSpinBox({1, 5}, p.speckleRadius, this);
+      radius->setSuffix(" px");
+      radius->setToolTip("Radius (samples and A-lines)");
+      hlayout->addWidget(radius);
+
+      auto *strength =
+          makeQDoubleSpinBox({1.0F, 100.0F}, 1.0F, p.speckleStrength, this);
+      strength->setToolTip("Strength: edge contrast kept (levels)");
+      hlayout->addWidget(strength);
+
+      updateGuiFromParamsCallbacks.emplace_back(
+          [this, cbox, radius, strength, &p] {
+            for (int i = 0; i < cbox->count(); ++i) {
+              if (qvariant_cast<SpeckleFilterType>(cbox->itemData(i)) ==
+                  p.speckleFilter) {
+                cbox->setCurrentIndex(i);
+              }
+            }
+            radius->setValue(p.speckleRadius);
+            strength->setValue(static_cast<double>(p.speckleStrength));
+          });
+    }
     return gb;
   };
 
@@ -291,6 +524,40 @@ ReconParamsController::ReconParamsController(QWidget *parent)
     }
   }
 
+  // PAUS overlay
+  {
+    auto *gb = new QGroupBox(tr("Overlay"));
+    layout->addWidget(gb);
+    auto *layout = new QGridLayout;
+    gb->setLayout(layout);
+    int row = 0;
+
+    {
+      auto *label = new QLabel("PA threshold");
+      label->setToolTip("PA levels (0-255) above this are drawn over the US.");
+      layout->addWidget(label, row, 0);
+      auto *spinBox = makeQSpinBox({0, 254}, params.overlayThreshold, this);
+      layout->addWidget(spinBox, row++, 1);
+
+      updateGuiFromParamsCallbacks.emplace_back([this, spinBox] {
+        spinBox->setValue(this->params.overlayThreshold);
+      });
+    }
+
+    {
+      auto *label = new QLabel("PA fade");
+      label->setToolTip("Blend the PA in over this many levels above the "
+                        "threshold. 0 for a hard mask.");
+      layout->addWidget(label, row, 0);
+      auto *spinBox = makeQSpinBox({0, 255}, params.overlayRamp, this);
+      layout->addWidget(spinBox, row++, 1);
+      spinBox->setSuffix(" levels");
+
+      updateGuiFromParamsCallbacks.emplace_back(
+          [this, spinBox] { spinBox->setValue(this->params.overlayRamp); });
+    }
+  }
+
   // Reset buttons
   {
     auto *_layout = new QVBoxLayout;
@@ -0,0 +1,152 @@
+#include "ThumbnailStrip.hpp"
+#include <QHelpEvent>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <algorithm>
+#include <cmath>
+
+// NOLINTBEGIN(*-magic-numbers)
+
+ThumbnailStrip::ThumbnailStrip(QWidget *parent) : QWidget(parent) {
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+  setMinimumHeight(24);
+}
+
+QSize ThumbnailStrip::sizeHint() const { return {400, 40}; }
+
+void ThumbnailStrip::setNumFrames(int numFrames) {
+  m_thumbs = QVector<QImage>(std::max(numFrames, 0));
+  m_warnings = QVector<QString>(std::max(numFrames, 0));
+  m_currentFrame = -1;
+  update();
+}
+
+void ThumbnailStrip::setThumbnail(int frameIdx, const QImage &img) {
+  if (frameIdx >= 0 && frameIdx < m_thumbs.size()) {
+    m_thumbs[frameIdx] = img;
+    update();
+  }
+}
+
+void ThumbnailStrip::setFrameWarning(int frameIdx, const QString &warning) {
+  if (frameIdx >= 0 && frameIdx < m_warnings.size()) {
+    m_warnings[frameIdx] = warning;
+    update();
+  }
+}
+
+void ThumbnailStrip::setCurrentFrame(int frameIdx) {
+  if (m_currentFrame != frameIdx) {
+    m_currentFrame = frameIdx;
+    update();
+  }
+}
+
+int ThumbnailStrip::frameAt(double x) const {
+  const auto n = numFrames();
+  if (n == 0 || width() == 0) {
+    return -1;
+  }
+  const auto idx = static_cast<int>(x * n / width());
+  return std::clamp(idx, 0, n - 1);
+}
+
+double ThumbnailStrip::frameX(int frameIdx) const {
+  return (frameIdx + 0.5) * width() / numFrames();
+}
+
+void ThumbnailStrip::paintEvent(QPaintEvent * /*event*/) {
+  QPainter painter(this);
+  painter.fillRect(rect(), Qt::black);
+
+  const auto n = numFrames();
+  if (n == 0) {
+    return;
+  }
+
+  // Fit as many thumbnails as the width allows (keeping their aspect ratio),
+  // each one showing the frame at the start of its slot.
+  const auto &first = m_thumbs.front();
+  const double aspect = first.isNull() || first.height() == 0
+                            ? 2.0
+                            : static_cast<double>(first.width()) /
+                                  first.height();
+  const double thumbW = std::max(height() * aspect, 1.0);
+  const int nSlots = std::clamp(static_cast<int>(width() / thumbW), 1, n);
+  const double slotW = static_cast<double>(width()) / nSlots;
+
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+  for (int k = 0; k < nSlots; ++k) {
+    const auto &img = m_thumbs[k * n / nSlots];
+    if (!img.isNull()) {
+      painter.drawImage(QRectF(k * slotW, 0, slotW, height()), img);
+    }
+  }
+
+  // Mark frames with warnings
+  const double markW = std::max(2.0, static_cast<double>(width()) / n);
+  for (int i = 0; i < n; ++i) {
+    if (!m_warnings[i].isEmpty()) {
+      painter.fillRect(QRectF(frameX(i) - markW / 2, 0, markW, height()),
+                       QColor(255, 0, 0, 160));
+    }
+  }
+
+  // Current frame
+  if (m_currentFrame >= 0 && m_currentFrame < n) {
+    painter.setPen(QPen(Qt::yellow, 2));
+    const auto x = frameX(m_currentFrame);
+    painter.drawLine(QPointF(x, 0), QPointF(x, height()));
+  }
+}
+
+void ThumbnailStrip::mousePressEvent(QMouseEvent *event) {
+  mouseMoveEvent(event);
+}
+
+void ThumbnailStrip::mouseMoveEvent(QMouseEvent *event) {
+  // Scrub while dragging. Only the current frame marker moves, the frame is
+  // selected when the button is released
+  if (event->buttons() & Qt::LeftButton) {
+    const auto idx = frameAt(event->position().x());
+    if (idx >= 0) {
+      setCurrentFrame(idx);
+      QToolTip::showText(event->globalPosition().toPoint(),
+                         QString::number(idx), this);
+    }
+  }
+  QWidget::mouseMoveEvent(event);
+}
+
+void ThumbnailStrip::mouseReleaseEvent(QMouseEvent *event) {
+  if (event->button() == Qt::LeftButton) {
+    const auto idx = frameAt(event->position().x());
+    if (idx >= 0) {
+      setCurrentFrame(idx);
+      emit frameSelected(idx);
+    }
+  }
+  QWidget::mouseReleaseEvent(event);
+}
+
+bool ThumbnailStrip::event(QEvent *event) {
+  if (event->type() == QEvent::ToolTip) {
+    auto *helpEvent = static_cast<QHelpEvent *>(event); // NOLINT
+    const auto idx = frameAt(helpEvent->pos().x());
+    if (idx >= 0) {
+      auto text = QString("Frame %1").arg(idx);
+      if (!m_warnings[idx].isEmpty()) {
+        text += ": " + m_warnings[idx];
+      }
+      QToolTip::showText(helpEvent->globalPos(), text, this);
+    } else {
+      QToolTip::hideText();
+    }
+    return true;
+  }
+  return QWidget::event(event);
+}
+
+// NOLINTEND(*-magic-numbers)
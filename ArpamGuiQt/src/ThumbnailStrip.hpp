@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+#include <QVector>
+#include <QWidget>
+
+/**
+Horizontal overview of all frames in a sequence. Thumbnails are drawn at evenly
+spaced frames across the width, frames with warnings are marked in red and the
+current frame with a yellow line. Clicking selects a frame.
+*/
+class ThumbnailStrip : public QWidget {
+  Q_OBJECT
+public:
+  explicit ThumbnailStrip(QWidget *parent = nullptr);
+
+  // Reset to `numFrames` frames without thumbnails or warnings
+  void setNumFrames(int numFrames);
+  [[nodiscard]] int numFrames() const { return m_thumbs.size(); }
+
+  void setThumbnail(int frameIdx, const QImage &img);
+  [[nodiscard]] bool hasThumbnail(int frameIdx) const {
+    return frameIdx >= 0 && frameIdx < m_thumbs.size() &&
+           !m_thumbs[frameIdx].isNull();
+  }
+
+  // A non-empty warning marks the frame as bad. Shown in the tooltip.
+  void setFrameWarning(int frameIdx, const QString &warning);
+
+  void setCurrentFrame(int frameIdx);
+
+  [[nodiscard]] QSize sizeHint() const override;
+
+signals:
+  void frameSelected(int frameIdx);
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+  void mousePressEvent(QMouseEvent *event) override;
+  void mouseMoveEvent(QMouseEvent *event) override;
+  void mouseReleaseEvent(QMouseEvent *event) override;
+  bool event(QEvent *event) override;
+
+private:
+  [[nodiscard]] int frameAt(double x) const;
+  [[nodiscard]] double frameX(int frameIdx) const;
+
+  QVector<QImage> m_thumbs;
+  QVector<QString> m_warnings;
+  int m_currentFrame{-1};
+};
@@ -0,0 +1,141 @@
+#include "TiledImageItem.hpp"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// True if the pixels of `rect` are the same in `a` and `b` (same size and
+// format)
+bool sameRegion(const QImage &a, const QImage &b, const QRect &rect) {
+  const auto bpp = a.depth() / 8;
+  const auto rowBytes = static_cast<size_t>(rect.width()) * bpp;
+  const auto offset = static_cast<size_t>(rect.left()) * bpp;
+  for (int y = rect.top(); y <= rect.bottom(); ++y) {
+    // NOLINTBEGIN(*-pointer-arithmetic)
+    if (std::memcmp(a.constScanLine(y) + offset, b.constScanLine(y) + offset,
+                    rowBytes) != 0) {
+      return false;
+    }
+    // NOLINTEND(*-pointer-arithmetic)
+  }
+  return true;
+}
+
+uint64_t tileKey(int k, int tx, int ty) {
+  // NOLINTNEXTLINE(*-magic-numbers)
+  return (static_cast<uint64_t>(k) << 48) | (static_cast<uint64_t>(tx) << 24) |
+         static_cast<uint64_t>(ty);
+}
+
+} // namespace
+
+TiledImageItem::TiledImageItem(QGraphicsItem *parent) : QGraphicsItem(parent) {
+  // Needed for option->exposedRect
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+void TiledImageItem::setImage(const QImage &image) {
+  if (image.size() != size() || image.format() != this->image().format()) {
+    prepareGeometryChange();
+    m_tiles.clear();
+    m_prevLevels.clear();
+  } else {
+    m_prevLevels = std::move(m_levels);
+  }
+
+  // Lower levels are rebuilt when needed
+  m_levels.assign(1, image);
+  ++m_frame;
+  update();
+}
+
+QRectF TiledImageItem::boundingRect() const { return QRectF(rect()); }
+
+int TiledImageItem::levelForScale(double scale) const {
+  // Coarsest level that still has at least one image pixel per screen pixel
+  int k = 0;
+  while (scale * (2 << k) <= 1.0 && (size().width() >> (k + 1)) > 0 &&
+         (size().height() >> (k + 1)) > 0) {
+    ++k;
+  }
+  return k;
+}
+
+const QImage &TiledImageItem::level(int k) {
+  while (static_cast<int>(m_levels.size()) <= k) {
+    const QImage &prev = m_levels.back();
+    m_levels.push_back(prev.scaled(std::max(1, prev.width() / 2),
+                                   std::max(1, prev.height() / 2),
+                                   Qt::IgnoreAspectRatio,
+                                   Qt::SmoothTransformation));
+  }
+  return m_levels[k];
+}
+
+const QPixmap &TiledImageItem::tile(int k, int tx, int ty) {
+  auto &t = m_tiles[tileKey(k, tx, ty)];
+  if (t.frame != m_frame) {
+    const QImage &img = level(k);
+    const QRect r =
+        QRect(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE) &
+        img.rect();
+
+    // Only upload tiles whose pixels changed since the last frame. The
+    // pixmap is up to date with the previous frame if it was checked then,
+    // so the tile is compared with the previous frame's pixels.
+    const bool unchanged =
+        !t.pixmap.isNull() && t.frame == m_frame - 1 &&
+        k < static_cast<int>(m_prevLevels.size()) &&
+        sameRegion(img, m_prevLevels[k], r);
+    if (!unchanged) {
+      t.pixmap = QPixmap::fromImage(img.copy(r));
+    }
+    t.frame = m_frame;
+  }
+  return t.pixmap;
+}
+
+void TiledImageItem::paint(QPainter *painter,
+                           const QStyleOptionGraphicsItem *option,
+                           QWidget * /*widget*/) {
+  if (isNull()) {
+    return;
+  }
+
+  const double scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+      painter->worldTransform());
+  const int k = levelForScale(scale);
+  const QImage &img = level(k);
+
+  // Level k pixel -> item coordinates
+  const double fx = static_cast<double>(size().width()) / img.width();
+  const double fy = static_cast<double>(size().height()) / img.height();
+
+  const QRectF exposed = option->exposedRect & boundingRect();
+  if (exposed.isEmpty()) {
+    return;
+  }
+  const auto tileRange = [](double lo, double hi, double f, int n) {
+    const int first = std::max(0, static_cast<int>(lo / f) / TILE_SIZE);
+    const int last = std::min((n - 1) / TILE_SIZE,
+                              static_cast<int>(std::ceil(hi / f)) / TILE_SIZE);
+    return std::pair{first, last};
+  };
+  const auto [tx0, tx1] =
+      tileRange(exposed.left(), exposed.right(), fx, img.width());
+  const auto [ty0, ty1] =
+      tileRange(exposed.top(), exposed.bottom(), fy, img.height());
+
+  for (int ty = ty0; ty <= ty1; ++ty) {
+    for (int tx = tx0; tx <= tx1; ++tx) {
+      const QPixmap &pm = tile(k, tx, ty);
+      const QRectF dst(tx * TILE_SIZE * fx, ty * TILE_SIZE * fy,
+                       pm.width() * fx, pm.height() * fy);
+      painter->drawPixmap(dst, pm, QRectF(pm.rect()));
+    }
+  }
+}
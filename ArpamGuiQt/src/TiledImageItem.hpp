@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QRectF>
+#include <cstdint>
+#include <vector>
+
+/**
+Graphics item that draws a large image as a pyramid of tiles.
+
+Level 0 is the image, level k is downscaled by 2^k. Levels are built lazily
+when the view is zoomed out far enough to need them, and only the tiles that
+intersect the exposed area at the current zoom are converted to pixmaps and
+drawn. Pixmaps are cached across frames and reused when the pixels of a tile
+didn't change (e.g. the black corners around a radial image): a tile that
+was up to date in the previous frame is compared with the previous frame's
+pixels, which are kept until the next frame (shared, not copied).
+
+Item coordinates are level 0 pixels, same as a QGraphicsPixmapItem.
+*/
+class TiledImageItem : public QGraphicsItem {
+public:
+  static constexpr int TILE_SIZE = 256;
+
+  explicit TiledImageItem(QGraphicsItem *parent = nullptr);
+
+  // Show a new frame. The image is shared, not copied: its pixels must not
+  // change afterwards (the next frame is compared with them)
+  void setImage(const QImage &image);
+
+  [[nodiscard]] const QImage &image() const { return m_levels.front(); }
+  [[nodiscard]] bool isNull() const { return image().isNull(); }
+  [[nodiscard]] QSize size() const { return image().size(); }
+  [[nodiscard]] QRect rect() const { return image().rect(); }
+
+  [[nodiscard]] QRectF boundingRect() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+             QWidget *widget) override;
+
+private:
+  struct Tile {
+    QPixmap pixmap;
+    int frame{-1}; // Frame the pixmap was checked against
+  };
+
+  // Pyramid level for a view scale (screen pixels per image pixel)
+  [[nodiscard]] int levelForScale(double scale) const;
+  const QImage &level(int k);
+  const QPixmap &tile(int k, int tx, int ty);
+
+  std::vector<QImage> m_levels{QImage{}};
+  std::vector<QImage> m_prevLevels; // Levels of the previous frame
+  int m_frame{};
+
+  // Key: level, tile x, tile y
+  QHash<uint64_t, Tile> m_tiles;
+};
@@ -63,6 +63,9 @@ auto main(int argc, char **argv) -> int {
   fftw_make_planner_thread_safe();
   fftwf_make_planner_thread_safe();
 
+  // Reuse FFTW plans tuned by `arpam tune` (and earlier sessions)
+  uspam::fft::load_wisdom();
+
   // qInstallMessageHandler(myMessageHandler);
 
   QApplication::setStyle("Fusion"); // Dark mode
@@ -81,5 +84,8 @@ auto main(int argc, char **argv) -> int {
   mainWindow.setWindowTitle("ArpamGui");
   mainWindow.showMaximized();
 
-  return QApplication::exec();
+  const auto ret = QApplication::exec();
+
+  uspam::fft::save_wisdom();
+  return ret;
 }
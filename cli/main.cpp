@@ -2,14 +2,21 @@
 #include <CLI/CLI.hpp>
 #include <armadillo>
 #include <chrono>
+#include <cmath>
 #include <fftconv.hpp>
 #include <fftw3.h>
 #include <filesystem>
 #include <format>
 #include <indicators/progress_bar.hpp>
 #include <iostream>
+#include <vector>
+#include <uspam/binfileSequence.hpp>
+#include <uspam/enface.hpp>
+#include <uspam/fft.hpp>
+#include <uspam/fwhm.hpp>
 #include <uspam/timeit.hpp>
 #include <uspam/uspam.hpp>
+#include <uspam/videoSink.hpp>
 
 namespace fs = std::filesystem;
 namespace io = uspam::io;
@@ -33,12 +40,118 @@ auto estimate_aline_background_from_file(const io::IOParams &ioparams,
   return background;
 }
 
+// Axial FWHM of every A-line of every frame (PA and US)
+struct FWHMExport {
+  fs::path filename; // .csv or .npy. Empty to disable
+
+  uspam::metrics::FWHMTable PA;
+  uspam::metrics::FWHMTable US;
+
+  [[nodiscard]] bool enabled() const { return !filename.empty(); }
+
+  // frame is relative to the first processed scan. A-lines are stored in
+  // display order (flip and rotation applied)
+  template <uspam::Floating T>
+  void add(int frame, int numFrames, const recon::ReconParams2 &params,
+           const io::PAUSpair<T> &rf, const io::PAUSpair<T> &env, bool flip) {
+    const auto addOne = [&](uspam::metrics::FWHMTable &table,
+                            const recon::ReconParams &p, const arma::Mat<T> &x,
+                            const arma::Mat<T> &e) {
+      const auto ratio = static_cast<double>(e.n_rows) / x.n_rows;
+      std::vector<uspam::metrics::AlineFWHM> alines;
+      uspam::metrics::fwhm<T>(e, alines,
+                              static_cast<int>(std::ceil(p.truncate * ratio)));
+      p.permutation(flip).apply(alines);
+      if (table.numAlines() != static_cast<int>(alines.size())) {
+        table.resize(numFrames, static_cast<int>(alines.size()));
+      }
+      table.setFrame(frame, alines,
+                     static_cast<float>(p.mmPerSample / ratio));
+    };
+    addOne(PA, params.PA, rf.PA, env.PA);
+    addOne(US, params.US, rf.US, env.US);
+  }
+
+  // name.ext -> name_PA.ext and name_US.ext
+  [[nodiscard]] bool save() const {
+    const bool npy = filename.extension() == ".npy";
+    const auto ext = filename.extension().string();
+    const auto base = filename.parent_path() / filename.stem();
+    const auto pathPA = fs::path(base.string() + "_PA" + ext);
+    const auto pathUS = fs::path(base.string() + "_US" + ext);
+    const bool ok = npy ? PA.saveNpy(pathPA) && US.saveNpy(pathUS)
+                        : PA.saveCSV(pathPA) && US.saveCSV(pathUS);
+    if (ok) {
+      std::cout << "Wrote FWHM to " << pathPA << " and " << pathUS << "\n";
+    }
+    return ok;
+  }
+};
+
+// En-face maximum/mean projection of every A-line of every frame (PA and US)
+struct EnFaceExport {
+  fs::path filename; // .csv or .npy. Empty to disable
+
+  // The maps are rewritten every SAVE_EVERY frames while processing, so a
+  // long batch has a usable partial map
+  static constexpr int SAVE_EVERY = 100;
+
+  uspam::metrics::EnFaceMap PA;
+  uspam::metrics::EnFaceMap US;
+
+  [[nodiscard]] bool enabled() const { return !filename.empty(); }
+
+  // frame is relative to the first processed scan. A-lines are stored in
+  // display order (flip and rotation applied)
+  void add(int frame, int numFrames, const recon::ReconParams2 &params,
+           uspam::metrics::FrameProjection &projPA,
+           uspam::metrics::FrameProjection &projUS, bool flip) {
+    const auto addOne = [&](uspam::metrics::EnFaceMap &map,
+                            const recon::ReconParams &p,
+                            uspam::metrics::FrameProjection &proj) {
+      p.permutation(flip).apply(proj.alines);
+      if (map.numAlines() != static_cast<int>(proj.alines.size())) {
+        map.resize(numFrames, static_cast<int>(proj.alines.size()));
+      }
+      map.setFrame(frame, proj.alines, proj.mmPerRow);
+    };
+    addOne(PA, params.PA, projPA);
+    addOne(US, params.US, projUS);
+  }
+
+  // name.ext -> name_PA.ext and name_US.ext
+  [[nodiscard]] bool save(bool verbose = true) const {
+    const bool csv = filename.extension() == ".csv";
+    const auto ext = filename.extension().string();
+    const auto base = filename.parent_path() / filename.stem();
+    const auto pathPA = fs::path(base.string() + "_PA" + ext);
+    const auto pathUS = fs::path(base.string() + "_US" + ext);
+    const bool ok = csv ? PA.saveCSV(pathPA) && US.saveCSV(pathUS)
+                        : PA.saveNpy(pathPA) && US.saveNpy(pathUS);
+    if (ok && verbose) {
+      std::cout << "Wrote en-face maps to " << pathPA << " and " << pathUS
+                << "\n";
+    }
+    return ok;
+  }
+};
+
+struct VideoOptions {
+  fs::path filename; // Empty to disable video export
+  uspam::io::VideoSinkParams params;
+  std::string source{"paus"}; // paus, us or pa
+};
+
 /**
-BType is the dtype stored in the binary file
+BType is the dtype stored in the binary file.
+Several binfiles are processed as one continuous sequence (global scan index).
 */
 template <typename BType>
-void cliRecon(const fs::path fname, int starti = 0, int nscans = 0,
-              const fs::path savedir = "images") {
+void cliRecon(const std::vector<fs::path> &fnames, int starti = 0,
+              int nscans = 0, const fs::path savedir = "images",
+              const VideoOptions &videoOpts = {}, bool show = false,
+              const fs::path &fwhmFile = {},
+              const fs::path &enfaceFile = {}) {
   if (!fs::create_directory(savedir) && !fs::exists(savedir)) {
     std::cerr << " Failed to create savedir " << savedir << "\n";
     return;
@@ -47,7 +160,17 @@ void cliRecon(const fs::path fname, int starti = 0, int nscans = 0,
   const auto ioparams = uspam::io::IOParams::system2024v1();
   const auto params = recon::ReconParams2::system2024v1();
 
-  uspam::io::BinfileLoader<BType> loader(ioparams, fname);
+  // Plans tuned by `arpam tune`
+  uspam::fft::load_wisdom();
+
+  uspam::io::BinfileSequence<BType> loader;
+  loader.setParams(ioparams);
+  try {
+    loader.open(fnames);
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << "\n";
+    return;
+  }
 
   if (starti >= loader.size()) {
     std::cout << std::format("Error: starti({}) > size({})\n", starti,
@@ -59,8 +182,9 @@ void cliRecon(const fs::path fname, int starti = 0, int nscans = 0,
     nscans = loader.size() - starti;
   }
 
+  // Background from the start of the sequence
   const arma::vec background_aline =
-      estimate_aline_background_from_file(ioparams, fname, 10000);
+      estimate_aline_background_from_file(ioparams, fnames.front(), 10000);
   const auto background = ioparams.splitRfPAUS_aline(background_aline);
 
   // background_aline.save("background.bin", arma::raw_binary);
@@ -88,16 +212,30 @@ void cliRecon(const fs::path fname, int starti = 0, int nscans = 0,
   const int endi = nscans + starti;
   arma::Mat<BType> rf(uspam::io::RF_ALINE_SIZE, 1000, arma::fill::none);
   auto rfPair = ioparams.allocateSplitPair<double>(1000);
+  auto rfEnv = io::PAUSpair<double>::empty_like(rfPair);
   auto rfLog = io::PAUSpair<uint8_t>::zeros_like(rfPair);
 
+  // Video sink. Encoding runs on the sink's own thread.
+  uspam::io::VideoSink videoSink;
+  if (!videoOpts.filename.empty()) {
+    videoSink.open(videoOpts.filename, videoOpts.params);
+  }
+
+  FWHMExport fwhmExport{fwhmFile};
+  EnFaceExport enfaceExport{enfaceFile};
+  uspam::metrics::FrameProjection projPA;
+  uspam::metrics::FrameProjection projUS;
+
   for (int i = starti; i < endi; ++i) {
     const double pct = (double)(i - starti) / nscans;
     // bar.set_progress(pct);
     const auto start = clock::now();
-    const bool flip{i % 2 != 0};
+    // Scan direction alternates within each file
+    const bool flip{loader.localIndex(i) % 2 != 0};
 
-    // Read next RF scan from file
-    loader.getNext(rf);
+    // Read next RF scan. The following scan is prefetched in the background,
+    // also across file boundaries
+    loader.get(rf, i);
 
     // Background subtraction
     // rf.each_col() -= arma::mean(rf, 1);
@@ -110,7 +248,25 @@ void cliRecon(const fs::path fname, int starti = 0, int nscans = 0,
 
     {
       uspam::TimeIt<true> timeit("reconOneScan");
-      recon::reconOneScan(params, rfPair, rfLog, flip);
+      if (enfaceExport.enabled()) {
+        recon::reconOneScan<double>(params, rfPair, rfEnv, rfLog, &projPA,
+                                    &projUS);
+      } else {
+        recon::reconOneScan<double>(params, rfPair, rfEnv, rfLog);
+      }
+    }
+
+    if (fwhmExport.enabled()) {
+      fwhmExport.add<double>(i - starti, nscans, params, rfPair, rfEnv, flip);
+    }
+
+    if (enfaceExport.enabled()) {
+      enfaceExport.add(i - starti, nscans, params, projPA, projUS, flip);
+      if ((i - starti + 1) % EnFaceExport::SAVE_EVERY == 0 &&
+          !enfaceExport.save(false)) {
+        std::cerr << "Error: failed to write en-face maps to " << enfaceFile
+                  << "\n";
+      }
     }
 
     // rfLog.US.save("USlog.bin", arma::raw_binary);
@@ -119,47 +275,159 @@ void cliRecon(const fs::path fname, int starti = 0, int nscans = 0,
     // cv::Mat PArect = uspam::imutil::makeRectangular(rfLog.PA);
     // cv::Mat USrect = uspam::imutil::makeRectangular(rfLog.US);
 
-    const cv::Mat PAradial = uspam::imutil::makeRadial(rfLog.PA);
-    const cv::Mat USradial = uspam::imutil::makeRadial(rfLog.US);
+    const cv::Mat PAradial =
+        uspam::imutil::makeRadial(rfLog.PA, 0, params.PA.permutation(flip));
+    const cv::Mat USradial =
+        uspam::imutil::makeRadial(rfLog.US, 0, params.US.permutation(flip));
+
+    if (videoSink.isOpen()) {
+      if (videoOpts.source == "us") {
+        videoSink.push(i, USradial);
+      } else if (videoOpts.source == "pa") {
+        videoSink.push(i, PAradial);
+      } else {
+        cv::Mat PAUSradial;
+        uspam::imutil::makeOverlay(USradial, PAradial, PAUSradial);
+        videoSink.push(i, PAUSradial);
+      }
+    }
 
     const auto elapsed = clock::now() - start;
     std::cout << duration_cast<std::chrono::milliseconds>(elapsed).count()
               << " ms\n";
 
-    cv::imshow("tmp", USradial);
-    cv::waitKey(1);
+    if (show) {
+      cv::imshow("tmp", USradial);
+      cv::waitKey(1);
+    }
+  }
+
+  if (fwhmExport.enabled() && !fwhmExport.save()) {
+    std::cerr << "Error: failed to write FWHM to " << fwhmFile << "\n";
+  }
+
+  if (enfaceExport.enabled() && !enfaceExport.save()) {
+    std::cerr << "Error: failed to write en-face maps to " << enfaceFile
+              << "\n";
+  }
+
+  if (videoSink.isOpen()) {
+    videoSink.close();
+    if (const auto err = videoSink.error(); !err.empty()) {
+      std::cerr << err << "\n";
+    }
+    std::cout << "Wrote " << videoSink.framesWritten() << " frames to "
+              << videoOpts.filename << "\n";
   }
 }
 
+/**
+Plan the uspam::fft engines used by recon with a higher FFTW rigor and save
+the wisdom to the config directory. Later runs (GUI and CLI) load it at
+startup. The FIR dispatch is calibrated too. fftconv's plans for the FFT FIR
+path aren't tuned.
+*/
+int cliTune(bool patient) {
+  const auto ioparams = uspam::io::IOParams::system2024v1();
+
+  uspam::fft::load_wisdom();
+  uspam::fft::set_planner_flags(patient ? FFTW_PATIENT : FFTW_MEASURE);
+
+  {
+    uspam::TimeIt<true> timeit("Tune float");
+    recon::warmup<float>(ioparams, io::NUM_ALINES_DETAULT);
+  }
+  {
+    uspam::TimeIt<true> timeit("Tune double");
+    recon::warmup<double>(ioparams, io::NUM_ALINES_DETAULT);
+  }
+
+  if (!uspam::fft::save_wisdom()) {
+    std::cerr << "Error: failed to save FFTW wisdom\n";
+    return 1;
+  }
+  std::cout << "Saved FFTW wisdom to " << uspam::fft::wisdom_file(false)
+            << " and " << uspam::fft::wisdom_file(true) << "\n";
+  return 0;
+}
+
 int main(int argc, char **argv) {
   CLI::App app{"arpam - reconstruct images from binfiles"};
 
-  std::string _binpath;
+  std::vector<std::string> _binpaths;
   std::string savedir{"images"};
   int starti = 0;
   int nscans = 0;
+  bool show = false;
+
+  VideoOptions videoOpts;
+  std::string videoPath;
+  std::string codec{"mjpg"};
+
+  app.add_option("binpaths", _binpaths,
+                 "Binfile(s). Several files are processed as one sequence");
+  app.add_option("-s,--start-i", starti, "Start at scan i (optional)");
+  app.add_option("-n,--nscans", nscans, "Number of scans (optional)");
+  app.add_option("--savedir", savedir, "Directory to save images");
+  app.add_flag("--show", show, "Show each frame in a window");
+
+  app.add_option("--video", videoPath, "Write frames to a video file");
+  app.add_option("--video-source", videoOpts.source, "Image to export")
+      ->check(CLI::IsMember({"paus", "us", "pa"}));
+  app.add_option("--codec", codec, "Video codec")
+      ->check(CLI::IsMember({"mjpg", "ffv1"}));
+  app.add_option("--fps", videoOpts.params.fps, "Video frame rate");
+  app.add_option("--quality", videoOpts.params.quality,
+                 "Video quality (0-100, lossy codecs only)")
+      ->check(CLI::Range(0, 100));
+
+  std::string fwhmPath;
+  app.add_option("--fwhm", fwhmPath,
+                 "Write the axial FWHM of every A-line to <name>_PA/_US "
+                 "(.csv or .npy)");
+
+  std::string enfacePath;
+  app.add_option("--enface", enfacePath,
+                 "Write the en-face max/mean/depth of max maps to "
+                 "<name>_PA/_US (.npy or .csv)");
+
+  bool patient = false;
+  auto *tune = app.add_subcommand(
+      "tune", "One-time FFTW tuning for this machine (saves wisdom)");
+  tune->add_flag("--patient", patient,
+                 "Use FFTW_PATIENT instead of FFTW_MEASURE (slow)");
+
+  CLI11_PARSE(app, argc, argv);
+
+  if (tune->parsed()) {
+    return cliTune(patient);
+  }
 
-  // app.add_option("binpath", _binpath)->required();
-  // app.add_option("-s,--start-i", starti, "Start at scan i (optional)");
-  // app.add_option("-n,--nscans", nscans, "Number of scans (optional)");
-  // app.add_option("--savedir", nscans, "Directory to save images");
-  // CLI11_PARSE(app, argc, argv);
-
-  fs::path binpath{_binpath};
+  if (_binpaths.empty()) {
+    std::cerr << "Error: binpaths is required\n" << app.help();
+    return 1;
+  }
 
-  // if (!fs::exists(binpath)) {
-  //   std::cerr << "Error: the file path does not exist: " << binpath << "\n";
-  //   return 1;
-  // }
+  std::vector<fs::path> binpaths;
+  for (const auto &binpath : _binpaths) {
+    if (!fs::exists(binpath)) {
+      std::cerr << "Error: the file path does not exist: " << binpath << "\n";
+      return 1;
+    }
+    binpaths.emplace_back(binpath);
+  }
 
-  // starti = 75;
-  // nscans = 1;
-  binpath = "F:/tmp/20231025 ex vivo 249/152449PAUS.bin";
+  videoOpts.filename = videoPath;
+  videoOpts.params.codec = codec == "ffv1" ? uspam::io::VideoCodec::FFV1
+                                            : uspam::io::VideoCodec::MJPG;
 
-  std::cout << "binpath: " << binpath << "\n";
+  for (const auto &binpath : binpaths) {
+    std::cout << "binpath: " << binpath << "\n";
+  }
   std::cout << "nscans: " << nscans << "\n";
 
-  cliRecon<uint16_t>(binpath, starti, nscans, savedir);
+  cliRecon<uint16_t>(binpaths, starti, nscans, savedir, videoOpts, show,
+                     fwhmPath, enfacePath);
 
   return 0;
 }
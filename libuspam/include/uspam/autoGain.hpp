@@ -0,0 +1,153 @@
+#pragma once
+
+#include "uspam/fft.hpp"
+#include <algorithm>
+#include <armadillo>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+
+namespace uspam::recon {
+
+/**
+@brief Histogram of envelope amplitudes on a log scale.
+
+The bin of a sample is read straight from the bits of its float
+representation (exponent + top mantissa bits), which is monotonic for positive
+floats and gives `BINS_PER_OCTAVE` bins per factor of 2 (~0.38 dB) without
+computing a log per sample.
+*/
+struct EnvelopeHistogram {
+  static constexpr int MANTISSA_BITS = 4;
+  static constexpr int BINS_PER_OCTAVE = 1 << MANTISSA_BITS;
+  static constexpr int SHIFT = 23 - MANTISSA_BITS;
+
+  // Range [2^MIN_EXP, 2^MAX_EXP) V. Values outside go to the first/last bin.
+  static constexpr int MIN_EXP = -40;
+  static constexpr int MAX_EXP = 8;
+  static constexpr int NBINS = (MAX_EXP - MIN_EXP) * BINS_PER_OCTAVE;
+  static constexpr int32_t BASE = (127 + MIN_EXP) * BINS_PER_OCTAVE;
+
+  std::array<uint64_t, NBINS> counts{};
+  uint64_t total{};
+
+  static int bin(float val) {
+    const auto idx = (std::bit_cast<int32_t>(val) >> SHIFT) - BASE;
+    return std::clamp(idx, 0, NBINS - 1);
+  }
+
+  // Smallest amplitude that falls in a bin
+  static float lowerEdge(int bin) {
+    return std::bit_cast<float>(static_cast<uint32_t>(bin + BASE) << SHIFT);
+  }
+
+  // Amplitude at the centre of a bin
+  static float value(int bin) {
+    return 0.5F * (lowerEdge(bin) + lowerEdge(bin + 1));
+  }
+
+  void merge(const EnvelopeHistogram &other) {
+    for (int i = 0; i < NBINS; ++i) {
+      counts[i] += other.counts[i];
+    }
+    total += other.total;
+  }
+
+  // Amplitude below which `percentile` (0-100) of the samples fall
+  [[nodiscard]] float percentile(double percentile) const;
+
+  /**
+  @brief Histogram of every sample in `env` in one parallel pass.
+  */
+  template <Floating T>
+  static EnvelopeHistogram compute(const arma::Mat<T> &env);
+};
+
+template <Floating T>
+EnvelopeHistogram EnvelopeHistogram::compute(const arma::Mat<T> &env) {
+  EnvelopeHistogram hist;
+  std::mutex mtx;
+
+  cv::parallel_for_(cv::Range(0, env.n_cols), [&](const cv::Range &range) {
+    // Samples next to each other tend to fall in the same bin. Spread them
+    // over a few sub-histograms so consecutive increments don't wait on each
+    // other.
+    constexpr int LANES = 4;
+    std::array<std::array<uint32_t, NBINS>, LANES> local{};
+
+    for (int j = range.start; j < range.end; ++j) {
+      const T *col = env.colptr(j);
+      const auto n = static_cast<int>(env.n_rows);
+      int i = 0;
+      for (; i + LANES <= n; i += LANES) {
+        for (int l = 0; l < LANES; ++l) {
+          ++local[l][bin(static_cast<float>(col[i + l]))];
+        }
+      }
+      for (; i < n; ++i) {
+        ++local[0][bin(static_cast<float>(col[i]))];
+      }
+    }
+
+    EnvelopeHistogram partial;
+    for (int k = 0; k < NBINS; ++k) {
+      for (int l = 0; l < LANES; ++l) {
+        partial.counts[k] += local[l][k];
+      }
+    }
+    partial.total =
+        static_cast<uint64_t>(range.end - range.start) * env.n_rows;
+
+    std::lock_guard lock(mtx);
+    hist.merge(partial);
+  });
+
+  return hist;
+}
+
+/**
+@brief Per channel auto gain state. Derives the noise floor and dynamic range
+of each frame from percentiles of its envelope histogram, smoothed over frames
+so the image doesn't flicker.
+*/
+class AutoGain {
+public:
+  struct Result {
+    float noiseFloor_mV;
+    float dynamicRange_dB;
+  };
+
+  // Smoothing weight of the previous frames' estimate (0 = no smoothing)
+  explicit AutoGain(float smoothing = 0.8F) : m_smoothing(smoothing) {}
+
+  void setSmoothing(float smoothing) { m_smoothing = smoothing; }
+
+  // Forget the history (e.g. when a new file is opened)
+  void reset() { m_initialized = false; }
+
+  /**
+  @brief Update the estimate with the histogram of a new frame.
+  @param noisePercentile Percentile of the envelope taken as the noise floor.
+  Most of a B-scan is background, so the median is a good default.
+  @param peakPercentile Percentile taken as the peak. Slightly below 100 so a
+  few saturated samples don't set the range.
+  */
+  Result update(const EnvelopeHistogram &hist, double noisePercentile,
+                double peakPercentile);
+
+  // Current estimate. Only meaningful once initialized()
+  [[nodiscard]] Result result() const;
+  [[nodiscard]] bool initialized() const { return m_initialized; }
+
+private:
+  float m_smoothing;
+  bool m_initialized{false};
+
+  // Smoothed in dB
+  double m_noiseDB{};
+  double m_peakDB{};
+};
+
+} // namespace uspam::recon
@@ -0,0 +1,418 @@
+#pragma once
+
+#include <algorithm>
+#include <armadillo>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <opencv2/opencv.hpp>
+#include <span>
+#include <uspam/fft.hpp>
+#include <vector>
+
+namespace uspam::beamformer {
+
+/**
+@brief Delays resolved for A-lines of `nPts` samples, so the beamforming loop
+only does linear interpolated gathers (no rounding or bounds checks).
+
+For depth iz in [zStart, zEnd) and line offset dj, the delayed sample
+iz + delay(iz, dj) is
+  w0(k, dj) * x[index(k, dj)] + w1(k, dj) * x[index(k, dj) + 1]
+with k = iz - zStart. Entries of unused lines, or delays that fall outside the
+A-line, have zero weights and a safe index. The tables are column major, so
+the inner loop over depth reads them contiguously.
+*/
+template <Floating FloatType> struct SaftDelayTable {
+  arma::Mat<int32_t> index;
+  arma::Mat<FloatType> w0;
+  arma::Mat<FloatType> w1;
+  // Number of samples summed at each depth (1 + 2 per valid line)
+  arma::Col<FloatType> count;
+  int zStart{};
+  int zEnd{};
+  int nPts{};
+  int nLines{}; // max SAFT lines at any depth (columns used)
+
+  [[nodiscard]] int nz() const { return zEnd - zStart; }
+};
+
+/*
+Coherence weighting policies for `das`.
+
+For every output A-line, `das` gathers the delayed samples of the lines at
+offsets +-dj (dj = 0 .. nLines - 1) over the depth window and hands them to the
+policy one offset at a time as two depth vectors:
+
+  begin(nz, nLines)   once per thread, allocate scratch
+  init(self)          the A-line's own samples
+  add(dj, vp, vm)     delayed samples of lines j + dj and j - dj
+  finish(count, out)  write the beamformed window
+
+Policies are copied per thread, so they can keep scratch buffers. A new
+weighting only needs these four functions.
+*/
+
+// Plain delay-and-sum
+template <Floating T> struct DASSum {
+  std::vector<T> sum;
+
+  void begin(int nz, int /*nLines*/) { sum.resize(nz); }
+
+  void init(std::span<const T> self) {
+    std::copy(self.begin(), self.end(), sum.begin());
+  }
+
+  void add(int /*dj*/, std::span<const T> vp, std::span<const T> vm) {
+    for (size_t k = 0; k < sum.size(); ++k) {
+      sum[k] += vp[k] + vm[k];
+    }
+  }
+
+  void finish(std::span<const T> /*count*/, std::span<T> out) const {
+    std::copy(sum.begin(), sum.end(), out.begin());
+  }
+};
+
+// Coherence factor: CF = (sum s)^2 / (N sum s^2), out = sum(s) * CF / N
+template <Floating T> struct CoherenceFactor {
+  std::vector<T> sum;
+  std::vector<T> sumSq;
+
+  void begin(int nz, int /*nLines*/) {
+    sum.resize(nz);
+    sumSq.resize(nz);
+  }
+
+  void init(std::span<const T> self) {
+    for (size_t k = 0; k < sum.size(); ++k) {
+      sum[k] = self[k];
+      sumSq[k] = self[k] * self[k];
+    }
+  }
+
+  void add(int /*dj*/, std::span<const T> vp, std::span<const T> vm) {
+    for (size_t k = 0; k < sum.size(); ++k) {
+      sum[k] += vp[k] + vm[k];
+      sumSq[k] += vp[k] * vp[k] + vm[k] * vm[k];
+    }
+  }
+
+  void finish(std::span<const T> count, std::span<T> out) const {
+    for (size_t k = 0; k < sum.size(); ++k) {
+      const T denom = sumSq[k] * count[k];
+      const T cf = denom != 0 ? sum[k] * sum[k] / denom : T(1);
+      out[k] = sum[k] * cf / count[k];
+    }
+  }
+};
+
+/**
+Generalized coherence factor (Li and Li 2003): energy of the lowest spatial
+frequencies (|m| <= M0) of the aperture over the total energy,
+  GCF = sum_{|m| <= M0} |F(m)|^2 / (L sum_p a_p^2),
+with F the L point DFT of the aperture a_p over the L = 2 nLines - 1 line
+positions (the A-line's own samples at the centre, zero where a line isn't
+used at a depth). By Parseval it is in [0, 1]. The dj = 0 samples belong to
+the A-line itself: they only add to the output sum. M0 = 0 is the CF of the
+line positions, and a larger M0 is less harsh on targets that aren't exactly
+in focus. The spatial DFT is accumulated as the offsets come in, no aperture
+buffer.
+*/
+template <Floating T> struct GeneralizedCF {
+  int M0{1};
+
+  GeneralizedCF() = default;
+  explicit GeneralizedCF(int m0) : M0(m0) {}
+
+  std::vector<T> sum;    // All samples (the output)
+  std::vector<T> dc;     // F(0)
+  std::vector<T> energy; // sum_p a_p^2
+  std::vector<T> re;     // M x nz
+  std::vector<T> im;
+  std::vector<T> cosTab; // M x nLines
+  std::vector<T> sinTab;
+  size_t nz{};
+  int L{1};
+  int M{}; // M0, at most (L - 1) / 2 so no bin is counted twice
+
+  void begin(int nz_, int nLines) {
+    nz = nz_;
+    L = std::max(2 * nLines - 1, 1);
+    M = std::clamp(M0, 0, (L - 1) / 2);
+    sum.resize(nz);
+    dc.resize(nz);
+    energy.resize(nz);
+    re.resize(M * nz);
+    im.resize(M * nz);
+
+    // Positions -(nLines - 1) .. nLines - 1
+    cosTab.resize(M * nLines);
+    sinTab.resize(M * nLines);
+    for (int m = 1; m <= M; ++m) {
+      for (int dj = 0; dj < nLines; ++dj) {
+        const auto theta = 2 * std::numbers::pi * m * dj / L;
+        cosTab[(m - 1) * nLines + dj] = static_cast<T>(std::cos(theta));
+        sinTab[(m - 1) * nLines + dj] = static_cast<T>(std::sin(theta));
+      }
+    }
+  }
+
+  void init(std::span<const T> self) {
+    for (size_t k = 0; k < nz; ++k) {
+      sum[k] = self[k];
+      dc[k] = self[k];
+      energy[k] = self[k] * self[k];
+    }
+    for (int m = 0; m < M; ++m) {
+      std::copy(self.begin(), self.end(), re.begin() + m * nz);
+      std::fill_n(im.begin() + m * nz, nz, T(0));
+    }
+  }
+
+  void add(int dj, std::span<const T> vp, std::span<const T> vm) {
+    for (size_t k = 0; k < nz; ++k) {
+      sum[k] += vp[k] + vm[k];
+    }
+    if (dj == 0) {
+      return;
+    }
+
+    for (size_t k = 0; k < nz; ++k) {
+      dc[k] += vp[k] + vm[k];
+      energy[k] += vp[k] * vp[k] + vm[k] * vm[k];
+    }
+
+    const auto nLines = cosTab.size() / std::max(M, 1);
+    for (int m = 0; m < M; ++m) {
+      const T c = cosTab[m * nLines + dj];
+      const T s = sinTab[m * nLines + dj];
+      T *pre = re.data() + m * nz;
+      T *pim = im.data() + m * nz;
+      for (size_t k = 0; k < nz; ++k) {
+        // +dj: exp(-i theta), -dj: exp(i theta)
+        pre[k] += (vp[k] + vm[k]) * c;
+        pim[k] += (vm[k] - vp[k]) * s;
+      }
+    }
+  }
+
+  void finish(std::span<const T> count, std::span<T> out) const {
+    for (size_t k = 0; k < nz; ++k) {
+      T low = dc[k] * dc[k];
+      for (int m = 0; m < M; ++m) {
+        const T r = re[m * nz + k];
+        const T i = im[m * nz + k];
+        low += 2 * (r * r + i * i);
+      }
+      const T denom = energy[k] * static_cast<T>(L);
+      const T gcf = denom != 0 ? low / denom : T(1);
+      out[k] = sum[k] * gcf / count[k];
+    }
+  }
+};
+
+/**
+Short-lag spatial coherence (Lediju et al. 2011) used as a weight: the
+normalized correlation between aperture elements up to `maxLag` apart,
+computed over a depth kernel of +-halfKernel samples and averaged over the
+lags. out = sum(s) * max(SLSC, 0) / N.
+*/
+template <Floating T> struct SLSC {
+  int maxLag{5};
+  int halfKernel{8};
+
+  SLSC() = default;
+  SLSC(int lags, int kernel) : maxLag(lags), halfKernel(kernel) {}
+
+  std::vector<T> sum;
+  std::vector<T> aperture; // L x nz, element p at column p + nLines - 1
+  std::vector<uint8_t> valid;
+  int nz{};
+  int L{};
+  int center{};
+
+  // finish() scratch: lag sums, and depth prefix sums of the products
+  std::vector<double> slsc;
+  std::vector<double> rLag;
+  std::vector<int> nLag;
+  std::vector<double> cab;
+  std::vector<double> caa;
+  std::vector<double> cbb;
+
+  void begin(int nz_, int nLines) {
+    nz = nz_;
+    center = std::max(nLines - 1, 0);
+    L = 2 * center + 1;
+    sum.resize(nz);
+    aperture.resize(static_cast<size_t>(L) * nz);
+    valid.resize(L);
+
+    slsc.resize(nz);
+    rLag.resize(nz);
+    nLag.resize(nz);
+    cab.assign(nz + 1, 0.0); // [0] stays 0
+    caa.assign(nz + 1, 0.0);
+    cbb.assign(nz + 1, 0.0);
+  }
+
+  void init(std::span<const T> self) {
+    std::copy(self.begin(), self.end(), sum.begin());
+    std::copy(self.begin(), self.end(), aperture.begin() + center * nz);
+    std::fill(valid.begin(), valid.end(), 0);
+    valid[center] = 1;
+  }
+
+  void add(int dj, std::span<const T> vp, std::span<const T> vm) {
+    for (int k = 0; k < nz; ++k) {
+      sum[k] += vp[k] + vm[k];
+    }
+    // dj = 0 is the A-line itself
+    if (dj > 0) {
+      std::copy(vp.begin(), vp.end(), aperture.begin() + (center + dj) * nz);
+      std::copy(vm.begin(), vm.end(), aperture.begin() + (center - dj) * nz);
+      valid[center + dj] = 1;
+      valid[center - dj] = 1;
+    }
+  }
+
+  void finish(std::span<const T> count, std::span<T> out) {
+    std::fill(slsc.begin(), slsc.end(), 0.0);
+
+    const int lags = std::min(maxLag, L - 1);
+    for (int m = 1; m <= lags; ++m) {
+      std::fill(rLag.begin(), rLag.end(), 0.0);
+      std::fill(nLag.begin(), nLag.end(), 0);
+
+      for (int a = 0; a + m < L; ++a) {
+        const int b = a + m;
+        if (valid[a] == 0 || valid[b] == 0) {
+          continue;
+        }
+        const T *pa = aperture.data() + a * nz;
+        const T *pb = aperture.data() + b * nz;
+
+        // Prefix sums over depth for the kernel sums
+        for (int k = 0; k < nz; ++k) {
+          cab[k + 1] = cab[k] + static_cast<double>(pa[k]) * pb[k];
+          caa[k + 1] = caa[k] + static_cast<double>(pa[k]) * pa[k];
+          cbb[k + 1] = cbb[k] + static_cast<double>(pb[k]) * pb[k];
+        }
+
+        for (int k = 0; k < nz; ++k) {
+          const int lo = std::max(k - halfKernel, 0);
+          const int hi = std::min(k + halfKernel + 1, nz);
+          const double saa = caa[hi] - caa[lo];
+          const double sbb = cbb[hi] - cbb[lo];
+          if (saa > 0 && sbb > 0) {
+            rLag[k] += (cab[hi] - cab[lo]) / std::sqrt(saa * sbb);
+            ++nLag[k];
+          }
+        }
+      }
+
+      for (int k = 0; k < nz; ++k) {
+        if (nLag[k] > 0) {
+          slsc[k] += rLag[k] / nLag[k];
+        }
+      }
+    }
+
+    for (int k = 0; k < nz; ++k) {
+      const double w =
+          lags > 0 ? std::clamp(slsc[k] / lags, 0.0, 1.0) : 1.0;
+      out[k] = static_cast<T>(sum[k] * w / count[k]);
+    }
+  }
+};
+
+/**
+@brief Delay-and-sum of every A-line of `rf` with the delays of `table` and a
+coherence weighting `policy`, in one pass.
+
+Only the table's depth window [zStart, zEnd) is beamformed. The other rows of
+`out` are copied from `rf`, or left alone when `out` is `rf` (in place, only a
+buffer the size of the window is allocated). `out` keeps its memory when it
+already has the size of `rf`.
+*/
+template <typename Policy, Floating T>
+void das(const SaftDelayTable<T> &table, const arma::Mat<T> &rf,
+         arma::Mat<T> &out, const Policy &policy = {}) {
+  assert(table.nPts == static_cast<int>(rf.n_rows));
+  const int nScans = static_cast<int>(rf.n_cols);
+  const int nRows = static_cast<int>(rf.n_rows);
+  const int nz = table.nz();
+  const bool inPlace = &rf == &out;
+
+  // The window can't be written into `rf` while other columns still read it
+  arma::Mat<T> band;
+  if (inPlace) {
+    if (nz <= 0) {
+      return;
+    }
+    band.set_size(nz, nScans);
+  } else {
+    out.set_size(nRows, nScans);
+  }
+
+  // Gather form: output line j sums the delayed samples of lines j +- dj.
+  // Every output column is independent, so the columns run in parallel.
+  cv::parallel_for_(cv::Range(0, nScans), [&](const cv::Range &range) {
+    Policy p = policy;
+    p.begin(nz, table.nLines);
+    std::vector<T> vp(nz);
+    std::vector<T> vm(nz);
+    const std::span<const T> count{table.count.memptr(), table.count.n_elem};
+
+    // NOLINTBEGIN(*-pointer-arithmetic)
+    for (int j = range.start; j < range.end; ++j) {
+      const T *src = rf.colptr(j);
+      T *dst = inPlace ? band.colptr(j) : out.colptr(j) + table.zStart;
+
+      if (!inPlace) {
+        // Pass through the rows outside the window
+        std::copy(src, src + table.zStart, out.colptr(j));
+        std::copy(src + table.zEnd, src + nRows, out.colptr(j) + table.zEnd);
+      }
+      if (nz <= 0) {
+        continue;
+      }
+
+      p.init(std::span<const T>{src + table.zStart, static_cast<size_t>(nz)});
+
+      for (int dj = 0; dj < table.nLines; ++dj) {
+        const T *xp = rf.colptr((j + dj) % nScans);
+        const T *xm = rf.colptr((j - dj + nScans) % nScans);
+        const int32_t *idx = table.index.colptr(dj);
+        const T *w0 = table.w0.colptr(dj);
+        const T *w1 = table.w1.colptr(dj);
+
+        for (int k = 0; k < nz; ++k) {
+          const int i = idx[k];
+          vp[k] = w0[k] * xp[i] + w1[k] * xp[i + 1];
+          vm[k] = w0[k] * xm[i] + w1[k] * xm[i + 1];
+        }
+        p.add(dj, vp, vm);
+      }
+
+      p.finish(count, std::span<T>{dst, static_cast<size_t>(nz)});
+    }
+    // NOLINTEND(*-pointer-arithmetic)
+  });
+
+  if (inPlace) {
+    out.rows(table.zStart, table.zEnd - 1) = band;
+  }
+}
+
+/**
+@brief In place `das`: only rows [zStart, zEnd) of `rf` are modified.
+*/
+template <typename Policy, Floating T>
+void das(const SaftDelayTable<T> &table, arma::Mat<T> &rf,
+         const Policy &policy = {}) {
+  das<Policy, T>(table, rf, rf, policy);
+}
+
+} // namespace uspam::beamformer
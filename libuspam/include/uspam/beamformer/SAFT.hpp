@@ -1,8 +1,13 @@
 #pragma once
 
+#include "uspam/beamformer/DAS.hpp"
 #include "uspam/beamformer/common.hpp"
+#include <algorithm>
 #include <armadillo>
 #include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
 #include <numbers>
 #include <tuple>
 #include <uspam/fft.hpp>
@@ -119,72 +124,91 @@ template <Floating FloatType>
   return TimeDelay<FloatType>{timeDelay, nLines, zStart, zEnd};
 }
 
-template <typename RfType, Floating FloatType>
-auto apply_saft(const TimeDelay<FloatType> &timeDelay,
-                const arma::Mat<RfType> &rf) {
-  const int nScans = rf.n_cols;
-  const int nPts = rf.n_rows;
-
-  arma::Mat<RfType> rf_saft = rf; // copy
-  arma::Mat<uint8_t> n_saft(rf.n_rows, rf.n_cols, arma::fill::ones);
-
-  arma::Mat<FloatType> CF_denom = arma::square(rf);
-
-  for (int j = 0; j < nScans; ++j) {
-    for (int iz = timeDelay.zStart; iz < timeDelay.zEnd; ++iz) {
-      for (int dj_saft = 0;
-           dj_saft < timeDelay.saftLines(iz - timeDelay.zStart); ++dj_saft) {
-
-        const int iz_delayed = static_cast<int>(std::round(
-            iz + timeDelay.timeDelay(iz - timeDelay.zStart, dj_saft)));
-
-        if (iz_delayed >= nPts) {
-          continue;
-        }
-
-        const auto val = rf(iz_delayed, j);
-
-        {
-          const auto j_saft = (j - dj_saft + nScans) % nScans;
-          rf_saft(iz, j_saft) += val;
-          CF_denom(iz, j_saft) += val * val;
-          n_saft(iz, j_saft) += 1;
-        }
+template <Floating FloatType>
+[[nodiscard]] auto makeSaftDelayTable(const TimeDelay<FloatType> &timeDelay,
+                                      const int nPts) {
+  SaftDelayTable<FloatType> table;
+  table.zStart = std::clamp(timeDelay.zStart, 0, nPts);
+  table.zEnd = std::clamp(timeDelay.zEnd, table.zStart, nPts);
+  table.nPts = nPts;
+
+  const int nz = table.nz();
+  table.nLines =
+      nz > 0 ? static_cast<int>(arma::max(timeDelay.saftLines.head(nz))) : 0;
+
+  table.index.set_size(nz, table.nLines);
+  table.w0.zeros(nz, table.nLines);
+  table.w1.zeros(nz, table.nLines);
+  table.count.ones(nz);
+
+  for (int dj = 0; dj < table.nLines; ++dj) {
+    for (int k = 0; k < nz; ++k) {
+      const int iz = table.zStart + k;
+      table.index(k, dj) = iz; // safe default, weights stay 0
+      if (dj >= timeDelay.saftLines(iz - timeDelay.zStart)) {
+        continue;
+      }
 
-        {
-          const auto j_saft = (j + dj_saft + nScans) % nScans;
-          rf_saft(iz, j_saft) += val;
-          CF_denom(iz, j_saft) += val * val;
-          n_saft(iz, j_saft) += 1;
-        }
+      const FloatType delayed =
+          iz + timeDelay.timeDelay(iz - timeDelay.zStart, dj);
+      const auto i0 = static_cast<int>(std::floor(delayed));
+      if (i0 < 0 || i0 + 1 >= nPts) {
+        continue;
       }
+
+      const FloatType frac = delayed - i0;
+      table.index(k, dj) = i0;
+      table.w0(k, dj) = 1 - frac;
+      table.w1(k, dj) = frac;
+      table.count(k) += 2;
     }
   }
 
-  // CF = PA_saft ** 2 / (CF_denom * n_saft)
-  arma::Mat<FloatType> CF(rf_saft.n_rows, rf_saft.n_cols, arma::fill::zeros);
+  return table;
+}
 
-  // rf_saft_cf = rf_saft * CF / n_saft
-  arma::Mat<FloatType> rf_saft_cf(rf_saft.n_rows, rf_saft.n_cols,
-                                  arma::fill::zeros);
+/**
+@brief SAFT and SAFT + coherence factor of `rf`.
+@return tuple(rf_saft, rf_saft_cf)
+*/
+template <typename RfType, Floating FloatType>
+auto apply_saft(const SaftDelayTable<FloatType> &table,
+                const arma::Mat<RfType> &rf) {
+  const auto &x = arma::conv_to<arma::Mat<FloatType>>::from(rf);
 
-  for (int col = 0; col < rf_saft.n_cols; ++col) {
-    for (int row = 0; row < rf_saft.n_rows; ++row) {
-      const auto nom = rf_saft(row, col) * rf_saft(row, col);
-      const auto denom = CF_denom(row, col) * n_saft(row, col);
+  arma::Mat<FloatType> rf_saft;
+  arma::Mat<FloatType> rf_saft_cf;
+  das<DASSum<FloatType>>(table, x, rf_saft);
+  das<CoherenceFactor<FloatType>>(table, x, rf_saft_cf);
 
-      if (denom != 0) {
-        CF(row, col) = nom / denom;
-      } else {
-        CF(row, col) = 1;
-      }
+  return std::tuple(arma::conv_to<arma::Mat<RfType>>::from(rf_saft),
+                    rf_saft_cf);
+}
 
-      rf_saft_cf(row, col) =
-          rf_saft(row, col) * CF(row, col) / n_saft(row, col);
-    }
-  }
+template <typename RfType, Floating FloatType>
+auto apply_saft(const TimeDelay<FloatType> &timeDelay,
+                const arma::Mat<RfType> &rf) {
+  return apply_saft<RfType, FloatType>(
+      makeSaftDelayTable(timeDelay, static_cast<int>(rf.n_rows)), rf);
+}
 
-  return std::tuple(rf_saft, rf_saft_cf);
+/**
+@brief Delay table of the default SAFT geometry (`SaftDelayParams::make()`) for
+A-lines of `nPts` samples. Built on first use and shared by all threads.
+*/
+template <Floating FloatType>
+const SaftDelayTable<FloatType> &defaultSaftDelayTable(const int nPts) {
+  static std::mutex mtx;
+  static std::map<int, SaftDelayTable<FloatType>> cache;
+
+  std::lock_guard lock(mtx);
+  auto it = cache.find(nPts);
+  if (it == cache.end()) {
+    const auto timeDelay =
+        computeSaftTimeDelay<FloatType>(SaftDelayParams<FloatType>::make());
+    it = cache.emplace(nPts, makeSaftDelayTable(timeDelay, nPts)).first;
+  }
+  return it->second;
 }
 
 } // namespace uspam::beamformer
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "uspam/beamformer/DAS.hpp"
 #include "uspam/beamformer/SAFT.hpp"
+#include <algorithm>
 #include <type_traits>
 
 namespace uspam::beamformer {
@@ -9,33 +11,36 @@ enum class BeamformerType {
   NONE,
   SAFT,
   SAFT_CF,
+  SAFT_GCF,  // Generalized coherence factor
+  SAFT_SLSC, // Short-lag spatial coherence weighting
 };
 
+// `rfBeamformed` may be `rf` to beamform in place
 template <typename T>
 void beamform(const arma::Mat<T> &rf, arma::Mat<T> &rfBeamformed,
               BeamformerType beamformer)
   requires std::is_floating_point_v<T>
 {
+  const auto table = [&]() -> const SaftDelayTable<T> & {
+    return defaultSaftDelayTable<T>(static_cast<int>(rf.n_rows));
+  };
+
   switch (beamformer) {
-  case BeamformerType::SAFT: {
-    const auto saftParams = uspam::beamformer::SaftDelayParams<T>::make();
-    const auto timeDelay =
-        uspam::beamformer::computeSaftTimeDelay<T>(saftParams);
-    const auto [rfSaft, rfSaftCF] =
-        uspam::beamformer::apply_saft<T, T>(timeDelay, rf);
-
-    rfBeamformed = rfSaft;
-  } break;
-
-  case BeamformerType::SAFT_CF: {
-    const auto saftParams = uspam::beamformer::SaftDelayParams<T>::make();
-    const auto timeDelay =
-        uspam::beamformer::computeSaftTimeDelay<T>(saftParams);
-    const auto [rfSaft, rfSaftCF] =
-        uspam::beamformer::apply_saft<T, T>(timeDelay, rf);
-
-    rfBeamformed = rfSaftCF;
-  } break;
+  case BeamformerType::SAFT:
+    das<DASSum<T>>(table(), rf, rfBeamformed);
+    break;
+
+  case BeamformerType::SAFT_CF:
+    das<CoherenceFactor<T>>(table(), rf, rfBeamformed);
+    break;
+
+  case BeamformerType::SAFT_GCF:
+    das<GeneralizedCF<T>>(table(), rf, rfBeamformed);
+    break;
+
+  case BeamformerType::SAFT_SLSC:
+    das<SLSC<T>>(table(), rf, rfBeamformed);
+    break;
 
   case BeamformerType::NONE:
   default:
@@ -43,4 +48,16 @@ void beamform(const arma::Mat<T> &rf, arma::Mat<T> &rfBeamformed,
   }
 }
 
+// Number of A-lines on each side of an output A-line that `beamform` reads
+// (the neighbourhood wraps around the B-scan)
+template <typename T>
+int beamformHalfWidth(const int nRows, BeamformerType beamformer)
+  requires std::is_floating_point_v<T>
+{
+  if (beamformer == BeamformerType::NONE) {
+    return 0;
+  }
+  return std::max(defaultSaftDelayTable<T>(nRows).nLines - 1, 0);
+}
+
 } // namespace uspam::beamformer
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "uspam/ioParams.hpp"
+#include "uspam/mappedFile.hpp"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace uspam::io {
+namespace fs = std::filesystem;
+
+// Fast non-cryptographic 64 bit hash used to detect changed or corrupt frames.
+[[nodiscard]] uint64_t hash64(std::span<const std::byte> data,
+                              uint64_t seed = 0);
+
+struct BinfileIndexHeader {
+  static constexpr std::array<char, 8> MAGIC{'A', 'R', 'P', 'A',
+                                             'M', 'I', 'D', 'X'};
+  static constexpr uint32_t VERSION = 1;
+
+  std::array<char, 8> magic{MAGIC};
+  uint32_t version{VERSION};
+  uint32_t numFrames{};
+
+  // Binfile size and modification time when the index was built. The index
+  // is rebuilt if either no longer matches.
+  uint64_t fileSize{};
+  int64_t mtime{};
+
+  uint32_t byteOffset{};
+  uint32_t alineSize{};
+  uint32_t alinesPerBscan{};
+  // Bytes after the last complete frame (a truncated recording)
+  uint32_t trailingBytes{};
+
+  // Thumbnails are stored row major, rows = depth, cols = A-lines
+  uint16_t thumbWidth{};
+  uint16_t thumbHeight{};
+  std::array<uint8_t, 12> reserved{}; // Pad to 64 bytes
+};
+static_assert(sizeof(BinfileIndexHeader) == 64);
+
+enum BinfileFrameFlags : uint32_t {
+  FRAME_OK = 0,
+  FRAME_FLAT = 1U << 0,      // All samples equal (e.g. zero filled)
+  FRAME_SATURATED = 1U << 1, // Too many samples at the ADC rails
+  FRAME_DUPLICATE = 1U << 2, // Bit identical to the previous frame
+};
+
+struct BinfileFrameEntry {
+  uint64_t offset{}; // Byte offset of the frame in the binfile
+  uint64_t hash{};
+  // Raw ADC counts
+  float min{};
+  float max{};
+  float mean{};
+  uint32_t flags{};
+};
+static_assert(sizeof(BinfileFrameEntry) == 32);
+
+/**
+@brief Sidecar index (`<binfile>.idx`) with per-frame offsets, hashes, signal
+statistics and tiny thumbnails of a uint16 binfile.
+
+The index is built once in parallel the first time a binfile is opened, then
+memory mapped on subsequent opens so the frame count, thumbnails and integrity
+warnings are available before any reconstruction runs.
+
+Layout: BinfileIndexHeader | BinfileFrameEntry[numFrames] |
+        uint8 thumbnails[numFrames][thumbHeight][thumbWidth]
+*/
+class BinfileIndex {
+public:
+  static constexpr int THUMB_WIDTH = 64;
+  static constexpr int THUMB_HEIGHT = 32;
+  // Fraction of samples at the ADC rails above which a frame is saturated
+  static constexpr double SATURATED_FRACTION = 0.05;
+
+  BinfileIndex() = default;
+
+  [[nodiscard]] static fs::path indexPath(const fs::path &binfile) {
+    auto path = binfile;
+    path += ".idx";
+    return path;
+  }
+
+  /**
+  Load the sidecar index for `binfile`, building (and saving) it first if it
+  doesn't exist or is stale.
+  */
+  bool open(const fs::path &binfile, int byteOffset,
+            int alinesPerBscan = NUM_ALINES_DETAULT);
+
+  // Scan `binfile` in parallel and write the index to `indexFile`.
+  static bool build(const fs::path &binfile, const fs::path &indexFile,
+                    int byteOffset, int alinesPerBscan = NUM_ALINES_DETAULT);
+
+  // Memory map an existing index. Fails if it doesn't match `binfile`.
+  bool load(const fs::path &indexFile, const fs::path &binfile);
+
+  void close() { m_file.close(); }
+
+  [[nodiscard]] bool isOpen() const { return m_file.isOpen(); }
+
+  [[nodiscard]] int size() const {
+    return isOpen() ? static_cast<int>(header().numFrames) : 0;
+  }
+
+  [[nodiscard]] const BinfileIndexHeader &header() const {
+    // NOLINTNEXTLINE(*-reinterpret-cast)
+    return *reinterpret_cast<const BinfileIndexHeader *>(m_file.data());
+  }
+
+  [[nodiscard]] std::span<const BinfileFrameEntry> entries() const;
+
+  [[nodiscard]] const BinfileFrameEntry &entry(int frameIdx) const {
+    return entries()[frameIdx];
+  }
+
+  // Thumbnail of a frame, row major (thumbHeight x thumbWidth)
+  [[nodiscard]] std::span<const uint8_t> thumbnail(int frameIdx) const;
+
+  // Indices of frames with any flag set
+  [[nodiscard]] std::vector<int> flaggedFrames() const;
+
+  // Check a frame's raw bytes against its stored hash
+  [[nodiscard]] bool verifyFrame(int frameIdx,
+                                 std::span<const std::byte> data) const {
+    return hash64(data) == entry(frameIdx).hash;
+  }
+
+private:
+  MappedFile m_file;
+};
+
+} // namespace uspam::io
@@ -0,0 +1,257 @@
+#pragma once
+
+#include "uspam/io.hpp"
+#include "uspam/ioParams.hpp"
+#include <algorithm>
+#include <armadillo>
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace uspam::io {
+namespace fs = std::filesystem;
+
+/**
+@brief Virtual dataset that concatenates several binfiles (e.g. a long pullback
+split across files) into one sequence with a global frame index.
+
+Only the file sizes are read on `open`. The BinfileLoader of each file is
+opened lazily on first access and at most `maxOpenFiles` are kept open (least
+recently used are closed). After every `get`, the next frame is prefetched in
+the background, including across file boundaries, so sequential playback
+doesn't stall at the start of a new file.
+
+The interface mirrors BinfileLoader (`size`, `get<T>(idx)`) so it can be used
+as a drop in replacement.
+*/
+template <typename TypeInBin> class BinfileSequence {
+public:
+  static constexpr int maxOpenFiles = 4;
+
+  BinfileSequence() = default;
+  BinfileSequence(const BinfileSequence &) = delete;
+  BinfileSequence(BinfileSequence &&) = delete;
+  BinfileSequence &operator=(const BinfileSequence &) = delete;
+  BinfileSequence &operator=(BinfileSequence &&) = delete;
+  ~BinfileSequence() { close(); }
+
+  void setParams(const IOParams &ioparams,
+                 int alinesPerBscan = NUM_ALINES_DETAULT) {
+    m_ioparams = ioparams;
+    m_alinesPerBscan = alinesPerBscan;
+  }
+
+  // Index the files. Throws std::runtime_error if a file cannot be read.
+  void open(const std::vector<fs::path> &files) {
+    close();
+
+    std::lock_guard lock(m_mtx);
+    const auto scanSize = static_cast<uintmax_t>(RF_ALINE_SIZE) *
+                          m_alinesPerBscan * sizeof(TypeInBin);
+
+    m_offsets.assign(1, 0);
+    for (const auto &file : files) {
+      std::error_code ec;
+      const auto fsize = fs::file_size(file, ec);
+      if (ec) {
+        m_files.clear();
+        m_offsets.assign(1, 0);
+        throw std::runtime_error(
+            std::string("[BinfileSequence] Failed to open file ") +
+            file.generic_string());
+      }
+      const auto byteOffset = static_cast<uintmax_t>(m_ioparams.byte_offset);
+      const auto numScans =
+          fsize > byteOffset ? static_cast<int>((fsize - byteOffset) / scanSize)
+                             : 0;
+
+      m_files.push_back({file, nullptr, 0});
+      m_offsets.push_back(m_offsets.back() + numScans);
+    }
+  }
+
+  void open(const fs::path &file) { open(std::vector<fs::path>{file}); }
+
+  void close() {
+    waitPrefetch();
+    std::lock_guard lock(m_mtx);
+    m_files.clear();
+    m_offsets.assign(1, 0);
+  }
+
+  [[nodiscard]] bool isOpen() const {
+    std::lock_guard lock(m_mtx);
+    return !m_files.empty();
+  }
+
+  // Total number of frames across all files
+  [[nodiscard]] int size() const {
+    std::lock_guard lock(m_mtx);
+    return m_offsets.back();
+  }
+
+  [[nodiscard]] int numFiles() const {
+    std::lock_guard lock(m_mtx);
+    return static_cast<int>(m_files.size());
+  }
+
+  [[nodiscard]] fs::path file(int fileIdx) const {
+    std::lock_guard lock(m_mtx);
+    return m_files.at(fileIdx).path;
+  }
+
+  // Global index of the first frame in a file
+  [[nodiscard]] int fileStart(int fileIdx) const {
+    std::lock_guard lock(m_mtx);
+    return m_offsets.at(fileIdx);
+  }
+
+  // Map a global frame index to {file index, frame index within the file}
+  [[nodiscard]] std::pair<int, int> locate(int idx) const {
+    std::lock_guard lock(m_mtx);
+    return locateImpl(idx);
+  }
+
+  // Frame index within its file. Scan direction (flip) alternates per file.
+  [[nodiscard]] int localIndex(int idx) const { return locate(idx).second; }
+
+  /**
+  Read the frame at global index `idx` into `rf`. If T differs from TypeInBin
+  the samples are scaled to voltage like BinfileLoader::get.
+  */
+  template <typename T> bool get(arma::Mat<T> &rf, int idx) {
+    arma::Mat<TypeInBin> raw;
+    bool ok = false;
+
+    // Use the prefetched frame if it's the one requested
+    if (m_prefetch.valid() && m_prefetchIdx == idx) {
+      std::tie(ok, raw) = m_prefetch.get();
+    } else {
+      waitPrefetch();
+      ok = readRaw(idx, raw);
+    }
+
+    if (ok) {
+      if constexpr (std::is_same_v<T, TypeInBin>) {
+        rf = std::move(raw);
+      } else {
+        adc_to_voltage(raw, rf);
+      }
+    }
+
+    // Prefetch the next frame (possibly from the next file)
+    if (idx + 1 < size()) {
+      m_prefetchIdx = idx + 1;
+      m_prefetch = std::async(std::launch::async, [this, next = idx + 1] {
+        arma::Mat<TypeInBin> buf;
+        const bool readOk = readRaw(next, buf);
+        return std::pair{readOk, std::move(buf)};
+      });
+    }
+
+    return ok;
+  }
+
+  template <typename T> auto get(int idx) -> arma::Mat<T> {
+    arma::Mat<T> out;
+    get(out, idx);
+    return out;
+  }
+
+private:
+  struct FileHandle {
+    fs::path path;
+    std::shared_ptr<BinfileLoader<TypeInBin>> loader;
+    uint64_t lastUsed{};
+  };
+
+  std::pair<int, int> locateImpl(int idx) const {
+    assert(idx >= 0 && idx < m_offsets.back());
+    const auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), idx);
+    const auto fileIdx = static_cast<int>(it - m_offsets.begin()) - 1;
+    return {fileIdx, idx - m_offsets[fileIdx]};
+  }
+
+  // Get the (lazily opened) loader of a file. Closes the least recently used
+  // loader when too many are open.
+  std::shared_ptr<BinfileLoader<TypeInBin>> acquire(int fileIdx) {
+    std::lock_guard lock(m_mtx);
+    auto &handle = m_files[fileIdx];
+    handle.lastUsed = ++m_useCounter;
+
+    if (!handle.loader) {
+      int numOpen = 0;
+      FileHandle *lru = nullptr;
+      for (auto &h : m_files) {
+        if (h.loader) {
+          ++numOpen;
+          if (lru == nullptr || h.lastUsed < lru->lastUsed) {
+            lru = &h;
+          }
+        }
+      }
+      if (numOpen >= maxOpenFiles && lru != nullptr) {
+        // In flight reads keep their own reference
+        lru->loader.reset();
+      }
+
+      auto loader = std::make_shared<BinfileLoader<TypeInBin>>();
+      loader->setParams(m_ioparams, m_alinesPerBscan);
+      loader->open(handle.path);
+      handle.loader = std::move(loader);
+    }
+    return handle.loader;
+  }
+
+  bool readRaw(int idx, arma::Mat<TypeInBin> &raw) {
+    int fileIdx{};
+    int localIdx{};
+    {
+      std::lock_guard lock(m_mtx);
+      if (idx < 0 || idx >= m_offsets.back()) {
+        return false;
+      }
+      std::tie(fileIdx, localIdx) = locateImpl(idx);
+    }
+
+    try {
+      const auto loader = acquire(fileIdx);
+      return loader->get(raw, localIdx);
+    } catch (const std::runtime_error &e) {
+      std::cerr << e.what() << "\n";
+      return false;
+    }
+  }
+
+  void waitPrefetch() {
+    if (m_prefetch.valid()) {
+      m_prefetch.wait();
+      m_prefetch = {};
+    }
+  }
+
+  IOParams m_ioparams{};
+  int m_alinesPerBscan{NUM_ALINES_DETAULT};
+
+  mutable std::mutex m_mtx;
+  std::vector<FileHandle> m_files;
+  // Prefix sum of frames per file. m_offsets[i] is the global index of the
+  // first frame in file i, m_offsets.back() the total number of frames.
+  std::vector<int> m_offsets{0};
+  uint64_t m_useCounter{};
+
+  // Only accessed from the thread calling `get`
+  std::future<std::pair<bool, arma::Mat<TypeInBin>>> m_prefetch;
+  int m_prefetchIdx{-1};
+};
+
+} // namespace uspam::io
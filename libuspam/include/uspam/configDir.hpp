@@ -0,0 +1,22 @@
+#pragma once
+
+#include <filesystem>
+
+namespace uspam {
+namespace fs = std::filesystem;
+
+/**
+@brief Per user directory for persisted state (calibration results, FFTW
+wisdom etc.). Created on first call.
+
+- `USPAM_CONFIG_DIR` if set
+- Windows: `%APPDATA%/ARPAM`
+- macOS: `~/Library/Application Support/ARPAM`
+- Otherwise: `$XDG_CONFIG_HOME/arpam` or `~/.config/arpam`
+
+Returns an empty path if no directory could be determined or created, in which
+case callers should skip persisting.
+*/
+[[nodiscard]] fs::path configDir();
+
+} // namespace uspam
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "uspam/frameTable.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace uspam::metrics {
+
+/**
+@brief Reduction of one log compressed A-line over a depth window, for
+en-face (angle x frame) maps.
+*/
+struct AlineProjection {
+  uint8_t max{};  // Maximum intensity projection
+  float mean{};   // Mean intensity (integrated intensity / window length)
+  int argmax{-1}; // Row of the first maximum (-1 for an empty window)
+};
+
+/**
+@brief Max, mean and first row of the max of rows [rowBegin, rowEnd) of one
+column, with SIMD. The rows are clamped to the column.
+*/
+AlineProjection project(std::span<const uint8_t> col, int rowBegin = 0,
+                        int rowEnd = -1);
+
+/**
+@brief Where a log compression pass writes the projection of its output:
+alines[j] is the projection of rows [rowBegin, rowEnd) of column j. A
+negative rowEnd means to the end of the column. Disabled if alines is empty.
+*/
+struct ProjectionTarget {
+  std::span<AlineProjection> alines;
+  int rowBegin{};
+  int rowEnd{-1};
+
+  [[nodiscard]] bool enabled() const { return !alines.empty(); }
+};
+
+/**
+@brief Projection of every A-line of a frame of rfLog (see
+ReconParams::enfaceDepthBegin_mm).
+*/
+struct FrameProjection {
+  std::vector<AlineProjection> alines;
+  float mmPerRow{}; // Depth [mm] of one rfLog row
+};
+
+/**
+@brief En-face maps (frames x A-lines) of the A-line projections of a
+sequence. Frames not set yet are NaN.
+*/
+class EnFaceMap : public FrameTable {
+public:
+  // Fields stored per A-line (last dimension of the .npy file)
+  enum Field { Max = 0, Mean, DepthOfMax, NumFields };
+
+  EnFaceMap();
+  EnFaceMap(int numFrames, int numAlines) : EnFaceMap() {
+    resize(numFrames, numAlines);
+  }
+
+  // The depth of the max is in mm if `mmPerRow` > 0, else in rows. A-lines
+  // beyond numAlines() are ignored.
+  void setFrame(int frameIdx, std::span<const AlineProjection> alines,
+                float mmPerRow = 0);
+};
+
+} // namespace uspam::metrics
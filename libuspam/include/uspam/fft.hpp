@@ -2,6 +2,7 @@
 
 #include <complex>
 #include <cstdlib>
+#include <filesystem>
 #include <fftw3.h>
 #include <span>
 #include <type_traits>
@@ -151,6 +152,29 @@ inline Plan<float> plan_dft_c2r_1d(int n, Complex<float> *in, float *out,
 
 namespace uspam::fft {
 
+/**
+@brief FFTW planner rigor (FFTW_ESTIMATE, FFTW_MEASURE, FFTW_PATIENT) used by
+all engines created after the call. Defaults to FFTW_ESTIMATE. Plans made with a
+lower rigor still use wisdom gathered at a higher one, so the usual setup is to
+tune once with FFTW_MEASURE/PATIENT and save the wisdom.
+
+Only the uspam::fft engines use these flags. fftconv (the FFT path of
+fir::convolve) makes its own plans with its own flags.
+*/
+[[nodiscard]] unsigned planner_flags();
+void set_planner_flags(unsigned flags);
+
+/**
+@brief Load/save FFTW (double) and FFTWf (float) wisdom from/to
+`configDir()`. Both return false if a file couldn't be read/written (a missing
+wisdom file on load is not an error).
+*/
+bool load_wisdom();
+bool save_wisdom(); // NOLINT(*-nodiscard)
+
+// Paths of the double and float wisdom files (empty if no config dir)
+[[nodiscard]] std::filesystem::path wisdom_file(bool singlePrecision);
+
 // In memory cache with key type K and value type V
 // additionally accepts a mutex to guard the V constructor
 template <class Key, class Val> auto get_cached(Key key) {
@@ -177,7 +201,7 @@ template <Floating T> struct engine_r2c_1d {
       : real(fftw::alloc_real<T>(n), n),
         complex(fftw::alloc_complex<T>(n / 2 + 1), n / 2 + 1),
         plan(fftw::plan_dft_r2c_1d(static_cast<int>(n), real.data(),
-                                   complex.data(), FFTW_ESTIMATE)) {}
+                                   complex.data(), planner_flags())) {}
   engine_r2c_1d(const engine_r2c_1d &) = delete;
   auto operator=(const engine_r2c_1d &) -> engine_r2c_1d & = delete;
   engine_r2c_1d(engine_r2c_1d &&) = delete;
@@ -205,7 +229,7 @@ template <Floating T> struct engine_c2r_1d {
       : real(fftw::alloc_real<T>(n), n),
         complex(fftw::alloc_complex<T>(n / 2 + 1), n / 2 + 1),
         plan(fftw::plan_dft_c2r_1d<T>(static_cast<int>(n), complex.data(),
-                                      real.data(), FFTW_ESTIMATE)) {}
+                                      real.data(), planner_flags())) {}
   engine_c2r_1d(const engine_c2r_1d &) = delete;
   auto operator=(const engine_c2r_1d &) -> engine_c2r_1d & = delete;
   engine_c2r_1d(engine_c2r_1d &&) = delete;
@@ -234,9 +258,9 @@ template <typename T> struct fftw_engine_half_cx_1d {
       : real(fftw::alloc_real<T>(n), n),
         complex(fftw::alloc_complex<T>(n / 2 + 1), n / 2 + 1),
         plan_f(fftw::plan_dft_r2c_1d(static_cast<int>(n), real.data(),
-                                     complex.data(), FFTW_ESTIMATE)),
+                                     complex.data(), planner_flags())),
         plan_b(fftw::plan_dft_c2r_1d(static_cast<int>(n), complex.data(),
-                                     real.data(), FFTW_ESTIMATE)) {}
+                                     real.data(), planner_flags())) {}
   fftw_engine_half_cx_1d(const fftw_engine_half_cx_1d &) = default;
   auto operator=(const fftw_engine_half_cx_1d &) -> fftw_engine_half_cx_1d & =
                                                         default;
@@ -268,9 +292,9 @@ template <typename T> struct fftw_engine_1d {
   explicit fftw_engine_1d(size_t n)
       : in(fftw::alloc_complex<T>(n), n), out(fftw::alloc_complex<T>(n), n),
         plan_f(fftw::plan_dft_1d<T>(static_cast<int>(n), in.data(), out.data(),
-                                    FFTW_FORWARD, FFTW_ESTIMATE)),
+                                    FFTW_FORWARD, planner_flags())),
         plan_b(fftw::plan_dft_1d<T>(static_cast<int>(n), out.data(), in.data(),
-                                    FFTW_BACKWARD, FFTW_ESTIMATE)) {}
+                                    FFTW_BACKWARD, planner_flags())) {}
   fftw_engine_1d(const fftw_engine_1d &) = default;
   auto operator=(const fftw_engine_1d &) -> fftw_engine_1d & = default;
   fftw_engine_1d(fftw_engine_1d &&) = delete;
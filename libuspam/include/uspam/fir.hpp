@@ -0,0 +1,280 @@
+#pragma once
+
+#include "fftconv.hpp"
+#include "uspam/fft.hpp"
+#include "uspam/timeit.hpp"
+#include <algorithm>
+#include <array>
+#include <armadillo>
+#include <cassert>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <span>
+
+namespace uspam::fir {
+namespace fs = std::filesystem;
+
+enum class Method {
+  Auto,   // Pick the faster of Direct and FFT (see Dispatcher)
+  Direct, // Time domain, cache blocked across several A-lines
+  FFT,    // Overlap-add FFT convolution (fftconv)
+};
+
+[[nodiscard]] const char *toString(Method method);
+
+namespace details {
+
+// Output samples per tile and A-lines processed together. One tile of
+// accumulators for all columns (4 * 512 * 8 bytes) stays in L1.
+constexpr int TILE = 512;
+constexpr int COLS = 4;
+
+// "same" mode direct convolution of up to COLS columns of length n.
+// y[i] = sum_k kernel[k] * x[i + ntaps / 2 - k], x is zero outside [0, n)
+template <Floating T>
+void convolveDirectCols(const std::array<const T *, COLS> &xs,
+                        const std::array<T *, COLS> &ys, const int ncols,
+                        const int n, const std::span<const T> kernel) {
+  const auto ntaps = static_cast<int>(kernel.size());
+  const int center = ntaps / 2;
+
+  alignas(64) std::array<std::array<T, TILE>, COLS> acc; // NOLINT
+
+  // NOLINTBEGIN(*-pointer-arithmetic,*-constant-array-index)
+  for (int i0 = 0; i0 < n; i0 += TILE) {
+    const int len = std::min(TILE, n - i0);
+    for (int c = 0; c < ncols; ++c) {
+      std::fill_n(acc[c].begin(), len, T{});
+    }
+
+    for (int k = 0; k < ntaps; ++k) {
+      // Outputs of this tile whose input sample for tap k is inside x
+      const int tBegin = std::max(0, k - center - i0);
+      const int tEnd = std::min(len, n + k - center - i0);
+      if (tBegin >= tEnd) {
+        continue;
+      }
+
+      // The inner loop is contiguous and free of aliasing, which lets the
+      // compiler vectorize it. The tap is reused across the columns.
+      const T h = kernel[k];
+      const int xOffset = i0 + center - k + tBegin;
+      const int cnt = tEnd - tBegin;
+      for (int c = 0; c < ncols; ++c) {
+        const T *xp = xs[c] + xOffset;
+        T *a = acc[c].data() + tBegin;
+        for (int t = 0; t < cnt; ++t) {
+          a[t] += h * xp[t];
+        }
+      }
+    }
+
+    for (int c = 0; c < ncols; ++c) {
+      std::copy_n(acc[c].begin(), len, ys[c] + i0);
+    }
+  }
+  // NOLINTEND(*-pointer-arithmetic,*-constant-array-index)
+}
+
+} // namespace details
+
+/**
+@brief Direct form "same" convolution of every column of `x` with `kernel`.
+Equivalent to `fftconv::oaconvolve_fftw_same` per column. `y` must not alias
+`x`.
+*/
+template <Floating T>
+void convolveDirect(const arma::Mat<T> &x, const std::span<const T> kernel,
+                    arma::Mat<T> &y) {
+  using details::COLS;
+  assert(&x != &y);
+  y.set_size(x.n_rows, x.n_cols);
+
+  const auto n = static_cast<int>(x.n_rows);
+  const auto ncolsTotal = static_cast<int>(x.n_cols);
+  for (int j = 0; j < ncolsTotal; j += COLS) {
+    const int ncols = std::min(COLS, ncolsTotal - j);
+    std::array<const T *, COLS> xs{};
+    std::array<T *, COLS> ys{};
+    for (int c = 0; c < ncols; ++c) {
+      xs[c] = x.colptr(j + c); // NOLINT(*-constant-array-index)
+      ys[c] = y.colptr(j + c); // NOLINT(*-constant-array-index)
+    }
+    details::convolveDirectCols<T>(xs, ys, ncols, n, kernel);
+  }
+}
+
+/**
+@brief Overlap-add FFT "same" convolution of every column of `x` with `kernel`.
+*/
+template <Floating T>
+void convolveFFT(const arma::Mat<T> &x, const std::span<const T> kernel,
+                 arma::Mat<T> &y) {
+  assert(&x != &y);
+  y.set_size(x.n_rows, x.n_cols);
+
+  for (int j = 0; j < static_cast<int>(x.n_cols); ++j) {
+    const std::span<const T> src{x.colptr(j), x.n_rows};
+    const std::span<T> dst{y.colptr(j), y.n_rows};
+    fftconv::oaconvolve_fftw_same<T>(src, kernel, dst);
+  }
+}
+
+/**
+@brief Remembers which convolution method is faster for a given
+(signal length, taps, dtype, batch size).
+
+Shapes are calibrated by tune() with a short micro-benchmark on random data
+(see recon::warmup), and the choices are persisted to
+`configDir()/fir_dispatch.json` so it only happens once per machine. select()
+never benchmarks or writes: until a shape is calibrated it falls back to a
+heuristic.
+*/
+class Dispatcher {
+public:
+  struct Key {
+    int n;
+    int taps;
+    int elemSize; // sizeof(T)
+    int batch;
+    auto operator<=>(const Key &) const = default;
+  };
+
+  struct Entry {
+    Method method;
+    float direct_ms;
+    float fft_ms;
+  };
+
+  static Dispatcher &get();
+
+  // Force a method for all calls (Method::Auto restores calibrated dispatch)
+  void setOverride(Method method);
+  [[nodiscard]] Method getOverride() const;
+
+  // Calibrated method for a shape, or the heuristic if it isn't calibrated
+  template <Floating T> Method select(int n, int taps, int batch) const {
+    std::lock_guard lock(m_mtx);
+    if (m_override != Method::Auto) {
+      return m_override;
+    }
+
+    const Key key{n, taps, static_cast<int>(sizeof(T)), batch};
+    if (const auto it = m_table.find(key); it != m_table.end()) {
+      return it->second.method;
+    }
+    return heuristic(n, taps);
+  }
+
+  /**
+  @brief Calibrate a shape if it isn't in the table yet and persist the table.
+  The benchmark runs without holding the lock, so other threads keep
+  dispatching meanwhile. A shape being calibrated by another thread isn't
+  calibrated again.
+  */
+  template <Floating T> Method tune(int n, int taps, int batch) {
+    const Key key{n, taps, static_cast<int>(sizeof(T)), batch};
+    {
+      std::lock_guard lock(m_mtx);
+      if (const auto it = m_table.find(key); it != m_table.end()) {
+        return it->second.method;
+      }
+      if (!m_calibrating.insert(key).second) {
+        return heuristic(n, taps);
+      }
+    }
+
+    const auto entry = calibrate<T>(n, taps, batch);
+
+    {
+      std::lock_guard lock(m_mtx);
+      m_calibrating.erase(key);
+      m_table[key] = entry;
+    }
+
+    // One writer at a time, each with the latest table
+    std::lock_guard saveLock(m_saveMtx);
+    std::map<Key, Entry> table;
+    {
+      std::lock_guard lock(m_mtx);
+      table = m_table;
+    }
+    save(table);
+    return entry.method;
+  }
+
+  // Guess for shapes not calibrated: overlap-add pays off once the kernel is
+  // long enough to amortize the FFTs
+  [[nodiscard]] static Method heuristic(int /*n*/, int taps) {
+    constexpr int minFFTTaps = 64;
+    return taps < minFFTTaps ? Method::Direct : Method::FFT;
+  }
+
+  // Benchmark both methods for a shape. Doesn't touch the table.
+  template <Floating T> static Entry calibrate(int n, int taps, int batch) {
+    // Per column cost doesn't depend much on the batch beyond a few columns
+    constexpr int maxCols = 16;
+    const int cols = std::clamp(batch, 1, maxCols);
+
+    const arma::Mat<T> x(n, cols, arma::fill::randn);
+    const arma::Col<T> kernel(taps, arma::fill::randn);
+    arma::Mat<T> y(n, cols);
+
+    const auto time_ms = [&](const auto &func) {
+      func(); // warm up (FFTW plans, caches)
+      constexpr int runs = 3;
+      float best = std::numeric_limits<float>::max();
+      for (int i = 0; i < runs; ++i) {
+        const TimeIt timeit;
+        func();
+        best = std::min(best, timeit.get_ms());
+      }
+      return best;
+    };
+
+    Entry entry{};
+    entry.direct_ms = time_ms([&] { convolveDirect<T>(x, kernel, y); });
+    entry.fft_ms = time_ms([&] { convolveFFT<T>(x, kernel, y); });
+    entry.method =
+        entry.direct_ms < entry.fft_ms ? Method::Direct : Method::FFT;
+    return entry;
+  }
+
+  [[nodiscard]] static fs::path cacheFile();
+
+private:
+  Dispatcher();
+  void load();
+  static void save(const std::map<Key, Entry> &table);
+
+  mutable std::mutex m_mtx;
+  std::mutex m_saveMtx;
+  std::map<Key, Entry> m_table;
+  std::set<Key> m_calibrating;
+  Method m_override{Method::Auto};
+};
+
+/**
+@brief "same" convolution of every column of `x` with `kernel` using the
+faster engine for this shape (or `method` if not Auto). `y` must not alias `x`.
+*/
+template <Floating T>
+void convolve(const arma::Mat<T> &x, const std::span<const T> kernel,
+              arma::Mat<T> &y, Method method = Method::Auto) {
+  if (method == Method::Auto) {
+    method = Dispatcher::get().select<T>(static_cast<int>(x.n_rows),
+                                         static_cast<int>(kernel.size()),
+                                         static_cast<int>(x.n_cols));
+  }
+
+  if (method == Method::Direct) {
+    convolveDirect<T>(x, kernel, y);
+  } else {
+    convolveFFT<T>(x, kernel, y);
+  }
+}
+
+} // namespace uspam::fir
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace uspam::metrics {
+namespace fs = std::filesystem;
+
+/**
+@brief Per A-line values of every frame of a sequence (frames x A-lines x
+fields), e.g. the FWHM or the en-face projections. Frames not set yet are
+NaN. Derived tables name the fields and convert their per A-line results.
+*/
+class FrameTable {
+public:
+  struct FieldInfo {
+    const char *name; // CSV column
+    bool hasUnit;     // The CSV column name is suffixed with the unit
+  };
+
+  FrameTable() = default;
+  explicit FrameTable(std::vector<FieldInfo> fields)
+      : m_fields(std::move(fields)) {}
+
+  // Clears all values
+  void resize(int numFrames, int numAlines);
+
+  // Make room for frame `frameIdx` of `numAlines` A-lines, with at least
+  // `numFrames` frames. Clears all values if the table has to change.
+  void fit(int numFrames, int numAlines, int frameIdx);
+
+  [[nodiscard]] int numFrames() const { return m_numFrames; }
+  [[nodiscard]] int numAlines() const { return m_numAlines; }
+  [[nodiscard]] int numFields() const {
+    return static_cast<int>(m_fields.size());
+  }
+  // A frame is set if the first field of its first A-line is
+  [[nodiscard]] bool hasFrame(int frameIdx) const;
+
+  [[nodiscard]] float get(int frameIdx, int aline, int field) const {
+    return m_data[index(frameIdx, aline) + field];
+  }
+
+  // Largest value of a field over all frames, NaN if none is set
+  [[nodiscard]] float max(int field) const;
+
+  // Unit of the fields that have one (e.g. "mm")
+  [[nodiscard]] const std::string &unit() const { return m_unit; }
+
+  // CSV with one row per (frame, A-line). Frames not set are skipped.
+  [[nodiscard]] bool saveCSV(const fs::path &filename) const;
+
+  // float32 array of shape (frames, A-lines, fields)
+  [[nodiscard]] bool saveNpy(const fs::path &filename) const;
+
+protected:
+  // Fields of one A-line (numFields() values)
+  [[nodiscard]] float *row(int frameIdx, int aline) {
+    return &m_data[index(frameIdx, aline)];
+  }
+  [[nodiscard]] bool validFrame(int frameIdx) const {
+    return frameIdx >= 0 && frameIdx < m_numFrames;
+  }
+  void setUnit(std::string unit) { m_unit = std::move(unit); }
+
+private:
+  [[nodiscard]] size_t index(int frameIdx, int aline) const {
+    return (static_cast<size_t>(frameIdx) * m_numAlines + aline) *
+           m_fields.size();
+  }
+
+  std::vector<FieldInfo> m_fields;
+  std::string m_unit;
+  int m_numFrames{};
+  int m_numAlines{};
+  std::vector<float> m_data;
+};
+
+} // namespace uspam::metrics
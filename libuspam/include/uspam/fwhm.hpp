@@ -0,0 +1,131 @@
+#pragma once
+
+#include "uspam/fft.hpp"
+#include "uspam/frameTable.hpp"
+#include <algorithm>
+#include <armadillo>
+#include <cmath>
+#include <limits>
+#include <opencv2/opencv.hpp>
+#include <span>
+#include <vector>
+
+namespace uspam::metrics {
+
+/**
+@brief Axial full width at half maximum of one A-line envelope. Positions are
+in (fractional) samples.
+*/
+struct AlineFWHM {
+  float peakPos{}; // Peak position refined with a parabola through 3 samples
+  float peak{};    // Envelope value at the peak sample
+  float lower{};   // Half max crossing before the peak
+  float upper{};   // Half max crossing after the peak
+  bool bounded{};  // Both crossings were found inside the A-line
+
+  [[nodiscard]] float width() const { return upper - lower; }
+};
+
+/**
+@brief FWHM of the highest peak of `y` at or after `startRow`.
+Half max crossings are linearly interpolated between the two samples around
+them.
+*/
+template <Floating T>
+AlineFWHM fwhm(const std::span<const T> y, const int startRow = 0) {
+  const auto n = static_cast<int>(y.size());
+  if (n == 0) {
+    return {};
+  }
+  const int start = std::clamp(startRow, 0, n - 1);
+
+  int peakIdx = start;
+  T peak = y[start];
+  for (int i = start + 1; i < n; ++i) {
+    if (y[i] > peak) {
+      peak = y[i];
+      peakIdx = i;
+    }
+  }
+
+  AlineFWHM res{};
+  res.peak = static_cast<float>(peak);
+  res.peakPos = static_cast<float>(peakIdx);
+  if (peakIdx > 0 && peakIdx < n - 1) {
+    const T ym = y[peakIdx - 1];
+    const T yp = y[peakIdx + 1];
+    const T denom = ym - 2 * peak + yp;
+    if (denom < 0) {
+      res.peakPos += static_cast<float>(0.5 * (ym - yp) / denom);
+    }
+  }
+
+  const T halfMax = peak / 2;
+  bool bounded = true;
+
+  int lo = peakIdx;
+  while (lo > 0 && y[lo - 1] > halfMax) {
+    --lo;
+  }
+  if (lo > 0) {
+    // y[lo - 1] <= halfMax < y[lo]
+    const T t = (halfMax - y[lo - 1]) / (y[lo] - y[lo - 1]);
+    res.lower = static_cast<float>(lo - 1 + t);
+  } else {
+    res.lower = 0;
+    bounded = false;
+  }
+
+  int hi = peakIdx;
+  while (hi < n - 1 && y[hi + 1] > halfMax) {
+    ++hi;
+  }
+  if (hi < n - 1) {
+    // y[hi] > halfMax >= y[hi + 1]
+    const T t = (y[hi] - halfMax) / (y[hi] - y[hi + 1]);
+    res.upper = static_cast<float>(hi + t);
+  } else {
+    res.upper = static_cast<float>(n - 1);
+    bounded = false;
+  }
+
+  res.bounded = bounded && peak > 0;
+  return res;
+}
+
+/**
+@brief FWHM of every A-line (column) of `env`, in parallel.
+*/
+template <Floating T>
+void fwhm(const arma::Mat<T> &env, std::vector<AlineFWHM> &out,
+          const int startRow = 0) {
+  out.resize(env.n_cols);
+  cv::parallel_for_(cv::Range(0, env.n_cols), [&](const cv::Range &range) {
+    for (int j = range.start; j < range.end; ++j) {
+      out[j] = fwhm<T>(std::span<const T>{env.colptr(j), env.n_rows},
+                       startRow);
+    }
+  });
+}
+
+/**
+@brief FWHM of every A-line of every frame of a sequence (frames x A-lines).
+Frames not set yet are NaN.
+*/
+class FWHMTable : public FrameTable {
+public:
+  // Fields stored per A-line (last dimension of the .npy file)
+  enum Field { PeakPos = 0, Peak, Lower, Upper, Width, NumFields };
+
+  FWHMTable();
+  FWHMTable(int numFrames, int numAlines) : FWHMTable() {
+    resize(numFrames, numAlines);
+  }
+
+  // `mmPerSample` converts the positions and width to mm (0 to keep samples).
+  // A-lines beyond numAlines() are ignored.
+  void setFrame(int frameIdx, std::span<const AlineFWHM> alines,
+                float mmPerSample = 0);
+};
+
+} // namespace uspam::metrics
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <armadillo>
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <opencv2/opencv.hpp>
+#include <utility>
+#include <vector>
 
 namespace uspam::imutil {
 
@@ -23,24 +29,124 @@ auto makeRectangular(const arma::Mat<T> &mat, int width = 640,
 }
 // NOLINTEND(*-magic-numbers)
 
+/**
+@brief Display order of the A-lines of a B-scan: column j of the image is
+A-line src(j) of the acquired data. Same as arma::fliplr (if flip) followed by
+arma::shift(x, rotate, 1), without moving the data.
+*/
+struct ColumnPermutation {
+  bool flip{};
+  int rotate{};
+
+  [[nodiscard]] bool identity() const { return !flip && rotate == 0; }
+
+  [[nodiscard]] int src(int j, int n) const {
+    int i = (j - rotate) % n;
+    if (i < 0) {
+      i += n;
+    }
+    return flip ? n - 1 - i : i;
+  }
+
+  // Inverse of src
+  [[nodiscard]] int dst(int i, int n) const {
+    if (flip) {
+      i = n - 1 - i;
+    }
+    int j = (i + rotate) % n;
+    if (j < 0) {
+      j += n;
+    }
+    return j;
+  }
+
+  // Reorder per A-line values from acquisition to display order
+  template <typename T> void apply(std::vector<T> &v) const {
+    if (identity() || v.empty()) {
+      return;
+    }
+    const auto n = static_cast<int>(v.size());
+    std::vector<T> out(v.size());
+    for (int j = 0; j < n; ++j) {
+      out[j] = v[src(j, n)];
+    }
+    v = std::move(out);
+  }
+};
+
+/**
+@brief Scan conversion table from a B-scan of `nAlines` x `nSamples` (samples
+along the radius, A-lines around the circle) to a `size` x `size` radial
+image.
+
+Every pixel keeps its bilinear taps in (displayed A-line, sample) space, so
+the A-line order (ColumnPermutation) is resolved once per frame through a
+table of column pointers instead of reordering the data.
+*/
+struct RadialLUT {
+  struct Pixel {
+    int32_t sample; // First sample tap, -1 outside the image circle
+    int16_t a0;     // A-line taps (display order)
+    int16_t a1;
+    float ws; // Weight of sample + 1
+    float wa; // Weight of a1
+  };
+
+  int nAlines{};
+  int nSamples{};
+  int size{};
+  std::vector<Pixel> pixels; // Row major
+
+  RadialLUT(int nAlines, int nSamples, int size);
+
+  // Shared table for this geometry, built on first use. Only the last few
+  // geometries used are cached; the returned table outlives its eviction.
+  static std::shared_ptr<const RadialLUT> get(int nAlines, int nSamples,
+                                              int size);
+};
+
+/**
+@brief Radial (polar to cartesian) image of `mat` (A-lines in columns). The
+image is `final_size` pixels wide, or min(A-lines, samples) if 0. `perm` gives
+the order of the A-lines around the circle.
+*/
 template <typename T>
-auto makeRadial(const arma::Mat<T> &mat, int final_size = 0) {
-  // NOLINTNEXTLINE(*-casting)
-  cv::Mat cv_mat(mat.n_cols, mat.n_rows, getCvType<T>(), (void *)mat.memptr());
+auto makeRadial(const arma::Mat<T> &mat, int final_size = 0,
+                const ColumnPermutation &perm = {}) {
+  const auto nAlines = static_cast<int>(mat.n_cols);
+  const auto nSamples = static_cast<int>(mat.n_rows);
+  final_size = final_size == 0 ? std::min(nAlines, nSamples) : final_size;
 
-  const int r = std::min(cv_mat.rows, cv_mat.cols);
-  const cv::Size dsize{r * 2, r * 2};
-  const cv::Point2f center{static_cast<float>(r), static_cast<float>(r)};
-  const auto maxRadius{static_cast<double>(r)};
+  const auto lut = RadialLUT::get(nAlines, nSamples, final_size);
 
-  cv::resize(cv_mat, cv_mat, dsize);
-  cv::warpPolar(cv_mat, cv_mat, dsize, center, maxRadius,
-                cv::WARP_INVERSE_MAP | cv::WARP_FILL_OUTLIERS);
-  cv::rotate(cv_mat, cv_mat, cv::ROTATE_90_COUNTERCLOCKWISE);
+  std::vector<const T *> cols(nAlines);
+  for (int j = 0; j < nAlines; ++j) {
+    cols[j] = mat.colptr(perm.src(j, nAlines));
+  }
 
-  final_size = final_size == 0 ? r : final_size;
-  cv::resize(cv_mat, cv_mat, {final_size, final_size});
-  return cv_mat;
+  cv::Mat out(final_size, final_size, getCvType<T>());
+  cv::parallel_for_(cv::Range(0, final_size), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; ++i) {
+      T *dst = out.ptr<T>(i);
+      const auto *px = &lut->pixels[static_cast<size_t>(i) * final_size];
+      for (int j = 0; j < final_size; ++j) {
+        const auto &p = px[j];
+        if (p.sample < 0) {
+          dst[j] = T{};
+          continue;
+        }
+        // NOLINTBEGIN(*-pointer-arithmetic)
+        const T *c0 = cols[p.a0] + p.sample;
+        const T *c1 = cols[p.a1] + p.sample;
+        const float v0 = c0[0] + p.ws * (static_cast<float>(c0[1]) - c0[0]);
+        const float v1 = c1[0] + p.ws * (static_cast<float>(c1[1]) - c1[0]);
+        // NOLINTEND(*-pointer-arithmetic)
+        dst[j] = cv::saturate_cast<T>(v0 + p.wa * (v1 - v0));
+      }
+    }
+  });
+
+  return out;
 }
 
 // equivalent to arma::fliplr but inplace
@@ -51,6 +157,40 @@ template <typename T> void fliplr_inplace(arma::Mat<T> &mat) {
   }
 }
 
+/**
+@brief PA on US overlay in one pass over the pixels.
+
+The colormap and the PA opacity of every PA level are precomputed in a 256
+entry table, so each output pixel is one table lookup and an integer blend
+with the US. The output is written directly as BGR.
+*/
+class OverlayCompositor {
+public:
+  /**
+  @param threshold PA levels above this are drawn over the US.
+  @param ramp If > 0, the PA opacity goes from 0 to 1 over `ramp` levels above
+  the threshold (alpha blending) instead of a hard mask.
+  @param colormap OpenCV colormap of the PA.
+  */
+  explicit OverlayCompositor(uint8_t threshold = 10, int ramp = 0,
+                             int colormap = cv::COLORMAP_HOT);
+
+  // US and PA are CV_8UC1 of the same size, PAUS will be CV_8UC3 (BGR)
+  void compose(const cv::Mat &US, const cv::Mat &PA, cv::Mat &PAUS) const;
+
+  [[nodiscard]] uint8_t threshold() const { return m_threshold; }
+  [[nodiscard]] int ramp() const { return m_ramp; }
+
+private:
+  uint8_t m_threshold;
+  int m_ramp;
+
+  // out = (US * m_usWeight[pa] + m_paBGR[pa]) >> 8, with the PA color
+  // premultiplied by its opacity (0 - 256)
+  std::array<uint16_t, 256> m_usWeight{};
+  std::array<std::array<uint16_t, 3>, 256> m_paBGR{};
+};
+
 // Make PAUS overlay image.
 // US and PA are CV_8UC1, PAUS will be CV_8UC3
 void makeOverlay(const cv::Mat &US, const cv::Mat &PA, cv::Mat &PAUS,
@@ -1,13 +1,21 @@
 #pragma once
 
 #include "uspam/ioParams.hpp"
+#include "uspam/mappedFile.hpp"
 #include <algorithm>
+#include <array>
 #include <armadillo>
 #include <bit>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
 #include <mutex>
+#include <numeric>
 #include <opencv2/opencv.hpp>
 #include <rapidjson/document.h>
 #include <span>
@@ -22,6 +30,132 @@ template <typename T> void swap_endian_inplace(T *val) {
   std::reverse(ptr, ptr + sizeof(T));        // NOLINT
 }
 
+/**
+@brief Swap the endianness of `n` contiguous elements of `elemSize` bytes
+(1, 2, 4 or 8) inplace.
+
+Uses SIMD byte shuffles (AVX2 when compiled with it, otherwise SSE2 on x86-64 or
+NEON on ARM) with a scalar tail.
+*/
+void byteswap_inplace(std::byte *data, size_t elemSize, size_t n);
+
+// Element type of a binary file
+enum class DType {
+  UInt8,
+  Int8,
+  UInt16,
+  Int16,
+  UInt32,
+  Int32,
+  Float32,
+  Float64,
+};
+
+constexpr size_t dtype_size(DType dtype) {
+  switch (dtype) {
+  case DType::UInt8:
+  case DType::Int8:
+    return 1;
+  case DType::UInt16:
+  case DType::Int16:
+    return 2;
+  case DType::UInt32:
+  case DType::Int32:
+  case DType::Float32:
+    return 4;
+  case DType::Float64:
+  default:
+    return 8;
+  }
+}
+
+template <typename T> constexpr DType dtype_of() {
+  if constexpr (std::is_same_v<T, uint8_t>) {
+    return DType::UInt8;
+  } else if constexpr (std::is_same_v<T, int8_t>) {
+    return DType::Int8;
+  } else if constexpr (std::is_same_v<T, uint16_t>) {
+    return DType::UInt16;
+  } else if constexpr (std::is_same_v<T, int16_t>) {
+    return DType::Int16;
+  } else if constexpr (std::is_same_v<T, uint32_t>) {
+    return DType::UInt32;
+  } else if constexpr (std::is_same_v<T, int32_t>) {
+    return DType::Int32;
+  } else if constexpr (std::is_same_v<T, float>) {
+    return DType::Float32;
+  } else {
+    static_assert(std::is_same_v<T, double>, "Unsupported dtype");
+    return DType::Float64;
+  }
+}
+
+namespace details {
+
+// Convert `n` elements of Tin (stored with endianness `endian`) to Tout.
+// Works through a small block buffer so the byte swap and the conversion
+// happen in one pass over L1-resident data.
+template <typename Tin, typename Tout>
+void convert_block(const std::byte *src, size_t n, std::endian endian,
+                   Tout *dst) {
+  const bool swap = sizeof(Tin) > 1 && endian != std::endian::native;
+
+  if constexpr (std::is_same_v<Tin, Tout>) {
+    std::memcpy(dst, src, n * sizeof(Tin));
+    if (swap) {
+      // NOLINTNEXTLINE(*-reinterpret-cast)
+      byteswap_inplace(reinterpret_cast<std::byte *>(dst), sizeof(Tin), n);
+    }
+  } else {
+    constexpr size_t BlockSize = 2048;
+    alignas(64) std::array<Tin, BlockSize> buf; // NOLINT(*-member-init)
+    for (size_t i = 0; i < n; i += BlockSize) {
+      const size_t m = std::min(BlockSize, n - i);
+      // NOLINTNEXTLINE(*-pointer-arithmetic)
+      std::memcpy(buf.data(), src + i * sizeof(Tin), m * sizeof(Tin));
+      if (swap) {
+        // NOLINTNEXTLINE(*-reinterpret-cast)
+        byteswap_inplace(reinterpret_cast<std::byte *>(buf.data()),
+                         sizeof(Tin), m);
+      }
+      for (size_t j = 0; j < m; ++j) {
+        dst[i + j] = static_cast<Tout>(buf[j]); // NOLINT
+      }
+    }
+  }
+}
+
+} // namespace details
+
+/**
+@brief Convert `dst.size()` elements of `dtype` with endianness `endian` from
+`src` to Tout, byte swapping as needed in the same pass.
+*/
+template <typename Tout>
+void convert_bytes(const std::byte *src, DType dtype, std::endian endian,
+                   std::span<Tout> dst) {
+  const auto n = dst.size();
+  auto *out = dst.data();
+  switch (dtype) {
+  case DType::UInt8:
+    return details::convert_block<uint8_t>(src, n, endian, out);
+  case DType::Int8:
+    return details::convert_block<int8_t>(src, n, endian, out);
+  case DType::UInt16:
+    return details::convert_block<uint16_t>(src, n, endian, out);
+  case DType::Int16:
+    return details::convert_block<int16_t>(src, n, endian, out);
+  case DType::UInt32:
+    return details::convert_block<uint32_t>(src, n, endian, out);
+  case DType::Int32:
+    return details::convert_block<int32_t>(src, n, endian, out);
+  case DType::Float32:
+    return details::convert_block<float>(src, n, endian, out);
+  case DType::Float64:
+    return details::convert_block<double>(src, n, endian, out);
+  }
+}
+
 // Function to convert matrix using OpenCV's cv::parallel_for_
 template <typename Tin, typename Tout>
 void parallel_convert(const arma::Mat<Tin> &input, arma::Mat<Tout> &output) {
@@ -56,6 +190,15 @@ void parallel_convert_(const arma::Mat<Tin> &input, arma::Mat<Tout> &output,
   });
 }
 
+// Convert raw ADC samples to voltage [-1, 1] (scale from uint16_t space)
+template <typename TypeInBin, typename T>
+void adc_to_voltage(const arma::Mat<TypeInBin> &raw, arma::Mat<T> &rf) {
+  constexpr T alpha =
+      static_cast<T>(1) / static_cast<T>(1 << 15); // 1 / (2**15)
+  constexpr T beta = -1;
+  parallel_convert_<TypeInBin, T>(raw, rf, alpha, beta);
+}
+
 template <typename TypeInBin> class BinfileLoader {
 private:
   std::ifstream file;
@@ -144,7 +287,8 @@ public:
     if constexpr (std::is_same_v<T, TypeInBin>) {
       // type stored in bin is the same type as the buffer give. Use directly
       // NOLINTNEXTLINE(*-reinterpret-cast)
-      return !file.read(reinterpret_cast<char *>(rf.memptr()), sizeBytes);
+      return static_cast<bool>(
+          file.read(reinterpret_cast<char *>(rf.memptr()), sizeBytes));
 
     } else {
       // Type stored in bin different from the given buffer.
@@ -160,10 +304,7 @@ public:
 
         // Convert from uint16_t to FloatType, also scale from uint16_t space to
         // voltage [-1, 1]
-        constexpr T alpha =
-            static_cast<T>(1) / static_cast<T>(1 << 15); // 1 / (2**15)
-        constexpr T beta = -1;
-        parallel_convert_<TypeInBin, T>(readBuffer, rf, alpha, beta);
+        adc_to_voltage(readBuffer, rf);
 
         return true;
       }
@@ -201,48 +342,74 @@ public:
   auto getAlinesPerBscan() const { return alinesPerBscan; }
 };
 
-// T is the type of value stored in the binary file.
-template <typename T>
-auto load_bin(const fs::path &filename,
-              const std::endian endian = std::endian::little) -> arma::Mat<T> {
+/**
+@brief Load a `rows` x `cols` (column major) matrix from a binary file.
 
-  std::ifstream file(filename, std::ios::binary | std::ios::ate);
-  if (!file.is_open()) {
+The file is memory mapped and converted in parallel chunks straight from
+`dtype` with endianness `endian` into T, so big endian double files don't need
+a separate byte swap pass.
+
+@param byteOffset Bytes to skip at the beginning of the file.
+Returns an empty matrix on error.
+*/
+template <typename T>
+auto load_bin(const fs::path &filename, size_t rows, size_t cols, DType dtype,
+              const std::endian endian = std::endian::little,
+              size_t byteOffset = 0) -> arma::Mat<T> {
+  MappedFile file;
+  if (!file.open(filename)) {
     std::cerr << "Failed to open file\n";
     return {};
   }
-  const std::streamsize fsize = file.tellg();
-  file.seekg(0, std::ios::beg);
 
-  const auto n_values = fsize / sizeof(T);
-  const size_t cols = 1000;
-  const size_t rows = n_values / cols;
-
-  // Check if the file size matches our matrix size
-  if (rows * cols * sizeof(T) != fsize) {
+  const auto elemSize = dtype_size(dtype);
+  const size_t n = rows * cols;
+  if (byteOffset + n * elemSize > file.size()) {
     std::cerr << "File size does not match the expected matrix dimensions\n";
     return {};
   }
 
-  arma::Mat<T> matrix(rows, cols);
+  arma::Mat<T> matrix(rows, cols, arma::fill::none);
+
+  constexpr size_t ChunkSize = 1 << 16; // elements
+  const auto nChunks = static_cast<int>((n + ChunkSize - 1) / ChunkSize);
+  const auto *src = file.data() + byteOffset; // NOLINT(*-pointer-arithmetic)
+  auto *dst = matrix.memptr();
 
-  // Read file
-  if (!file.read(
-          reinterpret_cast<char *>(matrix.data()), // NOLINT(*-reinterpret-cast)
-          fsize)) {
-    std::cerr << "Failed to read data into matrix\n";
+  cv::parallel_for_(cv::Range(0, nChunks), [&](const cv::Range &range) {
+    for (int chunk = range.start; chunk < range.end; ++chunk) {
+      const size_t start = chunk * ChunkSize;
+      const size_t m = std::min(ChunkSize, n - start);
+      // NOLINTNEXTLINE(*-pointer-arithmetic)
+      convert_bytes<T>(src + start * elemSize, dtype, endian, {dst + start, m});
+    }
+  });
+
+  return matrix;
+}
+
+// T is the type of value stored in the binary file. The file is assumed to
+// hold NUM_ALINES_DETAULT columns.
+template <typename T>
+auto load_bin(const fs::path &filename,
+              const std::endian endian = std::endian::little) -> arma::Mat<T> {
+  std::error_code ec;
+  const auto fsize = fs::file_size(filename, ec);
+  if (ec) {
+    std::cerr << "Failed to open file\n";
     return {};
   }
 
-  // Convert endian if necessary
-  if (endian != std::endian::native) {
-    const auto ptr = matrix.data();
-    for (int i = 0; i < matrix.size(); i++) {
-      swap_endian_inplace<T>(ptr + i);
-    }
+  const size_t cols = NUM_ALINES_DETAULT;
+  const size_t rows = fsize / sizeof(T) / cols;
+
+  // Check if the file size matches our matrix size
+  if (rows * cols * sizeof(T) != fsize) {
+    std::cerr << "File size does not match the expected matrix dimensions\n";
+    return {};
   }
 
-  return matrix;
+  return load_bin<T>(filename, rows, cols, dtype_of<T>(), endian);
 }
 
 /**
@@ -266,4 +433,23 @@ void to_bin(const fs::path &filename, std::span<const T> data) {
       datasize_bytes);
 }
 
+/**
+@brief Write a C order (row major) array to a NumPy .npy file (format 1.0).
+Returns false on failure.
+
+@param shape Dimensions of the array. Their product must equal the number of
+elements in `data`.
+*/
+bool to_npy(const fs::path &filename, const std::byte *data, DType dtype,
+            std::span<const size_t> shape);
+
+template <typename T>
+bool to_npy(const fs::path &filename, std::span<const T> data,
+            std::initializer_list<size_t> shape) {
+  assert(std::accumulate(shape.begin(), shape.end(), size_t{1},
+                         std::multiplies<>()) == data.size());
+  return to_npy(filename, std::as_bytes(data).data(), dtype_of<T>(),
+                std::span<const size_t>(shape.begin(), shape.size()));
+}
+
 } // namespace uspam::io
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace uspam::io {
+namespace fs = std::filesystem;
+
+/**
+@brief Memory mapped file (mmap on POSIX, MapViewOfFile on Windows). Read-only
+with `open`, read-write with `openWritable`. The mapping is released when the
+object is destroyed.
+*/
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const fs::path &filename) { open(filename); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  ~MappedFile() { close(); }
+
+  bool open(const fs::path &filename);
+  // Create or open `filename` read-write and resize it to `size` bytes. The
+  // existing content is kept (up to `size`), new bytes are zero.
+  bool openWritable(const fs::path &filename, size_t size);
+  void close();
+
+  // Start writing the modified pages back to the file (asynchronous)
+  bool flush();
+
+  [[nodiscard]] bool isOpen() const { return m_data != nullptr; }
+  [[nodiscard]] bool isWritable() const { return m_writable; }
+  [[nodiscard]] auto size() const { return m_size; }
+  [[nodiscard]] auto data() const {
+    return static_cast<const std::byte *>(m_data);
+  }
+  [[nodiscard]] auto bytes() const {
+    return std::span<const std::byte>{data(), m_size};
+  }
+  // Only valid with openWritable
+  [[nodiscard]] auto mutableData() { return static_cast<std::byte *>(m_data); }
+
+private:
+  void swap(MappedFile &other) noexcept;
+
+  void *m_data{};
+  size_t m_size{};
+  bool m_writable{false};
+
+#if defined(_WIN32) || defined(_WIN64)
+  void *m_file{};
+  void *m_mapping{};
+#else
+  int m_fd{-1};
+#endif
+};
+
+} // namespace uspam::io
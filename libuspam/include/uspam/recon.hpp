@@ -1,40 +1,61 @@
 #pragma once
 
 #include "fftconv.hpp"
+#include "uspam/autoGain.hpp"
+#include "uspam/enface.hpp"
+#include "uspam/fir.hpp"
 #include "uspam/imutil.hpp"
 #include "uspam/ioParams.hpp"
 #include "uspam/reconParams.hpp"
 #include "uspam/signal.hpp"
+#include "uspam/speckle.hpp"
 #include <algorithm>
 #include <armadillo>
 #include <cassert>
 #include <cmath>
 #include <opencv2/opencv.hpp>
 #include <rapidjson/document.h>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace uspam::recon {
 
+// Number of taps of the bandpass FIR filter used by reconOneScan
+constexpr int FIR_NUMTAPS = 95;
+
+// FIR filter + envelope detection of every A-line (column) of rf.
+// The FIR engine (direct or FFT) is picked by fir::Dispatcher for this shape.
 template <Floating T>
 void recon(const arma::Mat<T> &rf, const arma::Col<T> &kernel,
            arma::Mat<T> &env) {
-  const cv::Range range(0, static_cast<int>(rf.n_cols));
-  // cv::parallel_for_(cv::Range(0, rf.n_cols), [&](const cv::Range &range) {
-  arma::Col<T> rf_filt(rf.n_rows);
-  for (int i = range.start; i < range.end; ++i) {
-    const auto src = rf.unsafe_col(i);
-    auto dst = env.unsafe_col(i);
-    fftconv::oaconvolve_fftw_same<T>(src, kernel, rf_filt);
-    signal::hilbert_abs_r2c<T>(rf_filt, dst);
+  fir::convolve<T>(rf, kernel, env);
+
+  // Envelope in place. hilbert_abs_r2c copies the input to the FFT buffer
+  // first and reads x[i] right before writing env[i], so aliasing is safe.
+  for (int i = 0; i < static_cast<int>(env.n_cols); ++i) {
+    auto col = env.unsafe_col(i);
+    signal::hilbert_abs_r2c<T>(col, col);
   }
-  // });
 }
 
 template <typename T>
 concept Arithmetic = std::is_arithmetic_v<T>;
 
+// Log compress with a gain (dB) added before clipping (time-gain
+// compensation)
+template <Arithmetic T>
+auto logCompress(T val, T noiseFloor, T desiredDynamicRangeDB, T gainDB) {
+  // NOLINTNEXTLINE(*-magic-numbers)
+  T compressedVal = 20.0 * std::log10(val / noiseFloor) + gainDB;
+  compressedVal = std::max(compressedVal, T(0));
+  compressedVal = std::min(compressedVal, desiredDynamicRangeDB);
+  return compressedVal / desiredDynamicRangeDB;
+}
+
 template <Arithmetic T>
 auto logCompress(T val, T noiseFloor, T desiredDynamicRangeDB) {
   // NOLINTNEXTLINE(*-magic-numbers)
@@ -60,24 +81,57 @@ template <> inline consteval float logCompressFct<float, uint8_t>() {
 }
 // NOLINTEND(*-magic-numbers)
 
+// Reduce column j of xLog into `projection` if enabled. Called right after
+// the column is written, while it is still in cache.
+template <typename Tout>
+void projectColumn(const arma::Mat<Tout> &xLog, const int j,
+                   const metrics::ProjectionTarget &projection) {
+  if constexpr (std::is_same_v<Tout, uint8_t>) {
+    if (projection.enabled()) {
+      projection.alines[j] = metrics::project(
+          std::span<const uint8_t>{xLog.colptr(j), xLog.n_rows},
+          projection.rowBegin, projection.rowEnd);
+    }
+  }
+}
+
 // Log compress to range of 0 - 1
+// If given, gainDB (one value per row) is added in dB before clipping.
+// If `projection` is enabled (uint8_t output only), every column is also
+// reduced for the en-face maps in the same pass.
 template <Floating T, typename Tout>
 void logCompress(const arma::Mat<T> &x, arma::Mat<Tout> &xLog,
-                 const T noiseFloor, const T desiredDynamicRangeDB = 45.0) {
+                 const T noiseFloor, const T desiredDynamicRangeDB = 45.0,
+                 const std::span<const T> gainDB = {},
+                 const metrics::ProjectionTarget &projection = {}) {
   assert(!x.empty());
   assert(x.size() == xLog.size());
+  assert(gainDB.empty() || gainDB.size() == x.n_rows);
+  assert(!projection.enabled() || projection.alines.size() == x.n_cols);
 
   // Apply log compression with clipping in a single pass
   cv::parallel_for_(cv::Range(0, x.n_cols), [&](const cv::Range &range) {
     for (int j = range.start; j < range.end; ++j) {
-      for (int i = 0; i < x.n_rows; ++i) {
-        const auto val = x(i, j);
-        const auto compressedVal =
-            logCompress(val, noiseFloor, desiredDynamicRangeDB) *
-            logCompressFct<T, Tout>();
+      if (gainDB.empty()) {
+        for (int i = 0; i < x.n_rows; ++i) {
+          const auto val = x(i, j);
+          const auto compressedVal =
+              logCompress(val, noiseFloor, desiredDynamicRangeDB) *
+              logCompressFct<T, Tout>();
 
-        xLog(i, j) = static_cast<Tout>(compressedVal);
+          xLog(i, j) = static_cast<Tout>(compressedVal);
+        }
+      } else {
+        for (int i = 0; i < x.n_rows; ++i) {
+          const auto val = x(i, j);
+          const auto compressedVal =
+              logCompress(val, noiseFloor, desiredDynamicRangeDB, gainDB[i]) *
+              logCompressFct<T, Tout>();
+
+          xLog(i, j) = static_cast<Tout>(compressedVal);
+        }
       }
+      projectColumn(xLog, j, projection);
     }
     //}(cv::Range(0, x.n_cols));
   });
@@ -104,78 +158,283 @@ auto calcDynamicRange(const std::span<const T> x, const T noiseFloor) {
   return dynamicRangeDB;
 }
 
-// FIR filter + Envelope detection + log compression for PA/US pair
-// rf contains the RF signal, and results are saved to rfLog
+// Decimation factor that brings `numSamples` per A-line down to about the
+// radius of the radial image. makeRadial uses r = min(numAlines, numSamples),
+// so keeping at least `numAlines` samples doesn't change the image size.
+inline int displayDecimationFactor(int numSamples, int numAlines) {
+  return std::max(1, numSamples / std::max(1, numAlines));
+}
+
+// Anti-aliased decimation (along each column) + log compression in one pass.
+// xLog is resized to (ceil(x.n_rows / factor), x.n_cols).
+// If given, gainDB has one value (dB) per output row. `projection` as in
+// logCompress (rows of xLog).
+template <Floating T, typename Tout>
+void decimateLogCompress(const arma::Mat<T> &x, arma::Mat<Tout> &xLog,
+                         const int factor, const T noiseFloor,
+                         const T desiredDynamicRangeDB = 45.0,
+                         const std::span<const T> gainDB = {},
+                         const metrics::ProjectionTarget &projection = {}) {
+  assert(!x.empty());
+  assert(factor >= 1);
+  assert(gainDB.empty() ||
+         gainDB.size() == (x.n_rows + factor - 1) / factor);
+  assert(!projection.enabled() || projection.alines.size() == x.n_cols);
+
+  const arma::Col<T> kernel = [&] {
+    if (factor == 1) {
+      return arma::Col<T>{T(1)};
+    }
+    return arma::conv_to<arma::Col<T>>::from(
+        signal::decimation_kernel(factor));
+  }();
+
+  const auto nOut = (x.n_rows + factor - 1) / factor;
+  xLog.set_size(nOut, x.n_cols);
+
+  cv::parallel_for_(cv::Range(0, x.n_cols), [&](const cv::Range &range) {
+    arma::Col<T> buf(nOut);
+    for (int j = range.start; j < range.end; ++j) {
+      const auto src = x.unsafe_col(j);
+      signal::decimate<T>(src, kernel, factor, buf);
+
+      for (int i = 0; i < nOut; ++i) {
+        // The low-pass can ring slightly below 0 next to sharp edges
+        const auto val = std::max(buf(i), T(0));
+        const T gain = gainDB.empty() ? T(0) : gainDB[i];
+        const auto compressedVal =
+            logCompress(val, noiseFloor, desiredDynamicRangeDB, gain) *
+            logCompressFct<T, Tout>();
+        xLog(i, j) = static_cast<Tout>(compressedVal);
+      }
+      projectColumn(xLog, j, projection);
+    }
+  });
+}
+
+// Log compress the envelope into rfLog, decimated to the display resolution if
+// `params.decimateEnvelope` is set. `rfRows` is the number of samples per
+// A-line before envelope detection, used to find the depth of each rfEnv row
+// for time-gain compensation.
+// If `params.autoGain` is set and `autoGain` is given, the noise floor and
+// dynamic range come from the histogram of rfEnv (one extra read of rfEnv).
+// If `projection` is given, every A-line of rfLog is reduced over the
+// en-face depth window of `params` in the same pass.
 template <Floating T>
-void reconOneScan(const ReconParams2 &params, io::PAUSpair<T> &rf,
-                  io::PAUSpair<T> &rfBeamformed, io::PAUSpair<uint8_t> &rfLog,
-                  bool flip) {
-  reconOneScan<T>(params.PA, rf.PA, rfBeamformed.PA, rfLog.PA, flip);
-  reconOneScan<T>(params.US, rf.US, rfBeamformed.US, rfLog.US, flip);
+void logCompressForDisplay(const ReconParams &params, const arma::Mat<T> &rfEnv,
+                           arma::Mat<uint8_t> &rfLog, const int rfRows,
+                           AutoGain *autoGain = nullptr,
+                           metrics::FrameProjection *projection = nullptr) {
+  float noiseFloor_mV = params.noiseFloor_mV;
+  float dynamicRange = params.desiredDynamicRange;
+  if (params.autoGain && autoGain != nullptr) {
+    autoGain->setSmoothing(params.autoGainSmoothing);
+    const auto hist = EnvelopeHistogram::compute<T>(rfEnv);
+    const auto gain = autoGain->update(hist, params.autoGainNoisePercentile,
+                                       params.autoGainPeakPercentile);
+    if (autoGain->initialized()) {
+      noiseFloor_mV = gain.noiseFloor_mV;
+      dynamicRange = gain.dynamicRange_dB;
+    }
+  }
+
+  constexpr float fct_mV2V = 1.0F / 1000;
+  const T noiseFloor = noiseFloor_mV * fct_mV2V;
+
+  const int factor =
+      params.decimateEnvelope
+          ? displayDecimationFactor(static_cast<int>(rfEnv.n_rows),
+                                    static_cast<int>(rfEnv.n_cols))
+          : 1;
+  const auto nOut = static_cast<int>((rfEnv.n_rows + factor - 1) / factor);
+
+  // Depth [mm] of one output row
+  const double mmPerRow = static_cast<double>(params.mmPerSample) * rfRows /
+                          static_cast<double>(rfEnv.n_rows) * factor;
+
+  // Gain per output row, computed once per frame
+  std::vector<T> gainDB;
+  if (params.hasTGC()) {
+    const auto table = params.tgcTable(nOut, mmPerRow);
+    gainDB.assign(table.begin(), table.end());
+  }
+
+  metrics::ProjectionTarget target;
+  if (projection != nullptr) {
+    projection->alines.resize(rfEnv.n_cols);
+    projection->mmPerRow = static_cast<float>(mmPerRow);
+    target.alines = projection->alines;
+    std::tie(target.rowBegin, target.rowEnd) = params.enfaceRows(mmPerRow);
+  }
+
+  if (factor > 1) {
+    decimateLogCompress<T>(rfEnv, rfLog, factor, noiseFloor,
+                           static_cast<T>(dynamicRange), gainDB, target);
+  } else {
+    rfLog.set_size(rfEnv.n_rows, rfEnv.n_cols);
+    logCompress<T>(rfEnv, rfLog, noiseFloor, static_cast<T>(dynamicRange),
+                   gainDB, target);
+  }
 }
 
-// Beamform + FIR filter + Envelope detection + log compression for one
+/**
+@brief Low resolution image for previews (e.g. while scrubbing). No
+beamforming or filtering: every `alineStep`-th A-line of `rf` is kept and the
+envelope is approximated by the peak |rf| in each block of `sampleStep`
+samples. The result is log compressed like logCompressForDisplay, with the
+gain of `autoGain` if given and initialized (it isn't updated).
+*/
 template <Floating T>
-void reconOneScan(const ReconParams &params, arma::Mat<T> &rf,
-                  arma::Mat<T> &rfBeamformed, arma::Mat<T> &rfEnv,
-                  arma::Mat<uint8_t> &rfLog, bool flip) {
-  if (flip) {
-    // Do flip
-    imutil::fliplr_inplace(rf);
+void reconPreview(const ReconParams &params, const arma::Mat<T> &rf,
+                  arma::Mat<uint8_t> &rfLog, const int alineStep,
+                  const int sampleStep, const AutoGain *autoGain = nullptr) {
+  assert(alineStep > 0 && sampleStep > 0);
+  const auto nAlines =
+      static_cast<int>((rf.n_cols + alineStep - 1) / alineStep);
+  const auto nOut = static_cast<int>(rf.n_rows) / sampleStep;
 
-    // Do rotate
-    rf = arma::shift(rf, params.rotateOffset, 1);
+  float noiseFloor_mV = params.noiseFloor_mV;
+  float dynamicRange = params.desiredDynamicRange;
+  if (params.autoGain && autoGain != nullptr && autoGain->initialized()) {
+    const auto gain = autoGain->result();
+    noiseFloor_mV = gain.noiseFloor_mV;
+    dynamicRange = gain.dynamicRange_dB;
   }
+  constexpr float fct_mV2V = 1.0F / 1000;
+  const T noiseFloor = noiseFloor_mV * fct_mV2V;
 
-  // Truncate the pulser/laser artifact
-  rf.head_rows(params.truncate - 1).zeros();
+  std::vector<T> gainDB;
+  if (params.hasTGC()) {
+    const auto table = params.tgcTable(
+        nOut, static_cast<double>(params.mmPerSample) * sampleStep);
+    gainDB.assign(table.begin(), table.end());
+  }
 
-  // Beamform
-  beamform(rf, rfBeamformed, params.beamformerType);
+  // Skip the pulser/laser artifact, which reconOneScan zeros
+  const int skip = std::max(params.truncate, 0);
 
-  // compute filter kernels
-  const auto kernel = [&] {
-    constexpr int numtaps = 95;
-    if constexpr (std::is_same_v<T, double>) {
-      return signal::firwin2(numtaps, params.filterFreq, params.filterGain);
-    } else {
-      const auto _kernel =
-          signal::firwin2(numtaps, params.filterFreq, params.filterGain);
-      const auto kernel = arma::conv_to<arma::Col<T>>::from(_kernel);
-      return kernel;
+  arma::Mat<T> env(nOut, nAlines, arma::fill::none);
+  cv::parallel_for_(cv::Range(0, nAlines), [&](const cv::Range &range) {
+    for (int j = range.start; j < range.end; ++j) {
+      const T *src = rf.colptr(j * alineStep);
+      T *dst = env.colptr(j);
+      for (int i = 0; i < nOut; ++i) {
+        T peak{};
+        const int end = (i + 1) * sampleStep;
+        for (int k = std::max(i * sampleStep, skip); k < end; ++k) {
+          peak = std::max(peak, std::abs(src[k])); // NOLINT
+        }
+        dst[i] = peak; // NOLINT(*-pointer-arithmetic)
+      }
     }
-  }();
+  });
 
-  if (rf.n_rows != rfEnv.n_rows || rf.n_cols != rfEnv.n_cols) {
-    rfEnv.set_size(rf.n_rows, rf.n_cols);
+  rfLog.set_size(nOut, nAlines);
+  logCompress<T>(env, rfLog, noiseFloor, static_cast<T>(dynamicRange),
+                 gainDB);
+}
+
+/**
+@brief Build the FFT engines used by reconOneScan for the PA and US sizes of
+`ioparams`, and calibrate (and persist) the FIR dispatch for them
+(fir::Dispatcher::tune), so the first frame doesn't pay for planning or
+calibration.
+
+FFT engines are cached per thread: call this on every thread that will run
+reconOneScan. Only the uspam::fft engines follow fft::planner_flags() and the
+saved wisdom. The overlap-add FIR path (fftconv) plans its own FFTs: running
+it here may create those plans on this thread, but they aren't tuned.
+*/
+template <Floating T>
+void warmup(const io::IOParams &ioparams, int alinesPerBscan) {
+  for (const int n : {ioparams.rf_size_PA, ioparams.rf_size_US()}) {
+    if (n <= 0) {
+      continue;
+    }
+    fir::Dispatcher::get().tune<T>(n, FIR_NUMTAPS, alinesPerBscan);
+
+    const arma::Mat<T> rf(n, alinesPerBscan, arma::fill::zeros);
+    arma::Col<T> kernel(FIR_NUMTAPS, arma::fill::zeros);
+    kernel(FIR_NUMTAPS / 2) = 1;
+    arma::Mat<T> env(n, alinesPerBscan, arma::fill::none);
+    recon<T>(rf, kernel, env);
   }
+}
 
-  recon<T>(rfBeamformed, kernel, rfEnv);
+// Passband [lo, hi] of a firwin2 response (normalized to Nyquist): the span
+// of frequencies at the maximum gain.
+inline std::pair<double, double> passband(const std::vector<double> &freq,
+                                          const std::vector<double> &gain) {
+  assert(freq.size() == gain.size() && !freq.empty());
+  const double maxGain = *std::max_element(gain.begin(), gain.end());
+  double lo = 1.0;
+  double hi = 0.0;
+  for (size_t i = 0; i < freq.size(); ++i) {
+    if (gain[i] == maxGain) {
+      lo = std::min(lo, freq[i]);
+      hi = std::max(hi, freq[i]);
+    }
+  }
+  return {lo, hi};
+}
 
-  constexpr float fct_mV2V = 1.0F / 1000;
-  rfLog.set_size(rf.n_rows, rf.n_cols);
-  logCompress<T>(rfEnv, rfLog, params.noiseFloor_mV * fct_mV2V,
-                 params.desiredDynamicRange);
+/**
+Decimation factor of the IQ envelope: as much as the signal bandwidth allows,
+but not below the display resolution (see displayDecimationFactor) so the
+radial image size doesn't change.
+*/
+inline int iqDecimationFactor(double halfBandwidth, int numSamples,
+                              int numAlines) {
+  const int maxFactor = displayDecimationFactor(numSamples, numAlines);
+  if (halfBandwidth <= 0) {
+    return 1;
+  }
+  // NOLINTNEXTLINE(*-magic-numbers)
+  const double bwFactor = std::floor(1.0 / (1.25 * halfBandwidth));
+  return std::clamp(static_cast<int>(std::min<double>(bwFactor, maxFactor)), 1,
+                    maxFactor);
 }
 
-// FIR filter + Envelope detection + log compression for one
+// Quadrature demodulation envelope of every A-line of rf, centred on the
+// passband of params.filterFreq/filterGain. env has fewer rows than rf.
+// The decimation depends on the number of A-lines of the B-scan, `numAlines`
+// if rf is only part of it (0: rf.n_cols).
 template <Floating T>
-void reconOneScan(const ReconParams &params, arma::Mat<T> &rf,
-                  arma::Mat<T> &rfEnv, arma::Mat<uint8_t> &rfLog, bool flip) {
-  if (flip) {
-    // Do flip
-    imutil::fliplr_inplace(rf);
+void reconIQ(const ReconParams &params, const arma::Mat<T> &rf,
+             arma::Mat<T> &env, const int numAlines = 0) {
+  const auto [lo, hi] = passband(params.filterFreq, params.filterGain);
+  const double f0 = (lo + hi) / 2;
+  const double halfBandwidth = (hi - lo) / 2;
+  const int factor = iqDecimationFactor(
+      halfBandwidth, static_cast<int>(rf.n_rows),
+      numAlines > 0 ? numAlines : static_cast<int>(rf.n_cols));
 
-    // Do rotate
-    rf = arma::shift(rf, params.rotateOffset, 1);
-  }
+  const signal::IQDemodulator<T> demod(f0, halfBandwidth, factor);
+  env.set_size(demod.outputSize(rf.n_rows), rf.n_cols);
 
-  // Truncate the pulser/laser artifact
-  rf.head_rows(params.truncate - 1).zeros();
+  cv::parallel_for_(cv::Range(0, rf.n_cols), [&](const cv::Range &range) {
+    for (int j = range.start; j < range.end; ++j) {
+      const auto src = rf.unsafe_col(j);
+      auto dst = env.unsafe_col(j);
+      demod.envelope(src, dst);
+    }
+  });
+}
+
+// Envelope of every A-line of rf with the method selected in params.
+// `numAlines` as in reconIQ.
+template <Floating T>
+void envelope(const ReconParams &params, const arma::Mat<T> &rf,
+              arma::Mat<T> &rfEnv, const int numAlines = 0) {
+  if (params.envelopeMethod == EnvelopeMethod::IQ) {
+    // The IQ low-pass already band limits to the filter passband
+    reconIQ<T>(params, rf, rfEnv, numAlines);
+    return;
+  }
 
   // compute filter kernels
   const auto kernel = [&] {
-    constexpr int numtaps = 95;
+    constexpr int numtaps = FIR_NUMTAPS;
     if constexpr (std::is_same_v<T, double>) {
       return signal::firwin2(numtaps, params.filterFreq, params.filterGain);
     } else {
@@ -191,10 +450,100 @@ void reconOneScan(const ReconParams &params, arma::Mat<T> &rf,
   }
 
   recon<T>(rf, kernel, rfEnv);
+}
 
-  constexpr float fct_mV2V = 1.0F / 1000;
-  rfLog.set_size(rf.n_rows, rf.n_cols);
-  logCompress<T>(rfEnv, rfLog, params.noiseFloor_mV * fct_mV2V,
-                 params.desiredDynamicRange);
+// FIR filter + Envelope detection + log compression for PA/US pair
+// rf contains the RF signal, and results are saved to rfLog.
+// If given, the en-face projections of each channel are computed in the same
+// pass (see logCompressForDisplay).
+template <Floating T>
+void reconOneScan(const ReconParams2 &params, io::PAUSpair<T> &rf,
+                  io::PAUSpair<T> &rfEnv, io::PAUSpair<uint8_t> &rfLog,
+                  metrics::FrameProjection *projectionPA = nullptr,
+                  metrics::FrameProjection *projectionUS = nullptr) {
+  reconOneScan<T>(params.PA, rf.PA, rfEnv.PA, rfLog.PA, nullptr,
+                  projectionPA);
+  reconOneScan<T>(params.US, rf.US, rfEnv.US, rfLog.US, nullptr,
+                  projectionUS);
+}
+
+// Beamform + FIR filter + Envelope detection + log compression for one
+// The A-lines stay in acquisition order. The scan direction is applied when
+// making the image (see ReconParams::permutation and imutil::makeRadial).
+template <Floating T>
+void reconOneScan(const ReconParams &params, arma::Mat<T> &rf,
+                  arma::Mat<T> &rfBeamformed, arma::Mat<T> &rfEnv,
+                  arma::Mat<uint8_t> &rfLog, AutoGain *autoGain = nullptr,
+                  metrics::FrameProjection *projection = nullptr) {
+  // Truncate the pulser/laser artifact
+  rf.head_rows(params.truncate - 1).zeros();
+
+  // Beamform
+  beamform(rf, rfBeamformed, params.beamformerType);
+
+  envelope<T>(params, rfBeamformed, rfEnv);
+
+  logCompressForDisplay<T>(params, rfEnv, rfLog,
+                           static_cast<int>(rfBeamformed.n_rows), autoGain,
+                           projection);
+
+  // Before scan conversion. The en-face projection stays unfiltered.
+  reduceSpeckle(params, rfLog);
+}
+
+/**
+@brief A-line `j` of beamform(rf) followed by the rfEnv overload of
+reconOneScan (the GUI's full frame order: beamform, then truncate the
+pulser/laser artifact and envelope detect), without reconstructing the whole
+frame. Only the A-lines the beamformer reads for line j (see
+beamformer::beamformHalfWidth) are beamformed, and only line j is truncated,
+filtered and envelope detected. `rf` isn't modified. The outputs have one
+column, `rfBeamformed` truncated like the full frame's.
+
+The rfBeamformed overload of reconOneScan truncates before beamforming, which
+only gives the same result if the truncated rows are outside the beamformer's
+depth window.
+*/
+template <Floating T>
+void reconOneAline(const ReconParams &params, const arma::Mat<T> &rf,
+                   const int j, arma::Mat<T> &rfBeamformed,
+                   arma::Mat<T> &rfEnv) {
+  const auto n = static_cast<int>(rf.n_cols);
+  assert(j >= 0 && j < n);
+  const int half = beamformer::beamformHalfWidth<T>(
+      static_cast<int>(rf.n_rows), params.beamformerType);
+
+  // Neighbourhood of j, wrapping around like the full frame
+  arma::Mat<T> window(rf.n_rows, 2 * half + 1, arma::fill::none);
+  for (int k = 0; k <= 2 * half; ++k) {
+    window.col(k) = rf.col((((j - half + k) % n) + n) % n);
+  }
+
+  beamform(window, window, params.beamformerType);
+  rfBeamformed = window.col(half);
+
+  // Truncate the pulser/laser artifact
+  rfBeamformed.head_rows(params.truncate - 1).zeros();
+
+  envelope<T>(params, rfBeamformed, rfEnv, n);
+}
+
+// FIR filter + Envelope detection + log compression for one
+// The A-lines stay in acquisition order (see above)
+template <Floating T>
+void reconOneScan(const ReconParams &params, arma::Mat<T> &rf,
+                  arma::Mat<T> &rfEnv, arma::Mat<uint8_t> &rfLog,
+                  AutoGain *autoGain = nullptr,
+                  metrics::FrameProjection *projection = nullptr) {
+  // Truncate the pulser/laser artifact
+  rf.head_rows(params.truncate - 1).zeros();
+
+  envelope<T>(params, rf, rfEnv);
+
+  logCompressForDisplay<T>(params, rfEnv, rfLog, static_cast<int>(rf.n_rows),
+                           autoGain, projection);
+
+  // Before scan conversion. The en-face projection stays unfiltered.
+  reduceSpeckle(params, rfLog);
 }
 } // namespace uspam::recon
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "uspam/beamformer/beamformer.hpp"
+#include "uspam/imutil.hpp"
 #include <armadillo>
 #include <filesystem>
 #include <rapidjson/document.h>
+#include <utility>
 #include <vector>
 
 namespace uspam::recon {
@@ -11,6 +13,25 @@ namespace fs = std::filesystem;
 
 using beamformer::BeamformerType;
 
+enum class EnvelopeMethod {
+  Hilbert, // Bandpass FIR + FFT Hilbert transform, full resolution
+  IQ,      // Quadrature demodulation at the filter passband centre, decimated
+};
+
+enum class TemporalFilterType {
+  None,
+  Box,         // Mean of the last temporalFrames frames
+  Exponential, // Persistence: history weighted by temporalPersistence
+  Median3,     // Median of the last 3 frames
+};
+
+enum class SpeckleFilterType {
+  None,
+  Median,    // Median of a (2 speckleRadius + 1)^2 window
+  Bilateral, // Bilateral filter, range sigma speckleStrength levels
+  Diffusion, // Perona-Malik anisotropic diffusion, edge scale speckleStrength
+};
+
 struct ReconParams {
   std::vector<double> filterFreq;
   std::vector<double> filterGain;
@@ -21,17 +42,79 @@ struct ReconParams {
 
   BeamformerType beamformerType;
 
+  // Low-pass and decimate the envelope to about the display resolution before
+  // log compression. rfEnv is kept at full resolution.
+  bool decimateEnvelope{false};
+
+  EnvelopeMethod envelopeMethod{EnvelopeMethod::Hilbert};
+
+  // Depth [mm] of one RF sample. Maps the TGC depths to samples
+  float mmPerSample{};
+
+  // Time gain compensation [dB] added in the log compression:
+  //   tgcSlope_dBmm * depth + piecewise linear (tgcDepth_mm, tgcGain_dB)
+  // The piecewise part is held constant outside the given depths.
+  float tgcSlope_dBmm{};
+  std::vector<double> tgcDepth_mm;
+  std::vector<double> tgcGain_dB;
+
+  // Derive noiseFloor_mV and desiredDynamicRange from each frame's envelope
+  // histogram instead of using the fixed values (see AutoGain)
+  bool autoGain{false};
+  float autoGainNoisePercentile{50.0F};
+  float autoGainPeakPercentile{99.9F};
+  float autoGainSmoothing{0.8F}; // weight of the previous frames
+
+  // Depth window [mm] of the en-face projections (see metrics::project). An
+  // end <= begin means to the end of the A-line.
+  float enfaceDepthBegin_mm{};
+  float enfaceDepthEnd_mm{};
+
+  // Temporal filter of rfLog across consecutive frames (see TemporalFilter)
+  TemporalFilterType temporalFilter{TemporalFilterType::None};
+  int temporalFrames{4};
+  float temporalPersistence{0.5F};
+
+  // Speckle reduction of rfLog before scan conversion (see reduceSpeckle).
+  // speckleStrength is in rfLog levels (0-255).
+  SpeckleFilterType speckleFilter{SpeckleFilterType::None};
+  int speckleRadius{1};
+  float speckleStrength{20.0F};
+
+  [[nodiscard]] bool hasTGC() const;
+  // TGC [dB] for n rows spaced mmPerRow apart
+  [[nodiscard]] std::vector<double> tgcTable(int n, double mmPerRow) const;
+
+  // En-face window [begin, end) in rows spaced mmPerRow apart. end is -1 for
+  // the end of the A-line.
+  [[nodiscard]] std::pair<int, int> enfaceRows(double mmPerRow) const;
+
   [[nodiscard]] rapidjson::Value
   serialize(rapidjson::Document::AllocatorType &allocator) const;
-  static ReconParams deserialize(const rapidjson::Value &obj);
+  // Keys missing in obj keep their value from `params`
+  static ReconParams deserialize(const rapidjson::Value &obj,
+                                 ReconParams params = {});
 
   static bool flip(int frameIdx) { return frameIdx % 2 == 0; }
+
+  // Display order of the A-lines. Flipped frames are also rotated by
+  // rotateOffset.
+  [[nodiscard]] imutil::ColumnPermutation permutation(bool flip) const {
+    return flip ? imutil::ColumnPermutation{true, rotateOffset}
+                : imutil::ColumnPermutation{};
+  }
 };
 
 struct ReconParams2 {
   ReconParams PA;
   ReconParams US;
 
+  // PAUS overlay (see imutil::OverlayCompositor): PA levels (0-255) above
+  // overlayThreshold are drawn over the US, fading in over overlayRamp levels
+  // (0 for a hard mask).
+  int overlayThreshold{10};
+  int overlayRamp{0};
+
   static inline ReconParams2 system2024v1() {
     // NOLINTBEGIN(*-magic-numbers)
     ReconParams PA{{0, 0.03, 0.035, 0.2, 0.22, 1},
@@ -44,6 +127,10 @@ struct ReconParams2 {
     ReconParams US{{0, 0.1, 0.3, 1},    {0, 1, 1, 0}, 500, 25, 6.0F, 48.0F,
                    BeamformerType::NONE};
 
+    // 180 MHz sampling, 1500 m/s sound speed. US travels the depth twice
+    PA.mmPerSample = 1500.0F * 1000 / 180e6F;
+    US.mmPerSample = 1500.0F / 2 * 1000 / 180e6F;
+
     return ReconParams2{PA, US};
     // NOLINTEND(*-magic-numbers)
   }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "uspam/reconParams.hpp"
+#include <armadillo>
+#include <cstdint>
+
+namespace uspam::recon {
+
+/**
+@brief Speckle reduction of `rfLog` (samples x A-lines) in place with the
+filter of `params` (speckleFilter, speckleRadius, speckleStrength).
+
+The filter runs in the native depth x angle grid before scan conversion, so
+it costs the same at any display size and never smooths interpolation
+artifacts. The A-lines cover a full rotation: neighbourhoods wrap around in
+angle (the last A-line is next to the first) and repeat the edge sample in
+depth. The scan direction and rotation offset of the display only reorder
+A-lines cyclically, so the acquisition order can be filtered directly.
+
+Median and Bilateral run OpenCV's vectorized kernels in parallel on tiles of
+A-lines padded with the wrapped neighbours. Diffusion runs 2 r^2
+Perona-Malik iterations (about the reach of a radius r window) with a
+vectorizable 4-neighbour stencil, parallel over A-lines.
+*/
+void reduceSpeckle(const ReconParams &params, arma::Mat<uint8_t> &rfLog);
+
+} // namespace uspam::recon
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "uspam/imutil.hpp"
+#include "uspam/reconParams.hpp"
+#include <armadillo>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace uspam::recon {
+
+/**
+@brief Per channel temporal filter of rfLog across consecutive frames
+(frame averaging/persistence) to reduce speckle and PA noise flicker.
+
+The filter keeps a ring buffer of the most recent frames in display order, so
+A-line j is the same angle in every frame regardless of the scan direction
+and rotation of each frame. Frames only come from apply(): older frames are
+never read back from disk. The history restarts whenever the frames stop
+being consecutive (a seek), the shape or the filter type changes. Applying
+the same frame again (e.g. after a parameter change) replaces its previous
+contribution instead of adding to it.
+
+The blends use OpenCV's vectorized arithmetic (add, min/max,
+accumulateWeighted).
+
+Copies are cheap and share the history: apply() writes every new frame and
+state to new buffers and never modifies a shared one. A frame can be filtered
+on a copy and the copy assigned back only if the frame is kept.
+*/
+class TemporalFilter {
+public:
+  // Longest Box filter
+  static constexpr int MAX_FRAMES = 16;
+
+  /**
+  @brief Filter `rfLog` (samples x A-lines, acquisition order) of frame
+  `frameIdx` in place with the temporal filter of `params`. `perm` is the
+  display order of the frame.
+  */
+  void apply(const ReconParams &params, int frameIdx,
+             arma::Mat<uint8_t> &rfLog, const imutil::ColumnPermutation &perm);
+
+  // Forget the history (e.g. when a new file is opened)
+  void reset();
+
+  // Frames in the history
+  [[nodiscard]] int size() const { return m_count; }
+
+private:
+  // Ring slot `age` frames before the newest (0 = newest)
+  [[nodiscard]] cv::Mat &frame(int age) {
+    const auto n = static_cast<int>(m_ring.size());
+    return m_ring[(m_head - age + n) % n];
+  }
+
+  TemporalFilterType m_type{TemporalFilterType::None};
+  cv::Size m_size; // One row per A-line
+
+  // Display order frames, as many as the filter needs. m_head is the newest.
+  std::vector<cv::Mat> m_ring;
+  int m_head{-1};
+  int m_count{};
+  int m_lastFrame{-1};
+
+  // Exponential persistence state, and the state before the newest frame
+  // (to apply the same frame again)
+  cv::Mat m_state;
+  cv::Mat m_prevState;
+
+  // Scratch, its contents don't matter between calls
+  cv::Mat m_acc;
+  cv::Mat m_out;
+};
+
+} // namespace uspam::recon
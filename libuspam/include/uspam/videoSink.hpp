@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
+
+namespace uspam::io {
+namespace fs = std::filesystem;
+
+enum class VideoCodec {
+  MJPG, // Motion JPEG (lossy, honours `quality`). Built into OpenCV
+  FFV1, // FFmpeg lossless codec. Requires the FFmpeg backend
+};
+
+struct VideoSinkParams {
+  double fps{30.0}; // NOLINT(*-magic-numbers)
+  int quality{90};  // [0, 100] only used by lossy codecs
+  VideoCodec codec{VideoCodec::MJPG};
+
+  // Max number of frames buffered before `push` blocks the producer
+  int maxQueued{16}; // NOLINT(*-magic-numbers)
+
+  [[nodiscard]] int fourcc() const;
+};
+
+/**
+@brief Video sink stage that writes a sequence of images (e.g. PAUSradial) to a
+video file on its own thread.
+
+Frames are tagged with their frame index and written in increasing index order,
+so producers that finish frames out of order (e.g. a thread pool) can push
+directly. The cv::VideoWriter is opened lazily on the first frame since the
+frame size and number of channels are only known then. All public methods are
+thread safe.
+
+Example:
+
+  VideoSink sink("PAUS.avi", {.fps = 30, .quality = 95});
+  for (...) {
+    sink.push(frameIdx, PAUSradial);
+  }
+  sink.close(); // Flushes the queue and joins the writer thread
+*/
+class VideoSink {
+public:
+  VideoSink() = default;
+  VideoSink(const fs::path &filename, const VideoSinkParams &params) {
+    open(filename, params);
+  }
+  VideoSink(const VideoSink &) = delete;
+  VideoSink(VideoSink &&) = delete;
+  VideoSink &operator=(const VideoSink &) = delete;
+  VideoSink &operator=(VideoSink &&) = delete;
+  ~VideoSink() { close(); }
+
+  // Start the writer thread. Returns false if a sink is already open.
+  bool open(const fs::path &filename, const VideoSinkParams &params);
+
+  // Write all queued frames, close the file and join the writer thread.
+  void close();
+
+  [[nodiscard]] bool isOpen() const;
+
+  // Queue a frame for writing. `frame` is reference counted (not copied), so
+  // the caller must not write into its buffer after pushing. Frames with an
+  // index lower than one already written are dropped. Blocks while the queue
+  // is full.
+  void push(int frameIdx, const cv::Mat &frame);
+
+  [[nodiscard]] int framesWritten() const;
+
+  // Last error from the writer thread (empty if none)
+  [[nodiscard]] std::string error() const;
+
+private:
+  void run();
+  bool writeOne(const cv::Mat &frame);
+
+  fs::path m_filename;
+  VideoSinkParams m_params;
+
+  std::thread m_thread;
+  mutable std::mutex m_mtx;
+  std::condition_variable m_cvProducer;
+  std::condition_variable m_cvConsumer;
+
+  // Frames waiting to be written, ordered by frame index
+  std::map<int, cv::Mat> m_queue;
+  int m_nextIdx{-1}; // Lowest frame index still accepted
+  bool m_open{false};
+  bool m_closing{false};
+
+  // Only accessed from the writer thread
+  cv::VideoWriter m_writer;
+  cv::Size m_frameSize;
+
+  int m_framesWritten{0};
+  std::string m_error;
+};
+
+} // namespace uspam::io
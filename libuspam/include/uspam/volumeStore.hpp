@@ -0,0 +1,108 @@
+#pragma once
+
+#include "uspam/imutil.hpp"
+#include "uspam/mappedFile.hpp"
+#include <armadillo>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <opencv2/opencv.hpp>
+#include <shared_mutex>
+#include <span>
+
+namespace uspam::io {
+namespace fs = std::filesystem;
+
+struct VolumeStoreHeader {
+  static constexpr std::array<char, 8> MAGIC{'A', 'R', 'P', 'A',
+                                             'M', 'V', 'O', 'L'};
+  static constexpr uint32_t VERSION = 1;
+
+  std::array<char, 8> magic{MAGIC};
+  uint32_t version{VERSION};
+  uint32_t numFrames{};
+  uint32_t numAlines{};
+  std::array<uint32_t, 2> numSamples{}; // PA, US
+  std::array<uint8_t, 36> reserved{};   // Pad to 64 bytes
+};
+static_assert(sizeof(VolumeStoreHeader) == 64);
+
+/**
+@brief The log compressed B-scans (rfLog) of every frame of a sequence, PA and
+US, in one memory mapped file, for views across frames such as longitudinal
+cuts of a pullback.
+
+Frames are added in any order as they are reconstructed. A-lines are stored in
+display order (the scan direction and rotation offset of each frame applied),
+so an A-line index is the same angle in every frame. Each channel is a 3-D
+array [frame][A-line][sample]: a cut through all frames reads one contiguous
+A-line per frame. The OS pages the file in and out, so a volume may be larger
+than the RAM.
+
+File layout: VolumeStoreHeader, one "stored" byte per frame and channel, then
+the PA and US arrays (page aligned).
+
+All functions are thread safe: frames can be added by one thread while
+another reads cuts.
+*/
+class VolumeStore {
+public:
+  enum Channel { PA = 0, US = 1, NumChannels };
+
+  struct Shape {
+    int numFrames{};
+    int numAlines{};
+    std::array<int, NumChannels> numSamples{};
+
+    bool operator==(const Shape &) const = default;
+  };
+
+  VolumeStore() = default;
+
+  // Open `filename` for a volume of `shape` with no frames stored. An
+  // existing file is resized and its frames are discarded.
+  bool open(const fs::path &filename, const Shape &shape);
+  void close();
+
+  [[nodiscard]] bool isOpen() const;
+  [[nodiscard]] Shape shape() const;
+  [[nodiscard]] fs::path path() const;
+
+  /**
+  @brief Store `rfLog` (samples x A-lines) of `frame`. Column j of the stored
+  frame is column perm.src(j) of rfLog. Returns false if the size doesn't
+  match the shape.
+  */
+  bool put(Channel ch, int frame, const arma::Mat<uint8_t> &rfLog,
+           const imutil::ColumnPermutation &perm = {});
+
+  [[nodiscard]] bool has(Channel ch, int frame) const;
+
+  /**
+  @brief Longitudinal cut through all frames along the diameter at A-line
+  `aline` (display order). Row f is frame f: the opposite A-line from the
+  outside in, then A-line `aline` from the centre out (2 * numSamples
+  columns, the centre in the middle). Frames not stored are black.
+  */
+  [[nodiscard]] cv::Mat longitudinal(Channel ch, int aline) const;
+
+  // Start writing the stored frames back to the file
+  bool flush();
+
+private:
+  [[nodiscard]] size_t frameSize(Channel ch) const {
+    return static_cast<size_t>(m_shape.numAlines) * m_shape.numSamples[ch];
+  }
+  [[nodiscard]] uint8_t *flags(Channel ch);
+  [[nodiscard]] const uint8_t *flags(Channel ch) const;
+  [[nodiscard]] const uint8_t *frameData(Channel ch, int frame) const;
+  [[nodiscard]] uint8_t *frameData(Channel ch, int frame);
+
+  mutable std::shared_mutex m_mtx;
+  MappedFile m_file;
+  fs::path m_path;
+  Shape m_shape;
+  std::array<size_t, NumChannels> m_offset{};
+};
+
+} // namespace uspam::io
@@ -0,0 +1,71 @@
+#include "uspam/autoGain.hpp"
+#include <cmath>
+
+namespace uspam::recon {
+
+namespace {
+
+// Bounds for the derived dynamic range [dB], same as the GUI
+constexpr double MIN_DYNAMIC_RANGE = 10.0;
+constexpr double MAX_DYNAMIC_RANGE = 70.0;
+
+double toDB(double val) { return 20.0 * std::log10(val); } // NOLINT
+
+} // namespace
+
+float EnvelopeHistogram::percentile(double percentile) const {
+  if (total == 0) {
+    return 0.0F;
+  }
+
+  const auto target = static_cast<double>(total) * percentile / 100.0;
+  double cum = 0;
+  for (int i = 0; i < NBINS; ++i) {
+    const auto count = static_cast<double>(counts[i]);
+    if (cum + count >= target && count > 0) {
+      // Bins are linear within an octave
+      const double t = std::clamp((target - cum) / count, 0.0, 1.0);
+      const double lo = lowerEdge(i);
+      const double hi = lowerEdge(i + 1);
+      return static_cast<float>(lo + t * (hi - lo));
+    }
+    cum += count;
+  }
+  return value(NBINS - 1);
+}
+
+AutoGain::Result AutoGain::update(const EnvelopeHistogram &hist,
+                                  double noisePercentile,
+                                  double peakPercentile) {
+  const auto noise = hist.percentile(noisePercentile);
+  const auto peak = hist.percentile(peakPercentile);
+  if (!(noise > 0) || !(peak > 0)) {
+    return result();
+  }
+
+  const double noiseDB = toDB(noise);
+  const double peakDB = std::max(toDB(peak), noiseDB);
+
+  if (!m_initialized) {
+    m_noiseDB = noiseDB;
+    m_peakDB = peakDB;
+    m_initialized = true;
+  } else {
+    const double a = m_smoothing;
+    m_noiseDB = a * m_noiseDB + (1 - a) * noiseDB;
+    m_peakDB = a * m_peakDB + (1 - a) * peakDB;
+  }
+
+  return result();
+}
+
+AutoGain::Result AutoGain::result() const {
+  constexpr double fct_V2mV = 1000.0;
+  const auto noiseFloor_mV = std::pow(10.0, m_noiseDB / 20) * fct_V2mV;
+  const auto dynamicRange = std::clamp(m_peakDB - m_noiseDB,
+                                       MIN_DYNAMIC_RANGE, MAX_DYNAMIC_RANGE);
+  return {static_cast<float>(noiseFloor_mV),
+          static_cast<float>(dynamicRange)};
+}
+
+} // namespace uspam::recon
@@ -0,0 +1,338 @@
+#include "uspam/binfileIndex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <opencv2/core.hpp>
+
+namespace uspam::io {
+
+// NOLINTBEGIN(*-magic-numbers,*-reinterpret-cast,*-pointer-arithmetic)
+
+namespace {
+
+constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t hashRound(uint64_t acc, uint64_t lane) {
+  acc += lane * PRIME2;
+  acc = rotl(acc, 31);
+  return acc * PRIME1;
+}
+
+inline uint64_t load64(const std::byte *p) {
+  uint64_t v{};
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline int64_t fileMtime(const fs::path &path, std::error_code &ec) {
+  return static_cast<int64_t>(
+      fs::last_write_time(path, ec).time_since_epoch().count());
+}
+
+/**
+Compute the statistics, hash and thumbnail of one frame of raw uint16 samples
+(column major, one A-line per column).
+*/
+BinfileFrameEntry summarizeFrame(std::span<const uint16_t> frame,
+                                 int alineSize, int alines,
+                                 std::span<uint8_t> thumb, int thumbWidth,
+                                 int thumbHeight) {
+  BinfileFrameEntry entry{};
+  entry.hash = hash64(std::as_bytes(frame));
+
+  uint16_t vmin = std::numeric_limits<uint16_t>::max();
+  uint16_t vmax = 0;
+  uint64_t sum = 0;
+  size_t railed = 0;
+  for (const auto v : frame) {
+    vmin = std::min(vmin, v);
+    vmax = std::max(vmax, v);
+    sum += v;
+    railed += static_cast<size_t>(
+        v == 0 || v == std::numeric_limits<uint16_t>::max());
+  }
+  const double mean = static_cast<double>(sum) / frame.size();
+
+  entry.min = static_cast<float>(vmin);
+  entry.max = static_cast<float>(vmax);
+  entry.mean = static_cast<float>(mean);
+  // A flat frame (e.g. zero filled) has no signal to saturate, even if its
+  // one value is at a rail
+  if (vmin == vmax) {
+    entry.flags |= FRAME_FLAT;
+  } else if (static_cast<double>(railed) >
+             BinfileIndex::SATURATED_FRACTION * frame.size()) {
+    entry.flags |= FRAME_SATURATED;
+  }
+
+  // Thumbnail: mean absolute deviation from the frame mean over each
+  // (depth, A-line) bin, log compressed to 40 dB below the brightest bin.
+  std::vector<double> acc(thumb.size(), 0.0);
+  std::vector<int> count(thumb.size(), 0);
+  for (int col = 0; col < alines; ++col) {
+    const int tc = col * thumbWidth / alines;
+    const auto *aline = frame.data() + static_cast<size_t>(col) * alineSize;
+    for (int row = 0; row < alineSize; ++row) {
+      const int tr = row * thumbHeight / alineSize;
+      const auto i = static_cast<size_t>(tr) * thumbWidth + tc;
+      acc[i] += std::abs(static_cast<double>(aline[row]) - mean);
+      ++count[i];
+    }
+  }
+
+  double accMax = 0;
+  for (size_t i = 0; i < acc.size(); ++i) {
+    acc[i] = count[i] > 0 ? acc[i] / count[i] : 0.0;
+    accMax = std::max(accMax, acc[i]);
+  }
+
+  if (accMax == 0) {
+    std::fill(thumb.begin(), thumb.end(), uint8_t{0});
+    return entry;
+  }
+
+  constexpr double dynamicRange = 40.0;
+  for (size_t i = 0; i < acc.size(); ++i) {
+    const double db = 20.0 * std::log10((acc[i] + 1.0) / (accMax + 1.0));
+    const double val = std::clamp(1.0 + db / dynamicRange, 0.0, 1.0);
+    thumb[i] = static_cast<uint8_t>(std::lround(val * 255.0));
+  }
+
+  return entry;
+}
+
+} // namespace
+
+uint64_t hash64(std::span<const std::byte> data, uint64_t seed) {
+  const auto *p = data.data();
+  const size_t n = data.size();
+  size_t i = 0;
+
+  // 4 independent lanes so the multiplies pipeline
+  uint64_t h{};
+  if (n >= 32) {
+    uint64_t a0 = seed + PRIME1 + PRIME2;
+    uint64_t a1 = seed + PRIME2;
+    uint64_t a2 = seed;
+    uint64_t a3 = seed - PRIME1;
+    for (; i + 32 <= n; i += 32) {
+      a0 = hashRound(a0, load64(p + i));
+      a1 = hashRound(a1, load64(p + i + 8));
+      a2 = hashRound(a2, load64(p + i + 16));
+      a3 = hashRound(a3, load64(p + i + 24));
+    }
+    h = rotl(a0, 1) + rotl(a1, 7) + rotl(a2, 12) + rotl(a3, 18);
+  } else {
+    h = seed + PRIME3;
+  }
+  h += n;
+
+  for (; i + 8 <= n; i += 8) {
+    h ^= hashRound(0, load64(p + i));
+    h = rotl(h, 27) * PRIME1 + PRIME3;
+  }
+  for (; i < n; ++i) {
+    h ^= static_cast<uint64_t>(p[i]) * PRIME3;
+    h = rotl(h, 11) * PRIME1;
+  }
+
+  // Avalanche
+  h ^= h >> 33;
+  h *= PRIME2;
+  h ^= h >> 29;
+  h *= PRIME3;
+  h ^= h >> 32;
+  return h;
+}
+
+bool BinfileIndex::build(const fs::path &binfile, const fs::path &indexFile,
+                         int byteOffset, int alinesPerBscan) {
+  std::error_code ec;
+  const auto fileSize = fs::file_size(binfile, ec);
+  const auto mtime = ec ? 0 : fileMtime(binfile, ec);
+  if (ec) {
+    std::cerr << "[BinfileIndex] Failed to stat " << binfile << ": "
+              << ec.message() << "\n";
+    return false;
+  }
+
+  const size_t frameSamples =
+      static_cast<size_t>(RF_ALINE_SIZE) * alinesPerBscan;
+  const size_t frameBytes = frameSamples * sizeof(uint16_t);
+  const size_t dataBytes =
+      fileSize > static_cast<uint64_t>(byteOffset) ? fileSize - byteOffset : 0;
+
+  BinfileIndexHeader header;
+  header.numFrames = static_cast<uint32_t>(dataBytes / frameBytes);
+  header.fileSize = fileSize;
+  header.mtime = mtime;
+  header.byteOffset = static_cast<uint32_t>(byteOffset);
+  header.alineSize = RF_ALINE_SIZE;
+  header.alinesPerBscan = static_cast<uint32_t>(alinesPerBscan);
+  header.trailingBytes = static_cast<uint32_t>(dataBytes % frameBytes);
+  header.thumbWidth = THUMB_WIDTH;
+  header.thumbHeight = THUMB_HEIGHT;
+
+  const int numFrames = static_cast<int>(header.numFrames);
+  constexpr size_t thumbSize = THUMB_WIDTH * THUMB_HEIGHT;
+  std::vector<BinfileFrameEntry> entries(numFrames);
+  std::vector<uint8_t> thumbs(numFrames * thumbSize);
+
+  std::atomic<bool> readOk{true};
+  cv::parallel_for_(cv::Range(0, numFrames), [&](const cv::Range &range) {
+    // Each worker gets its own stream and buffer
+    std::ifstream file(binfile, std::ios::binary);
+    std::vector<uint16_t> buf(frameSamples);
+
+    for (int i = range.start; i < range.end; ++i) {
+      const auto offset = byteOffset + i * frameBytes;
+      file.seekg(static_cast<std::streamoff>(offset));
+      file.read(reinterpret_cast<char *>(buf.data()),
+                static_cast<std::streamsize>(frameBytes));
+      if (!file) {
+        readOk = false;
+        return;
+      }
+
+      entries[i] = summarizeFrame(
+          buf, RF_ALINE_SIZE, alinesPerBscan,
+          std::span{thumbs}.subspan(i * thumbSize, thumbSize), THUMB_WIDTH,
+          THUMB_HEIGHT);
+      entries[i].offset = offset;
+    }
+  });
+
+  if (!readOk) {
+    std::cerr << "[BinfileIndex] Failed to read " << binfile << "\n";
+    return false;
+  }
+
+  for (int i = 1; i < numFrames; ++i) {
+    if (entries[i].hash == entries[i - 1].hash) {
+      entries[i].flags |= FRAME_DUPLICATE;
+    }
+  }
+
+  // Write to a temporary file first so a partially written index is never
+  // picked up.
+  auto tmpFile = indexFile;
+  tmpFile += ".tmp";
+  {
+    std::ofstream file(tmpFile, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()),
+               static_cast<std::streamsize>(entries.size() *
+                                            sizeof(BinfileFrameEntry)));
+    file.write(reinterpret_cast<const char *>(thumbs.data()),
+               static_cast<std::streamsize>(thumbs.size()));
+    if (!file) {
+      std::cerr << "[BinfileIndex] Failed to write " << tmpFile << "\n";
+      file.close();
+      fs::remove(tmpFile, ec);
+      return false;
+    }
+  }
+
+  fs::rename(tmpFile, indexFile, ec);
+  if (ec) {
+    std::cerr << "[BinfileIndex] Failed to write " << indexFile << ": "
+              << ec.message() << "\n";
+    fs::remove(tmpFile, ec);
+    return false;
+  }
+  return true;
+}
+
+bool BinfileIndex::load(const fs::path &indexFile, const fs::path &binfile) {
+  close();
+
+  MappedFile file;
+  if (!file.open(indexFile) || file.size() < sizeof(BinfileIndexHeader)) {
+    return false;
+  }
+
+  BinfileIndexHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.magic != BinfileIndexHeader::MAGIC ||
+      header.version != BinfileIndexHeader::VERSION) {
+    return false;
+  }
+
+  std::error_code ec;
+  const auto fileSize = fs::file_size(binfile, ec);
+  const auto mtime = ec ? 0 : fileMtime(binfile, ec);
+  if (ec || header.fileSize != fileSize || header.mtime != mtime) {
+    return false;
+  }
+
+  const size_t thumbSize =
+      static_cast<size_t>(header.thumbWidth) * header.thumbHeight;
+  const size_t expectedSize =
+      sizeof(BinfileIndexHeader) +
+      header.numFrames * (sizeof(BinfileFrameEntry) + thumbSize);
+  if (file.size() != expectedSize) {
+    return false;
+  }
+
+  m_file = std::move(file);
+  return true;
+}
+
+bool BinfileIndex::open(const fs::path &binfile, int byteOffset,
+                        int alinesPerBscan) {
+  const auto indexFile = indexPath(binfile);
+
+  const auto matches = [&] {
+    return header().byteOffset == static_cast<uint32_t>(byteOffset) &&
+           header().alinesPerBscan == static_cast<uint32_t>(alinesPerBscan);
+  };
+
+  if (load(indexFile, binfile) && matches()) {
+    return true;
+  }
+  close();
+
+  return build(binfile, indexFile, byteOffset, alinesPerBscan) &&
+         load(indexFile, binfile);
+}
+
+std::span<const BinfileFrameEntry> BinfileIndex::entries() const {
+  if (!isOpen()) {
+    return {};
+  }
+  const auto *begin = reinterpret_cast<const BinfileFrameEntry *>(
+      m_file.data() + sizeof(BinfileIndexHeader));
+  return {begin, header().numFrames};
+}
+
+std::span<const uint8_t> BinfileIndex::thumbnail(int frameIdx) const {
+  const auto &h = header();
+  const size_t thumbSize = static_cast<size_t>(h.thumbWidth) * h.thumbHeight;
+  const auto *begin = reinterpret_cast<const uint8_t *>(
+      m_file.data() + sizeof(BinfileIndexHeader) +
+      h.numFrames * sizeof(BinfileFrameEntry) + frameIdx * thumbSize);
+  return {begin, thumbSize};
+}
+
+std::vector<int> BinfileIndex::flaggedFrames() const {
+  std::vector<int> flagged;
+  const auto ents = entries();
+  for (int i = 0; i < static_cast<int>(ents.size()); ++i) {
+    if (ents[i].flags != FRAME_OK) {
+      flagged.push_back(i);
+    }
+  }
+  return flagged;
+}
+
+// NOLINTEND(*-magic-numbers,*-reinterpret-cast,*-pointer-arithmetic)
+
+} // namespace uspam::io
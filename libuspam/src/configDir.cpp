@@ -0,0 +1,62 @@
+#include "uspam/configDir.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <system_error>
+
+namespace uspam {
+
+namespace {
+
+fs::path envPath(const char *name) {
+  // NOLINTNEXTLINE(*-mt-unsafe)
+  const char *val = std::getenv(name);
+  return val != nullptr && *val != '\0' ? fs::path(val) : fs::path{};
+}
+
+fs::path findConfigDir() {
+  if (auto dir = envPath("USPAM_CONFIG_DIR"); !dir.empty()) {
+    return dir;
+  }
+
+#if defined(_WIN32)
+  if (const auto appdata = envPath("APPDATA"); !appdata.empty()) {
+    return appdata / "ARPAM";
+  }
+#elif defined(__APPLE__)
+  if (const auto home = envPath("HOME"); !home.empty()) {
+    return home / "Library" / "Application Support" / "ARPAM";
+  }
+#else
+  if (const auto xdg = envPath("XDG_CONFIG_HOME"); !xdg.empty()) {
+    return xdg / "arpam";
+  }
+  if (const auto home = envPath("HOME"); !home.empty()) {
+    return home / ".config" / "arpam";
+  }
+#endif
+
+  return {};
+}
+
+} // namespace
+
+fs::path configDir() {
+  static const fs::path dir = [] {
+    auto dir = findConfigDir();
+    if (dir.empty()) {
+      return dir;
+    }
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) {
+      std::cerr << "[configDir] Failed to create " << dir << ": "
+                << ec.message() << "\n";
+      return fs::path{};
+    }
+    return dir;
+  }();
+  return dir;
+}
+
+} // namespace uspam
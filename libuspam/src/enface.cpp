@@ -0,0 +1,149 @@
+#include "uspam/enface.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USPAM_HAS_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace uspam::metrics {
+
+// NOLINTBEGIN(*-reinterpret-cast,*-pointer-arithmetic,*-magic-numbers)
+
+namespace {
+
+// Max and sum of x[0, n) with SIMD, 16 or 32 bytes at a time. Returns the
+// number of elements processed; the rest is left for the scalar tail.
+size_t maxSumSimd(const uint8_t *x, size_t n, uint8_t &max, uint64_t &sum) {
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  if (n >= 32) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i vmax = zero;
+    __m256i vsum = zero; // 4 x u64 (psadbw against 0 sums 8 bytes)
+    for (; i + 32 <= n; i += 32) {
+      const __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + i));
+      vmax = _mm256_max_epu8(vmax, v);
+      vsum = _mm256_add_epi64(vsum, _mm256_sad_epu8(v, zero));
+    }
+    alignas(32) std::array<uint8_t, 32> maxes{};
+    alignas(32) std::array<uint64_t, 4> sums{};
+    _mm256_store_si256(reinterpret_cast<__m256i *>(maxes.data()), vmax);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(sums.data()), vsum);
+    max = std::max(max, *std::max_element(maxes.begin(), maxes.end()));
+    for (const auto s : sums) {
+      sum += s;
+    }
+  }
+
+#elif defined(USPAM_HAS_SSE2)
+  if (n >= 16) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vmax = zero;
+    __m128i vsum = zero; // 2 x u64
+    for (; i + 16 <= n; i += 16) {
+      const __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(x + i));
+      vmax = _mm_max_epu8(vmax, v);
+      vsum = _mm_add_epi64(vsum, _mm_sad_epu8(v, zero));
+    }
+    alignas(16) std::array<uint8_t, 16> maxes{};
+    alignas(16) std::array<uint64_t, 2> sums{};
+    _mm_store_si128(reinterpret_cast<__m128i *>(maxes.data()), vmax);
+    _mm_store_si128(reinterpret_cast<__m128i *>(sums.data()), vsum);
+    max = std::max(max, *std::max_element(maxes.begin(), maxes.end()));
+    sum += sums[0] + sums[1];
+  }
+
+#elif defined(__ARM_NEON)
+  if (n >= 16) {
+    uint8x16_t vmax = vdupq_n_u8(0);
+    uint32x4_t vsum = vdupq_n_u32(0);
+    for (; i + 16 <= n; i += 16) {
+      const uint8x16_t v = vld1q_u8(x + i);
+      vmax = vmaxq_u8(vmax, v);
+      vsum = vpadalq_u16(vsum, vpaddlq_u8(v));
+    }
+    std::array<uint8_t, 16> maxes{};
+    std::array<uint32_t, 4> sums{};
+    vst1q_u8(maxes.data(), vmax);
+    vst1q_u32(sums.data(), vsum);
+    max = std::max(max, *std::max_element(maxes.begin(), maxes.end()));
+    for (const auto s : sums) {
+      sum += s;
+    }
+  }
+#endif
+
+  return i;
+}
+
+} // namespace
+
+AlineProjection project(std::span<const uint8_t> col, int rowBegin,
+                        int rowEnd) {
+  const auto n = static_cast<int>(col.size());
+  const int begin = std::clamp(rowBegin, 0, n);
+  const int end = rowEnd < 0 ? n : std::clamp(rowEnd, begin, n);
+  if (begin == end) {
+    return {};
+  }
+
+  const uint8_t *x = col.data() + begin;
+  const auto len = static_cast<size_t>(end - begin);
+
+  uint8_t max{};
+  uint64_t sum{};
+  for (size_t i = maxSumSimd(x, len, max, sum); i < len; ++i) {
+    max = std::max(max, x[i]);
+    sum += x[i];
+  }
+
+  // First occurrence of the max (memchr is vectorized by the C library)
+  const auto *found = static_cast<const uint8_t *>(std::memchr(x, max, len));
+
+  AlineProjection res;
+  res.max = max;
+  res.mean = static_cast<float>(static_cast<double>(sum) / len);
+  res.argmax = begin + static_cast<int>(found - x);
+  return res;
+}
+
+// NOLINTEND(*-reinterpret-cast,*-pointer-arithmetic,*-magic-numbers)
+
+EnFaceMap::EnFaceMap()
+    : FrameTable({{"max", false}, {"mean", false}, {"depthOfMax", true}}) {
+  setUnit("rows");
+}
+
+void EnFaceMap::setFrame(int frameIdx, std::span<const AlineProjection> alines,
+                         float mmPerRow) {
+  if (!validFrame(frameIdx)) {
+    return;
+  }
+  setUnit(mmPerRow > 0 ? "mm" : "rows");
+  const float fct = mmPerRow > 0 ? mmPerRow : 1.0F;
+
+  const int n = std::min(static_cast<int>(alines.size()), numAlines());
+  for (int j = 0; j < n; ++j) {
+    const auto &a = alines[j];
+    float *dst = row(frameIdx, j);
+    dst[Max] = a.max;
+    dst[Mean] = a.mean;
+    dst[DepthOfMax] = a.argmax >= 0
+                          ? static_cast<float>(a.argmax) * fct
+                          : std::numeric_limits<float>::quiet_NaN();
+  }
+}
+
+} // namespace uspam::metrics
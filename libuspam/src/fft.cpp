@@ -0,0 +1,71 @@
+#include "uspam/fft.hpp"
+#include "uspam/configDir.hpp"
+#include <atomic>
+#include <iostream>
+
+namespace uspam::fft {
+
+namespace {
+
+std::atomic<unsigned> g_plannerFlags{FFTW_ESTIMATE};
+
+} // namespace
+
+unsigned planner_flags() {
+  return g_plannerFlags.load(std::memory_order_relaxed);
+}
+
+void set_planner_flags(unsigned flags) {
+  g_plannerFlags.store(flags, std::memory_order_relaxed);
+}
+
+std::filesystem::path wisdom_file(bool singlePrecision) {
+  const auto dir = configDir();
+  if (dir.empty()) {
+    return {};
+  }
+  return dir / (singlePrecision ? "fftwf_wisdom.dat" : "fftw_wisdom.dat");
+}
+
+bool load_wisdom() {
+  bool ok = true;
+
+  if (const auto path = wisdom_file(false);
+      !path.empty() && std::filesystem::exists(path)) {
+    if (fftw_import_wisdom_from_filename(path.string().c_str()) == 0) {
+      std::cerr << "[fft] Failed to import wisdom " << path << "\n";
+      ok = false;
+    }
+  }
+
+  if (const auto path = wisdom_file(true);
+      !path.empty() && std::filesystem::exists(path)) {
+    if (fftwf_import_wisdom_from_filename(path.string().c_str()) == 0) {
+      std::cerr << "[fft] Failed to import wisdom " << path << "\n";
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+bool save_wisdom() {
+  const auto path = wisdom_file(false);
+  const auto pathf = wisdom_file(true);
+  if (path.empty() || pathf.empty()) {
+    return false;
+  }
+
+  bool ok = true;
+  if (fftw_export_wisdom_to_filename(path.string().c_str()) == 0) {
+    std::cerr << "[fft] Failed to export wisdom " << path << "\n";
+    ok = false;
+  }
+  if (fftwf_export_wisdom_to_filename(pathf.string().c_str()) == 0) {
+    std::cerr << "[fft] Failed to export wisdom " << pathf << "\n";
+    ok = false;
+  }
+  return ok;
+}
+
+} // namespace uspam::fft
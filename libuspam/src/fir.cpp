@@ -0,0 +1,159 @@
+#include "uspam/fir.hpp"
+#include "uspam/configDir.hpp"
+#include "uspam/json.hpp"
+#include <cstring>
+#include <iostream>
+#include <rapidjson/document.h>
+
+namespace uspam::fir {
+
+namespace {
+
+// Bump when the direct/FFT implementations change enough to invalidate the
+// persisted choices
+constexpr int CACHE_VERSION = 1;
+
+Method methodFromString(const char *str) {
+  if (std::strcmp(str, "direct") == 0) {
+    return Method::Direct;
+  }
+  if (std::strcmp(str, "fft") == 0) {
+    return Method::FFT;
+  }
+  return Method::Auto;
+}
+
+} // namespace
+
+const char *toString(Method method) {
+  switch (method) {
+  case Method::Direct:
+    return "direct";
+  case Method::FFT:
+    return "fft";
+  case Method::Auto:
+  default:
+    return "auto";
+  }
+}
+
+Dispatcher &Dispatcher::get() {
+  static Dispatcher dispatcher;
+  return dispatcher;
+}
+
+Dispatcher::Dispatcher() { load(); }
+
+void Dispatcher::setOverride(Method method) {
+  std::lock_guard lock(m_mtx);
+  m_override = method;
+}
+
+Method Dispatcher::getOverride() const {
+  std::lock_guard lock(m_mtx);
+  return m_override;
+}
+
+fs::path Dispatcher::cacheFile() {
+  const auto dir = configDir();
+  return dir.empty() ? fs::path{} : dir / "fir_dispatch.json";
+}
+
+void Dispatcher::load() {
+  const auto path = cacheFile();
+  if (path.empty() || !fs::exists(path)) {
+    return;
+  }
+
+  rapidjson::Document doc;
+  if (!json::fromFile(path, doc) || doc.HasParseError() || !doc.IsObject()) {
+    std::cerr << "[fir::Dispatcher] Ignoring invalid " << path << "\n";
+    return;
+  }
+
+  if (const auto it = doc.FindMember("version");
+      it == doc.MemberEnd() || !it->value.IsInt() ||
+      it->value.GetInt() != CACHE_VERSION) {
+    return;
+  }
+
+  const auto it = doc.FindMember("entries");
+  if (it == doc.MemberEnd() || !it->value.IsArray()) {
+    return;
+  }
+
+  // Entries with missing or mistyped fields are skipped, leaving those sizes
+  // to the default (Auto) dispatch
+  for (const auto &obj : it->value.GetArray()) {
+    if (!obj.IsObject()) {
+      continue;
+    }
+    const auto getInt = [&obj](const char *name, int &out) {
+      const auto m = obj.FindMember(name);
+      if (m == obj.MemberEnd() || !m->value.IsInt()) {
+        return false;
+      }
+      out = m->value.GetInt();
+      return true;
+    };
+    const auto getMs = [&obj](const char *name, float &out) {
+      if (const auto m = obj.FindMember(name);
+          m != obj.MemberEnd() && m->value.IsNumber()) {
+        out = m->value.GetFloat();
+      }
+    };
+
+    Key key{};
+    if (!getInt("n", key.n) || !getInt("taps", key.taps) ||
+        !getInt("elemSize", key.elemSize) || !getInt("batch", key.batch)) {
+      continue;
+    }
+    const auto method = obj.FindMember("method");
+    if (method == obj.MemberEnd() || !method->value.IsString()) {
+      continue;
+    }
+
+    Entry entry{};
+    entry.method = methodFromString(method->value.GetString());
+    getMs("direct_ms", entry.direct_ms);
+    getMs("fft_ms", entry.fft_ms);
+
+    if (entry.method != Method::Auto) {
+      m_table[key] = entry;
+    }
+  }
+}
+
+void Dispatcher::save(const std::map<Key, Entry> &table) {
+  const auto path = cacheFile();
+  if (path.empty()) {
+    return;
+  }
+
+  rapidjson::Document doc;
+  doc.SetObject();
+  auto &allocator = doc.GetAllocator();
+
+  rapidjson::Value entries(rapidjson::kArrayType);
+  for (const auto &[key, entry] : table) {
+    rapidjson::Value obj(rapidjson::kObjectType);
+    obj.AddMember("n", key.n, allocator);
+    obj.AddMember("taps", key.taps, allocator);
+    obj.AddMember("elemSize", key.elemSize, allocator);
+    obj.AddMember("batch", key.batch, allocator);
+    obj.AddMember("method", rapidjson::StringRef(toString(entry.method)),
+                  allocator);
+    obj.AddMember("direct_ms", entry.direct_ms, allocator);
+    obj.AddMember("fft_ms", entry.fft_ms, allocator);
+    entries.PushBack(obj, allocator);
+  }
+
+  doc.AddMember("version", CACHE_VERSION, allocator);
+  doc.AddMember("entries", entries, allocator);
+
+  if (!json::toFile(path, doc)) {
+    std::cerr << "[fir::Dispatcher] Failed to write " << path << "\n";
+  }
+}
+
+} // namespace uspam::fir
@@ -0,0 +1,83 @@
+#include "uspam/frameTable.hpp"
+#include "uspam/io.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace uspam::metrics {
+
+void FrameTable::resize(int numFrames, int numAlines) {
+  m_numFrames = std::max(numFrames, 0);
+  m_numAlines = std::max(numAlines, 0);
+  m_data.assign(static_cast<size_t>(m_numFrames) * m_numAlines *
+                    m_fields.size(),
+                std::numeric_limits<float>::quiet_NaN());
+}
+
+void FrameTable::fit(int numFrames, int numAlines, int frameIdx) {
+  numFrames = std::max(numFrames, frameIdx + 1);
+  if (m_numAlines != numAlines || m_numFrames < numFrames) {
+    resize(numFrames, numAlines);
+  }
+}
+
+bool FrameTable::hasFrame(int frameIdx) const {
+  return validFrame(frameIdx) && m_numAlines > 0 && !m_fields.empty() &&
+         !std::isnan(m_data[index(frameIdx, 0)]);
+}
+
+float FrameTable::max(int field) const {
+  float res = std::numeric_limits<float>::quiet_NaN();
+  for (auto i = static_cast<size_t>(field); i < m_data.size();
+       i += m_fields.size()) {
+    const float v = m_data[i];
+    if (!std::isnan(v) && (std::isnan(res) || v > res)) {
+      res = v;
+    }
+  }
+  return res;
+}
+
+bool FrameTable::saveCSV(const fs::path &filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    std::cerr << "[FrameTable] Failed to open " << filename << "\n";
+    return false;
+  }
+
+  file << "frame,aline";
+  for (const auto &field : m_fields) {
+    file << ',' << field.name;
+    if (field.hasUnit) {
+      file << '_' << m_unit;
+    }
+  }
+  file << "\n";
+
+  for (int i = 0; i < m_numFrames; ++i) {
+    if (!hasFrame(i)) {
+      continue;
+    }
+    for (int j = 0; j < m_numAlines; ++j) {
+      const float *values = &m_data[index(i, j)];
+      file << i << ',' << j;
+      for (size_t k = 0; k < m_fields.size(); ++k) {
+        file << ',' << values[k]; // NOLINT(*-pointer-arithmetic)
+      }
+      file << "\n";
+    }
+  }
+
+  return static_cast<bool>(file);
+}
+
+bool FrameTable::saveNpy(const fs::path &filename) const {
+  return io::to_npy<float>(filename, m_data,
+                           {static_cast<size_t>(m_numFrames),
+                            static_cast<size_t>(m_numAlines),
+                            m_fields.size()});
+}
+
+} // namespace uspam::metrics
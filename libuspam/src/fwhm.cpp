@@ -0,0 +1,37 @@
+#include "uspam/fwhm.hpp"
+#include <limits>
+
+namespace uspam::metrics {
+
+FWHMTable::FWHMTable()
+    : FrameTable({{"peakPos", true},
+                  {"peak", false},
+                  {"lower", true},
+                  {"upper", true},
+                  {"width", true}}) {
+  setUnit("samples");
+}
+
+void FWHMTable::setFrame(int frameIdx, std::span<const AlineFWHM> alines,
+                         float mmPerSample) {
+  if (!validFrame(frameIdx)) {
+    return;
+  }
+  setUnit(mmPerSample > 0 ? "mm" : "samples");
+  const float fct = mmPerSample > 0 ? mmPerSample : 1.0F;
+
+  const int n = std::min(static_cast<int>(alines.size()), numAlines());
+  for (int j = 0; j < n; ++j) {
+    const auto &a = alines[j];
+    float *dst = row(frameIdx, j);
+    dst[PeakPos] = a.peakPos * fct;
+    dst[Peak] = a.peak;
+    dst[Lower] = a.lower * fct;
+    dst[Upper] = a.upper * fct;
+    // Unbounded widths are truncated by the A-line, don't report them
+    dst[Width] = a.bounded ? a.width() * fct
+                           : std::numeric_limits<float>::quiet_NaN();
+  }
+}
+
+} // namespace uspam::metrics
@@ -1,27 +1,156 @@
 #include "uspam/imutil.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <numbers>
 #include <opencv2/opencv.hpp>
+#include <tuple>
 
 namespace uspam::imutil {
 
+/*
+Same geometry as the previous resize -> warpPolar(WARP_INVERSE_MAP) ->
+rotate(90 CCW) -> resize chain, composed into one mapping from output pixels
+to (A-line, sample) coordinates.
+*/
+RadialLUT::RadialLUT(const int nAlines, const int nSamples, const int size)
+    : nAlines(nAlines), nSamples(nSamples), size(size),
+      pixels(static_cast<size_t>(size) * size) {
+  assert(nAlines >= 1 && nAlines <= INT16_MAX);
+  assert(nSamples >= 2 && size >= 1);
+  const int r = std::min(nAlines, nSamples);
+  const double grid = 2.0 * r; // Size of the intermediate square image
+  const double scale = grid / size;
+  const double twoPi = 2 * std::numbers::pi;
+
+  for (int v = 0; v < size; ++v) {
+    for (int u = 0; u < size; ++u) {
+      auto &p = pixels[static_cast<size_t>(v) * size + u];
+
+      // Output pixel -> rotated image -> cartesian image (center (r, r))
+      const double xr = (u + 0.5) * scale - 0.5;
+      const double yr = (v + 0.5) * scale - 0.5;
+      const double dx = (grid - 1 - yr) - r;
+      const double dy = xr - r;
+
+      const double rho = std::hypot(dx, dy);
+      if (rho > r) {
+        p = {-1, 0, 0, 0, 0};
+        continue;
+      }
+      double angle = std::atan2(dy, dx);
+      if (angle < 0) {
+        angle += twoPi;
+      }
+
+      // Polar image (grid x grid, angle along rows) -> A-lines x samples
+      const double rowP = angle / twoPi * grid;
+      const double colP = rho / r * grid;
+      const double aline = (rowP + 0.5) * nAlines / grid - 0.5;
+      const double sample = std::clamp(
+          (colP + 0.5) * nSamples / grid - 0.5, 0.0, nSamples - 1.0);
+
+      const auto a = static_cast<int>(std::floor(aline));
+      const auto s0 = std::min(static_cast<int>(sample), nSamples - 2);
+      p.sample = s0;
+      p.ws = static_cast<float>(sample - s0);
+      // Wrap around the circle
+      p.a0 = static_cast<int16_t>((a + nAlines) % nAlines);
+      p.a1 = static_cast<int16_t>((a + 1 + nAlines) % nAlines);
+      p.wa = static_cast<float>(aline - a);
+    }
+  }
+}
+
+std::shared_ptr<const RadialLUT> RadialLUT::get(int nAlines, int nSamples,
+                                                int size) {
+  // A table is 16 bytes per output pixel (~256 MB at 4096x4096), so only the
+  // last few geometries are kept (e.g. full frames and previews of PA and US).
+  constexpr size_t capacity = 4;
+  using Entry =
+      std::pair<std::tuple<int, int, int>, std::shared_ptr<const RadialLUT>>;
+  static std::mutex mtx;
+  static std::list<Entry> cache; // Most recently used first
+
+  std::lock_guard lock(mtx);
+  const auto key = std::tuple(nAlines, nSamples, size);
+  const auto it = std::find_if(cache.begin(), cache.end(),
+                               [&](const Entry &e) { return e.first == key; });
+  if (it != cache.end()) {
+    cache.splice(cache.begin(), cache, it);
+  } else {
+    cache.emplace_front(
+        key, std::make_shared<const RadialLUT>(nAlines, nSamples, size));
+    if (cache.size() > capacity) {
+      cache.pop_back();
+    }
+  }
+  return cache.front().second;
+}
+
+// NOLINTBEGIN(*-magic-numbers)
+OverlayCompositor::OverlayCompositor(const uint8_t threshold, const int ramp,
+                                     const int colormap)
+    : m_threshold(threshold), m_ramp(std::max(ramp, 0)) {
+  // Colors of the 256 PA levels from the OpenCV colormap
+  cv::Mat levels(1, 256, CV_8UC1);
+  for (int v = 0; v < 256; ++v) {
+    levels.at<uint8_t>(0, v) = static_cast<uint8_t>(v);
+  }
+  cv::Mat colors;
+  cv::applyColorMap(levels, colors, colormap);
+
+  for (int v = 0; v < 256; ++v) {
+    int alpha = 0; // 0 - 256
+    if (v > threshold) {
+      alpha = m_ramp == 0 ? 256 : std::min(256, (v - threshold) * 256 / m_ramp);
+    }
+    m_usWeight[v] = static_cast<uint16_t>(256 - alpha);
+
+    const auto &bgr = colors.at<cv::Vec3b>(0, v);
+    for (int k = 0; k < 3; ++k) {
+      m_paBGR[v][k] = static_cast<uint16_t>(bgr[k] * alpha);
+    }
+  }
+}
+// NOLINTEND(*-magic-numbers)
+
 // US and PA are CV_8UC1, PAUS will be CV_8UC3
-void makeOverlay(const cv::Mat &US, const cv::Mat &PA, cv::Mat &PAUS,
-                 const uint8_t PAthresh) {
+void OverlayCompositor::compose(const cv::Mat &US, const cv::Mat &PA,
+                                cv::Mat &PAUS) const {
   assert(US.type() == CV_8UC1);
   assert(PA.type() == CV_8UC1);
+  assert(US.size() == PA.size());
 
-  // Convert US to 3 channel, save to output mat
-  cv::cvtColor(US, PAUS, cv::COLOR_GRAY2BGR);
+  PAUS.create(US.size(), CV_8UC3);
 
-  // Apply colormap to PA, save to intermediate
-  cv::Mat PAclr;
-  cv::applyColorMap(PA, PAclr, cv::COLORMAP_HOT);
+  cv::parallel_for_(cv::Range(0, US.rows), [&](const cv::Range &range) {
+    for (int i = range.start; i < range.end; ++i) {
+      const auto *us = US.ptr<uint8_t>(i);
+      const auto *pa = PA.ptr<uint8_t>(i);
+      auto *dst = PAUS.ptr<uint8_t>(i);
 
-  // Get positive PA mask
-  cv::Mat mask;
-  cv::threshold(PA, mask, PAthresh, 1, cv::THRESH_BINARY);
+      // NOLINTBEGIN(*-pointer-arithmetic,*-constant-array-index)
+      for (int j = 0; j < US.cols; ++j) {
+        const uint8_t v = pa[j];
+        const unsigned u = us[j] * m_usWeight[v];
+        const auto &c = m_paBGR[v];
+        dst[3 * j + 0] = static_cast<uint8_t>((u + c[0]) >> 8);
+        dst[3 * j + 1] = static_cast<uint8_t>((u + c[1]) >> 8);
+        dst[3 * j + 2] = static_cast<uint8_t>((u + c[2]) >> 8);
+      }
+      // NOLINTEND(*-pointer-arithmetic,*-constant-array-index)
+    }
+  });
+}
 
-  // Copy positive PA to output array
-  PAclr.copyTo(PAUS, mask);
+// US and PA are CV_8UC1, PAUS will be CV_8UC3
+void makeOverlay(const cv::Mat &US, const cv::Mat &PA, cv::Mat &PAUS,
+                 const uint8_t PAthresh) {
+  OverlayCompositor(PAthresh).compose(US, PA, PAUS);
 }
 } // namespace uspam::imutil
\ No newline at end of file
@@ -1,8 +1,210 @@
 #include "uspam/io.hpp"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USPAM_HAS_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace uspam::io {
 
 // Instantiate for uint16
 template class BinfileLoader<uint16_t>;
 
-} // namespace uspam::io
\ No newline at end of file
+// NOLINTBEGIN(*-reinterpret-cast,*-pointer-arithmetic,*-magic-numbers)
+
+namespace {
+
+inline uint16_t bswap(uint16_t v) {
+  return static_cast<uint16_t>((v >> 8) | (v << 8));
+}
+
+inline uint32_t bswap(uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_bswap32(v);
+#else
+  return ((v & 0xFF000000U) >> 24) | ((v & 0x00FF0000U) >> 8) |
+         ((v & 0x0000FF00U) << 8) | ((v & 0x000000FFU) << 24);
+#endif
+}
+
+inline uint64_t bswap(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_bswap64(v);
+#else
+  return (static_cast<uint64_t>(bswap(static_cast<uint32_t>(v))) << 32) |
+         bswap(static_cast<uint32_t>(v >> 32));
+#endif
+}
+
+// Scalar byte swap of elements of type U (an unsigned integer of the element
+// size). memcpy keeps it free of alignment and aliasing issues.
+template <typename U> void byteswapScalar(std::byte *data, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    U v{};
+    std::memcpy(&v, data + i * sizeof(U), sizeof(U));
+    v = bswap(v);
+    std::memcpy(data + i * sizeof(U), &v, sizeof(U));
+  }
+}
+
+// Swap N byte elements with SIMD, 16 or 32 bytes at a time, and return the
+// number of elements processed. The rest is left for the scalar tail.
+template <size_t N> size_t byteswapSimd(std::byte *data, size_t n) {
+  const size_t nbytes = n * N;
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  // pshufb mask reversing the bytes of each N byte element. The same mask is
+  // used in both 128 bit lanes.
+  alignas(32) std::array<uint8_t, 32> maskBytes{};
+  for (size_t k = 0; k < maskBytes.size(); ++k) {
+    const size_t lane = k % 16;
+    maskBytes[k] = static_cast<uint8_t>((lane / N) * N + (N - 1 - lane % N));
+  }
+  const __m256i mask =
+      _mm256_load_si256(reinterpret_cast<const __m256i *>(maskBytes.data()));
+  for (; i + 32 <= nbytes; i += 32) {
+    auto *p = reinterpret_cast<__m256i *>(data + i);
+    _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), mask));
+  }
+
+#elif defined(USPAM_HAS_SSE2)
+  // SSE2 has no byte shuffle. Reverse the 16 bit words within each element
+  // with word shuffles, then swap the bytes within each word with shifts.
+  for (; i + 16 <= nbytes; i += 16) {
+    auto *p = reinterpret_cast<__m128i *>(data + i);
+    __m128i v = _mm_loadu_si128(p);
+    if constexpr (N == 4) {
+      v = _mm_shufflelo_epi16(v, 0xB1); // (1, 0, 3, 2)
+      v = _mm_shufflehi_epi16(v, 0xB1);
+    } else if constexpr (N == 8) {
+      v = _mm_shufflelo_epi16(v, 0x1B); // (3, 2, 1, 0)
+      v = _mm_shufflehi_epi16(v, 0x1B);
+    }
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    _mm_storeu_si128(p, v);
+  }
+
+#elif defined(__ARM_NEON)
+  for (; i + 16 <= nbytes; i += 16) {
+    auto *p = reinterpret_cast<uint8_t *>(data + i);
+    const uint8x16_t v = vld1q_u8(p);
+    if constexpr (N == 2) {
+      vst1q_u8(p, vrev16q_u8(v));
+    } else if constexpr (N == 4) {
+      vst1q_u8(p, vrev32q_u8(v));
+    } else {
+      vst1q_u8(p, vrev64q_u8(v));
+    }
+  }
+#endif
+
+  return i / N;
+}
+
+template <typename U> void byteswapN(std::byte *data, size_t n) {
+  const size_t done = byteswapSimd<sizeof(U)>(data, n);
+  byteswapScalar<U>(data + done * sizeof(U), n - done);
+}
+
+} // namespace
+
+void byteswap_inplace(std::byte *data, size_t elemSize, size_t n) {
+  switch (elemSize) {
+  case 1:
+    return;
+  case 2:
+    return byteswapN<uint16_t>(data, n);
+  case 4:
+    return byteswapN<uint32_t>(data, n);
+  case 8:
+    return byteswapN<uint64_t>(data, n);
+  default:
+    for (size_t i = 0; i < n; ++i) {
+      std::reverse(data + i * elemSize, data + (i + 1) * elemSize);
+    }
+  }
+}
+
+namespace {
+
+std::string npy_descr(DType dtype) {
+  const char order = std::endian::native == std::endian::little ? '<' : '>';
+  switch (dtype) {
+  case DType::UInt8:
+    return "|u1";
+  case DType::Int8:
+    return "|i1";
+  case DType::UInt16:
+    return std::string(1, order) + "u2";
+  case DType::Int16:
+    return std::string(1, order) + "i2";
+  case DType::UInt32:
+    return std::string(1, order) + "u4";
+  case DType::Int32:
+    return std::string(1, order) + "i4";
+  case DType::Float32:
+    return std::string(1, order) + "f4";
+  case DType::Float64:
+  default:
+    return std::string(1, order) + "f8";
+  }
+}
+
+} // namespace
+
+bool to_npy(const fs::path &filename, const std::byte *data, DType dtype,
+            std::span<const size_t> shape) {
+  std::string header = "{'descr': '" + npy_descr(dtype) +
+                       "', 'fortran_order': False, 'shape': (";
+  size_t count = 1;
+  for (const auto dim : shape) {
+    header += std::to_string(dim) + ", ";
+    count *= dim;
+  }
+  if (shape.size() > 1) {
+    header.resize(header.size() - 1); // (3, 4) but (3,)
+    header.back() = ')';
+  } else {
+    header += ")";
+  }
+  header += ", }";
+
+  // Magic (6) + version (2) + header length (2) + header, padded with spaces
+  // and terminated by '\n' to a multiple of 64 bytes
+  constexpr size_t preamble = 10;
+  constexpr size_t align = 64;
+  const size_t total =
+      (preamble + header.size() + 1 + align - 1) / align * align;
+  header.append(total - preamble - header.size() - 1, ' ');
+  header += '\n';
+
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "[to_npy] Failed to open " << filename << "\n";
+    return false;
+  }
+
+  const auto headerLen = static_cast<uint16_t>(header.size());
+  const std::array<char, preamble> pre{
+      '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+      static_cast<char>(headerLen & 0xFF), static_cast<char>(headerLen >> 8)};
+  file.write(pre.data(), pre.size());
+  file.write(header.data(), static_cast<std::streamsize>(header.size()));
+  file.write(reinterpret_cast<const char *>(data),
+             static_cast<std::streamsize>(count * dtype_size(dtype)));
+
+  if (!file) {
+    std::cerr << "[to_npy] Failed to write " << filename << "\n";
+    return false;
+  }
+  return true;
+}
+
+// NOLINTEND(*-reinterpret-cast,*-pointer-arithmetic,*-magic-numbers)
+
+} // namespace uspam::io
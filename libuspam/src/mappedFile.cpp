@@ -0,0 +1,230 @@
+#include "uspam/mappedFile.hpp"
+#include <utility>
+
+#if defined(_WIN32) || defined(_WIN64)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace uspam::io {
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { swap(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    swap(other);
+  }
+  return *this;
+}
+
+void MappedFile::swap(MappedFile &other) noexcept {
+  std::swap(m_data, other.m_data);
+  std::swap(m_size, other.m_size);
+  std::swap(m_writable, other.m_writable);
+#if defined(_WIN32) || defined(_WIN64)
+  std::swap(m_file, other.m_file);
+  std::swap(m_mapping, other.m_mapping);
+#else
+  std::swap(m_fd, other.m_fd);
+#endif
+}
+
+// NOLINTBEGIN(*-reinterpret-cast,*-pro-type-cstyle-cast,*-signed-bitwise)
+
+#if defined(_WIN32) || defined(_WIN64)
+
+bool MappedFile::open(const fs::path &filename) {
+  close();
+
+  HANDLE file = CreateFileW(filename.wstring().c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER fsize;
+  if (!GetFileSizeEx(file, &fsize) || fsize.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file = file;
+  m_mapping = mapping;
+  m_data = data;
+  m_size = static_cast<size_t>(fsize.QuadPart);
+  return true;
+}
+
+bool MappedFile::openWritable(const fs::path &filename, size_t size) {
+  close();
+  if (size == 0) {
+    return false;
+  }
+
+  HANDLE file =
+      CreateFileW(filename.wstring().c_str(), GENERIC_READ | GENERIC_WRITE,
+                  FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                  nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER fsize;
+  fsize.QuadPart = static_cast<LONGLONG>(size);
+  if (!SetFilePointerEx(file, fsize, nullptr, FILE_BEGIN) ||
+      !SetEndOfFile(file)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void *data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file = file;
+  m_mapping = mapping;
+  m_data = data;
+  m_size = size;
+  m_writable = true;
+  return true;
+}
+
+bool MappedFile::flush() {
+  return m_writable && m_data != nullptr && FlushViewOfFile(m_data, 0) != 0;
+}
+
+void MappedFile::close() {
+  if (m_data != nullptr) {
+    UnmapViewOfFile(m_data);
+    m_data = nullptr;
+  }
+  if (m_mapping != nullptr) {
+    CloseHandle(m_mapping);
+    m_mapping = nullptr;
+  }
+  if (m_file != nullptr) {
+    CloseHandle(m_file);
+    m_file = nullptr;
+  }
+  m_size = 0;
+  m_writable = false;
+}
+
+#else
+
+bool MappedFile::open(const fs::path &filename) {
+  close();
+
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+
+  const auto size = static_cast<size_t>(st.st_size);
+  void *data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    ::close(fd);
+    return false;
+  }
+
+  m_fd = fd;
+  m_data = data;
+  m_size = size;
+  return true;
+}
+
+bool MappedFile::openWritable(const fs::path &filename, size_t size) {
+  close();
+  if (size == 0) {
+    return false;
+  }
+
+  const int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void *data =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    ::close(fd);
+    return false;
+  }
+
+  m_fd = fd;
+  m_data = data;
+  m_size = size;
+  m_writable = true;
+  return true;
+}
+
+bool MappedFile::flush() {
+  return m_writable && m_data != nullptr &&
+         ::msync(m_data, m_size, MS_ASYNC) == 0;
+}
+
+void MappedFile::close() {
+  if (m_data != nullptr) {
+    ::munmap(m_data, m_size);
+    m_data = nullptr;
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+  m_size = 0;
+  m_writable = false;
+}
+
+#endif
+
+// NOLINTEND(*-reinterpret-cast,*-pro-type-cstyle-cast,*-signed-bitwise)
+
+} // namespace uspam::io
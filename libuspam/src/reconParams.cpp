@@ -1,10 +1,57 @@
 #include "uspam/reconParams.hpp"
 #include "uspam/json.hpp"
+#include "uspam/signal.hpp"
 #include <rapidjson/document.h>
 #include <rapidjson/rapidjson.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace uspam::recon {
 
+namespace {
+
+template <typename E, size_t N>
+using EnumNames = std::array<std::pair<E, const char *>, N>;
+
+constexpr EnumNames<TemporalFilterType, 4> TEMPORAL_FILTER_NAMES{
+    {{TemporalFilterType::None, "none"},
+     {TemporalFilterType::Box, "box"},
+     {TemporalFilterType::Exponential, "exponential"},
+     {TemporalFilterType::Median3, "median3"}}};
+
+constexpr EnumNames<SpeckleFilterType, 4> SPECKLE_FILTER_NAMES{
+    {{SpeckleFilterType::None, "none"},
+     {SpeckleFilterType::Median, "median"},
+     {SpeckleFilterType::Bilateral, "bilateral"},
+     {SpeckleFilterType::Diffusion, "diffusion"}}};
+
+// The first entry is the default
+template <typename E, size_t N>
+const char *enumName(const EnumNames<E, N> &names, E value) {
+  for (const auto &[v, name] : names) {
+    if (v == value) {
+      return name;
+    }
+  }
+  return names.front().second;
+}
+
+template <typename E, size_t N>
+E enumFromName(const EnumNames<E, N> &names, std::string_view name) {
+  for (const auto &[v, n] : names) {
+    if (name == n) {
+      return v;
+    }
+  }
+  return names.front().first;
+}
+
+} // namespace
+
 rapidjson::Value
 ReconParams::serialize(rapidjson::Document::AllocatorType &allocator) const {
   using json::serializeArray;
@@ -16,14 +63,85 @@ ReconParams::serialize(rapidjson::Document::AllocatorType &allocator) const {
   obj.AddMember("noiseFloor", noiseFloor_mV, allocator);
   obj.AddMember("desiredDynamicRange", desiredDynamicRange, allocator);
   obj.AddMember("rotateOffset", rotateOffset, allocator);
+  obj.AddMember("decimateEnvelope", decimateEnvelope, allocator);
+  obj.AddMember("mmPerSample", mmPerSample, allocator);
+  obj.AddMember("tgcSlope", tgcSlope_dBmm, allocator);
+  obj.AddMember("tgcDepth", serializeArray(tgcDepth_mm, allocator), allocator);
+  obj.AddMember("tgcGain", serializeArray(tgcGain_dB, allocator), allocator);
+  obj.AddMember("autoGain", autoGain, allocator);
+  obj.AddMember("autoGainNoisePercentile", autoGainNoisePercentile, allocator);
+  obj.AddMember("autoGainPeakPercentile", autoGainPeakPercentile, allocator);
+  obj.AddMember("autoGainSmoothing", autoGainSmoothing, allocator);
+  obj.AddMember("enfaceDepthBegin", enfaceDepthBegin_mm, allocator);
+  obj.AddMember("enfaceDepthEnd", enfaceDepthEnd_mm, allocator);
+  obj.AddMember(
+      "temporalFilter",
+      rapidjson::StringRef(enumName(TEMPORAL_FILTER_NAMES, temporalFilter)),
+      allocator);
+  obj.AddMember("temporalFrames", temporalFrames, allocator);
+  obj.AddMember("temporalPersistence", temporalPersistence, allocator);
+  obj.AddMember(
+      "speckleFilter",
+      rapidjson::StringRef(enumName(SPECKLE_FILTER_NAMES, speckleFilter)),
+      allocator);
+  obj.AddMember("speckleRadius", speckleRadius, allocator);
+  obj.AddMember("speckleStrength", speckleStrength, allocator);
+  obj.AddMember("envelopeMethod",
+                rapidjson::StringRef(envelopeMethod == EnvelopeMethod::IQ
+                                         ? "iq"
+                                         : "hilbert"),
+                allocator);
 
   return obj;
 }
 
-ReconParams ReconParams::deserialize(const rapidjson::Value &obj) {
-  using json::deserializeArray;
+bool ReconParams::hasTGC() const {
+  return tgcSlope_dBmm != 0 || (!tgcGain_dB.empty() &&
+                                tgcDepth_mm.size() == tgcGain_dB.size());
+}
+
+std::vector<double> ReconParams::tgcTable(int n, double mmPerRow) const {
+  std::vector<double> table(n, 0.0);
+  if (n <= 0) {
+    return table;
+  }
+
+  std::vector<double> depth(n);
+  for (int i = 0; i < n; ++i) {
+    depth[i] = i * mmPerRow;
+  }
+
+  if (!tgcGain_dB.empty() && tgcDepth_mm.size() == tgcGain_dB.size()) {
+    if (tgcGain_dB.size() == 1) {
+      std::fill(table.begin(), table.end(), tgcGain_dB.front());
+    } else {
+      signal::interp(depth, tgcDepth_mm, tgcGain_dB, table);
+    }
+  }
+
+  for (int i = 0; i < n; ++i) {
+    table[i] += tgcSlope_dBmm * depth[i];
+  }
+  return table;
+}
+
+std::pair<int, int> ReconParams::enfaceRows(double mmPerRow) const {
+  if (mmPerRow <= 0) {
+    return {0, -1};
+  }
+  // Nearest row boundaries
+  const auto begin = static_cast<int>(
+      std::max(0L, std::lround(enfaceDepthBegin_mm / mmPerRow)));
+  if (enfaceDepthEnd_mm <= enfaceDepthBegin_mm) {
+    return {begin, -1};
+  }
+  const auto end = static_cast<int>(std::lround(enfaceDepthEnd_mm / mmPerRow));
+  return {begin, std::max(end, begin + 1)};
+}
 
-  ReconParams params;
+ReconParams ReconParams::deserialize(const rapidjson::Value &obj,
+                                     ReconParams params) {
+  using json::deserializeArray;
 
   if (const auto it = obj.FindMember("filterFreq"); it != obj.MemberEnd()) {
     assert(it->value.IsArray());
@@ -37,6 +155,79 @@ ReconParams ReconParams::deserialize(const rapidjson::Value &obj) {
   params.rotateOffset = obj["rotateOffset"].GetInt();
   params.noiseFloor_mV = obj["noiseFloor"].GetFloat();
   params.desiredDynamicRange = obj["desiredDynamicRange"].GetFloat();
+
+  // Optional, not present in older param files
+  if (const auto it = obj.FindMember("decimateEnvelope");
+      it != obj.MemberEnd()) {
+    params.decimateEnvelope = it->value.GetBool();
+  }
+  if (const auto it = obj.FindMember("mmPerSample"); it != obj.MemberEnd()) {
+    params.mmPerSample = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("tgcSlope"); it != obj.MemberEnd()) {
+    params.tgcSlope_dBmm = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("tgcDepth"); it != obj.MemberEnd()) {
+    deserializeArray(it->value, params.tgcDepth_mm);
+  }
+  if (const auto it = obj.FindMember("tgcGain"); it != obj.MemberEnd()) {
+    deserializeArray(it->value, params.tgcGain_dB);
+  }
+  if (const auto it = obj.FindMember("autoGain"); it != obj.MemberEnd()) {
+    params.autoGain = it->value.GetBool();
+  }
+  if (const auto it = obj.FindMember("autoGainNoisePercentile");
+      it != obj.MemberEnd()) {
+    params.autoGainNoisePercentile = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("autoGainPeakPercentile");
+      it != obj.MemberEnd()) {
+    params.autoGainPeakPercentile = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("autoGainSmoothing");
+      it != obj.MemberEnd()) {
+    params.autoGainSmoothing = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("enfaceDepthBegin");
+      it != obj.MemberEnd()) {
+    params.enfaceDepthBegin_mm = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("enfaceDepthEnd");
+      it != obj.MemberEnd()) {
+    params.enfaceDepthEnd_mm = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("temporalFilter");
+      it != obj.MemberEnd() && it->value.IsString()) {
+    params.temporalFilter =
+        enumFromName(TEMPORAL_FILTER_NAMES, it->value.GetString());
+  }
+  if (const auto it = obj.FindMember("temporalFrames");
+      it != obj.MemberEnd()) {
+    params.temporalFrames = it->value.GetInt();
+  }
+  if (const auto it = obj.FindMember("temporalPersistence");
+      it != obj.MemberEnd()) {
+    params.temporalPersistence = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("speckleFilter");
+      it != obj.MemberEnd() && it->value.IsString()) {
+    params.speckleFilter =
+        enumFromName(SPECKLE_FILTER_NAMES, it->value.GetString());
+  }
+  if (const auto it = obj.FindMember("speckleRadius");
+      it != obj.MemberEnd()) {
+    params.speckleRadius = it->value.GetInt();
+  }
+  if (const auto it = obj.FindMember("speckleStrength");
+      it != obj.MemberEnd()) {
+    params.speckleStrength = it->value.GetFloat();
+  }
+  if (const auto it = obj.FindMember("envelopeMethod");
+      it != obj.MemberEnd() && it->value.IsString()) {
+    params.envelopeMethod = std::string_view(it->value.GetString()) == "iq"
+                                ? EnvelopeMethod::IQ
+                                : EnvelopeMethod::Hilbert;
+  }
   return params;
 }
 
@@ -47,6 +238,8 @@ rapidjson::Document ReconParams2::serializeToDoc() const {
 
   doc.AddMember("PA", PA.serialize(allocator), allocator);
   doc.AddMember("US", US.serialize(allocator), allocator);
+  doc.AddMember("overlayThreshold", overlayThreshold, allocator);
+  doc.AddMember("overlayRamp", overlayRamp, allocator);
 
   return doc;
 }
@@ -59,11 +252,22 @@ bool ReconParams2::deserialize(const rapidjson::Document &doc) {
   auto &params = *this;
 
   if (const auto it = doc.FindMember("PA"); it != doc.MemberEnd()) {
-    params.PA = ReconParams::deserialize(it->value);
+    params.PA = ReconParams::deserialize(it->value, params.PA);
   }
 
   if (const auto it = doc.FindMember("US"); it != doc.MemberEnd()) {
-    params.US = ReconParams::deserialize(it->value);
+    params.US = ReconParams::deserialize(it->value, params.US);
+  }
+
+  // PA levels (0-255)
+  if (const auto it = doc.FindMember("overlayThreshold");
+      it != doc.MemberEnd() && it->value.IsInt()) {
+    params.overlayThreshold = std::clamp(it->value.GetInt(), 0, 255);
+  }
+
+  if (const auto it = doc.FindMember("overlayRamp");
+      it != doc.MemberEnd() && it->value.IsInt()) {
+    params.overlayRamp = std::clamp(it->value.GetInt(), 0, 255);
   }
 
   return true;
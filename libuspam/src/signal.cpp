@@ -1,3 +1,4 @@
+#include <array>
 #include <cmath>
 #include <numbers>
 #include <stdexcept>
@@ -117,4 +118,21 @@ auto firwin2(int numtaps, const std::span<const double> freq,
   return out;
 }
 
+auto decimation_kernel(const int factor) -> arma::vec {
+  if (factor < 2) {
+    throw std::invalid_argument("decimation factor must be >= 2.");
+  }
+
+  // NOLINTBEGIN(*-magic-numbers)
+  const int numtaps = 8 * factor + 1;
+  const double cutoff = 1.0 / factor;
+  const std::array freq{0.0, 0.8 * cutoff, cutoff, 1.0};
+  const std::array gain{1.0, 1.0, 0.0, 0.0};
+  // NOLINTEND(*-magic-numbers)
+
+  arma::vec kernel = firwin2(numtaps, freq, gain);
+  kernel /= arma::accu(kernel);
+  return kernel;
+}
+
 } // namespace uspam::signal
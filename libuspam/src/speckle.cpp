@@ -0,0 +1,149 @@
+#include "uspam/speckle.hpp"
+#include <algorithm>
+#include <cstring>
+#include <opencv2/opencv.hpp>
+
+namespace uspam::recon {
+
+namespace {
+
+constexpr int MAX_RADIUS = 5;
+
+// A-lines filtered per tile (a tile of 1000 samples fits in L2)
+constexpr int TILE_ALINES = 64;
+
+// rfLog as a cv::Mat with one row per A-line (arma is column major)
+cv::Mat alineRows(arma::Mat<uint8_t> &rfLog) {
+  return {static_cast<int>(rfLog.n_cols), static_cast<int>(rfLog.n_rows),
+          CV_8UC1, rfLog.memptr()};
+}
+
+// Rows [begin - halo, end + halo) of `src`, wrapping around (angle), with
+// `halo` columns of the edge sample on each side (depth)
+void paddedTile(const cv::Mat &src, int begin, int end, int halo,
+                cv::Mat &tile) {
+  const int n = src.rows;
+  const auto cols = static_cast<size_t>(src.cols);
+  const auto pad = static_cast<size_t>(halo);
+  tile.create(end - begin + 2 * halo, src.cols + 2 * halo, CV_8UC1);
+  for (int k = 0; k < tile.rows; ++k) {
+    const int row = ((begin - halo + k) % n + n) % n;
+    const uint8_t *s = src.ptr(row);
+    uint8_t *d = tile.ptr(k);
+    std::memset(d, s[0], pad);
+    std::memcpy(d + pad, s, cols);
+    std::memset(d + pad + cols, s[cols - 1], pad);
+  }
+}
+
+// Run `kernel(tile, out)` on padded tiles of A-lines in parallel and write
+// the centre of each output tile to `dst`
+template <typename Kernel>
+void filterTiles(const cv::Mat &src, cv::Mat &dst, int halo,
+                 const Kernel &kernel) {
+  const int numTiles = (src.rows + TILE_ALINES - 1) / TILE_ALINES;
+  cv::parallel_for_(cv::Range(0, numTiles), [&](const cv::Range &range) {
+    cv::Mat tile;
+    cv::Mat out;
+    for (int t = range.start; t < range.end; ++t) {
+      const int begin = t * TILE_ALINES;
+      const int end = std::min(begin + TILE_ALINES, src.rows);
+      paddedTile(src, begin, end, halo, tile);
+      kernel(tile, out);
+      out(cv::Rect(halo, halo, src.cols, end - begin))
+          .copyTo(dst.rowRange(begin, end));
+    }
+  });
+}
+
+// Perona-Malik diffusion with conductance 1 / (1 + (d / kappa)^2), 4
+// neighbours: depth (edge repeated) and angle (wrapped)
+void diffuse(cv::Mat &img, int iterations, float kappa) {
+  cv::Mat cur;
+  img.convertTo(cur, CV_32F);
+  cv::Mat next(cur.size(), CV_32F);
+
+  const int n = cur.rows;
+  const int cols = cur.cols;
+  const float invK2 = 1.0F / (kappa * kappa);
+  constexpr float lambda = 0.25F; // Largest stable step for 4 neighbours
+
+  for (int it = 0; it < iterations; ++it) {
+    cv::parallel_for_(cv::Range(0, n), [&](const cv::Range &range) {
+      // NOLINTBEGIN(*-pointer-arithmetic)
+      for (int j = range.start; j < range.end; ++j) {
+        const float *prev = cur.ptr<float>((j + n - 1) % n);
+        const float *mid = cur.ptr<float>(j);
+        const float *nxt = cur.ptr<float>((j + 1) % n);
+        float *out = next.ptr<float>(j);
+
+        const auto flux = [invK2](float d) {
+          return d / (1.0F + d * d * invK2);
+        };
+        const auto edge = [&](int i) {
+          const float v = mid[i];
+          const float shallow = mid[std::max(i - 1, 0)];
+          const float deep = mid[std::min(i + 1, cols - 1)];
+          out[i] = v + lambda * (flux(shallow - v) + flux(deep - v) +
+                                 flux(prev[i] - v) + flux(nxt[i] - v));
+        };
+
+        edge(0);
+        // Branch free interior, vectorized by the compiler
+        for (int i = 1; i < cols - 1; ++i) {
+          const float v = mid[i];
+          out[i] = v + lambda * (flux(mid[i - 1] - v) + flux(mid[i + 1] - v) +
+                                 flux(prev[i] - v) + flux(nxt[i] - v));
+        }
+        if (cols > 1) {
+          edge(cols - 1);
+        }
+      }
+      // NOLINTEND(*-pointer-arithmetic)
+    });
+    cv::swap(cur, next);
+  }
+
+  cur.convertTo(img, CV_8U);
+}
+
+} // namespace
+
+void reduceSpeckle(const ReconParams &params, arma::Mat<uint8_t> &rfLog) {
+  if (params.speckleFilter == SpeckleFilterType::None || rfLog.empty()) {
+    return;
+  }
+
+  const int r = std::clamp(params.speckleRadius, 1, MAX_RADIUS);
+  const float strength = std::max(params.speckleStrength, 1.0F);
+
+  cv::Mat img = alineRows(rfLog);
+  cv::Mat out(img.size(), CV_8UC1);
+
+  switch (params.speckleFilter) {
+  case SpeckleFilterType::Median:
+    filterTiles(img, out, r, [&](const cv::Mat &tile, cv::Mat &dst) {
+      cv::medianBlur(tile, dst, 2 * r + 1);
+    });
+    break;
+
+  case SpeckleFilterType::Bilateral:
+    filterTiles(img, out, r, [&](const cv::Mat &tile, cv::Mat &dst) {
+      cv::bilateralFilter(tile, dst, 2 * r + 1, strength, r);
+    });
+    break;
+
+  case SpeckleFilterType::Diffusion:
+    diffuse(img, 2 * r * r, strength);
+    return;
+
+  case SpeckleFilterType::None:
+  default:
+    return;
+  }
+
+  // Same size and type: copies into rfLog's memory
+  out.copyTo(img);
+}
+
+} // namespace uspam::recon
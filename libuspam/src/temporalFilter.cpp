@@ -0,0 +1,148 @@
+#include "uspam/temporalFilter.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace uspam::recon {
+
+namespace {
+
+// rfLog as a cv::Mat with one row per A-line (arma is column major)
+cv::Mat alineRows(arma::Mat<uint8_t> &rfLog) {
+  return {static_cast<int>(rfLog.n_cols), static_cast<int>(rfLog.n_rows),
+          CV_8UC1, rfLog.memptr()};
+}
+
+// dst row j = src row perm.src(j)
+void toDisplayOrder(const cv::Mat &src, cv::Mat &dst,
+                    const imutil::ColumnPermutation &perm) {
+  const int n = src.rows;
+  const auto rowBytes = static_cast<size_t>(src.cols);
+  for (int j = 0; j < n; ++j) {
+    std::memcpy(dst.ptr(j), src.ptr(perm.src(j, n)), rowBytes);
+  }
+}
+
+// dst row perm.src(j) = src row j
+void toAcquisitionOrder(const cv::Mat &src, cv::Mat &dst,
+                        const imutil::ColumnPermutation &perm) {
+  const int n = src.rows;
+  const auto rowBytes = static_cast<size_t>(src.cols);
+  for (int j = 0; j < n; ++j) {
+    std::memcpy(dst.ptr(perm.src(j, n)), src.ptr(j), rowBytes);
+  }
+}
+
+} // namespace
+
+void TemporalFilter::reset() {
+  m_ring.clear();
+  m_head = -1;
+  m_count = 0;
+  m_lastFrame = -1;
+  m_state.release();
+  m_prevState.release();
+}
+
+void TemporalFilter::apply(const ReconParams &params, int frameIdx,
+                           arma::Mat<uint8_t> &rfLog,
+                           const imutil::ColumnPermutation &perm) {
+  if (params.temporalFilter == TemporalFilterType::None || rfLog.empty()) {
+    if (!m_ring.empty()) {
+      reset();
+    }
+    m_type = TemporalFilterType::None;
+    return;
+  }
+
+  // Frames kept in the ring
+  const int capacity = [&] {
+    switch (params.temporalFilter) {
+    case TemporalFilterType::Box:
+      return std::clamp(params.temporalFrames, 1, MAX_FRAMES);
+    case TemporalFilterType::Median3:
+      return 3;
+    default:
+      return 1;
+    }
+  }();
+
+  cv::Mat acq = alineRows(rfLog);
+  bool sameFrame = frameIdx == m_lastFrame && m_count > 0;
+  if (params.temporalFilter != m_type || acq.size() != m_size ||
+      capacity != static_cast<int>(m_ring.size()) ||
+      (!sameFrame && frameIdx != m_lastFrame + 1)) {
+    reset();
+    sameFrame = false;
+    m_ring.resize(capacity);
+  }
+  m_type = params.temporalFilter;
+  m_size = acq.size();
+
+  // Newest frame in display order. A repeated frame replaces its slot.
+  if (!sameFrame) {
+    m_head = (m_head + 1) % capacity;
+    m_count = std::min(m_count + 1, capacity);
+  }
+  m_lastFrame = frameIdx;
+  // A new buffer: the slot may be shared with a copy of this filter
+  cv::Mat &cur = frame(0);
+  cur = cv::Mat(m_size, CV_8UC1);
+  toDisplayOrder(acq, cur, perm);
+
+  switch (m_type) {
+  case TemporalFilterType::Box: {
+    cur.convertTo(m_acc, CV_16U);
+    for (int age = 1; age < m_count; ++age) {
+      cv::add(m_acc, frame(age), m_acc, cv::noArray(), CV_16U);
+    }
+    m_acc.convertTo(m_out, CV_8U, 1.0 / m_count);
+    break;
+  }
+
+  case TemporalFilterType::Exponential: {
+    // Start from the state before this frame, also if it is applied again
+    if (!sameFrame) {
+      m_prevState = m_state;
+    }
+
+    // The new state goes to a new buffer, the previous one is kept as is
+    cv::Mat state;
+    if (m_prevState.empty()) {
+      cur.convertTo(state, CV_32F);
+    } else {
+      const double persistence =
+          std::clamp(static_cast<double>(params.temporalPersistence), 0.0,
+                     1.0);
+      m_prevState.copyTo(state);
+      cv::accumulateWeighted(cur, state, 1.0 - persistence);
+    }
+    m_state = state;
+    m_state.convertTo(m_out, CV_8U);
+    break;
+  }
+
+  case TemporalFilterType::Median3: {
+    if (m_count < 3) {
+      cur.copyTo(m_out);
+      break;
+    }
+    // median(a, b, c) = max(min(a, b), min(max(a, b), c))
+    const cv::Mat &a = frame(0);
+    const cv::Mat &b = frame(1);
+    const cv::Mat &c = frame(2);
+    cv::min(a, b, m_acc);
+    cv::max(a, b, m_out);
+    cv::min(m_out, c, m_out);
+    cv::max(m_acc, m_out, m_out);
+    break;
+  }
+
+  case TemporalFilterType::None:
+  default:
+    return;
+  }
+
+  toAcquisitionOrder(m_out, acq, perm);
+}
+
+} // namespace uspam::recon
@@ -0,0 +1,170 @@
+#include "uspam/videoSink.hpp"
+#include <vector>
+
+namespace uspam::io {
+
+int VideoSinkParams::fourcc() const {
+  switch (codec) {
+  case VideoCodec::FFV1:
+    return cv::VideoWriter::fourcc('F', 'F', 'V', '1');
+  case VideoCodec::MJPG:
+  default:
+    return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+  }
+}
+
+bool VideoSink::open(const fs::path &filename, const VideoSinkParams &params) {
+  std::lock_guard lock(m_mtx);
+  if (m_open) {
+    return false;
+  }
+
+  m_filename = filename;
+  m_params = params;
+  m_queue.clear();
+  m_nextIdx = -1;
+  m_closing = false;
+  m_framesWritten = 0;
+  m_error.clear();
+  m_frameSize = {};
+
+  m_open = true;
+  m_thread = std::thread(&VideoSink::run, this);
+  return true;
+}
+
+void VideoSink::close() {
+  {
+    std::lock_guard lock(m_mtx);
+    if (!m_open) {
+      return;
+    }
+    m_closing = true;
+  }
+  m_cvConsumer.notify_all();
+  m_cvProducer.notify_all();
+
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+
+  std::lock_guard lock(m_mtx);
+  m_open = false;
+}
+
+bool VideoSink::isOpen() const {
+  std::lock_guard lock(m_mtx);
+  return m_open && !m_closing;
+}
+
+void VideoSink::push(int frameIdx, const cv::Mat &frame) {
+  if (frame.empty()) [[unlikely]] {
+    return;
+  }
+
+  {
+    std::unique_lock lock(m_mtx);
+    if (!m_open || m_closing) {
+      return;
+    }
+
+    // This frame index was already written (e.g. a replay). Drop it.
+    if (m_nextIdx >= 0 && frameIdx < m_nextIdx) {
+      return;
+    }
+
+    m_cvProducer.wait(lock, [this] {
+      return m_closing ||
+             static_cast<int>(m_queue.size()) < m_params.maxQueued;
+    });
+    if (m_closing) {
+      return;
+    }
+
+    m_queue.insert_or_assign(frameIdx, frame);
+  }
+  m_cvConsumer.notify_one();
+}
+
+int VideoSink::framesWritten() const {
+  std::lock_guard lock(m_mtx);
+  return m_framesWritten;
+}
+
+std::string VideoSink::error() const {
+  std::lock_guard lock(m_mtx);
+  return m_error;
+}
+
+void VideoSink::run() {
+  for (;;) {
+    cv::Mat frame;
+    {
+      std::unique_lock lock(m_mtx);
+
+      // Write the next frame in sequence as soon as it arrives. If there's a
+      // gap in the sequence (or the first index isn't known yet), wait until
+      // the queue is full (or we're closing) before skipping ahead to the
+      // lowest queued index.
+      const auto ready = [this] {
+        if (m_queue.empty()) {
+          return m_closing;
+        }
+        return (m_nextIdx >= 0 && m_queue.begin()->first == m_nextIdx) ||
+               static_cast<int>(m_queue.size()) >= m_params.maxQueued ||
+               m_closing;
+      };
+      m_cvConsumer.wait(lock, ready);
+
+      if (m_queue.empty()) {
+        // Closing and drained
+        break;
+      }
+
+      auto node = m_queue.extract(m_queue.begin());
+      m_nextIdx = node.key() + 1;
+      frame = std::move(node.mapped());
+    }
+    m_cvProducer.notify_one();
+
+    const bool ok = writeOne(frame);
+
+    std::lock_guard lock(m_mtx);
+    if (ok) {
+      ++m_framesWritten;
+    }
+  }
+
+  m_writer.release();
+}
+
+bool VideoSink::writeOne(const cv::Mat &frame) {
+  if (!m_writer.isOpened()) {
+    m_frameSize = frame.size();
+    const bool isColor = frame.channels() > 1;
+
+    const std::vector<int> writerParams{
+        cv::VIDEOWRITER_PROP_QUALITY, m_params.quality,
+        cv::VIDEOWRITER_PROP_IS_COLOR, static_cast<int>(isColor)};
+
+    if (!m_writer.open(m_filename.string(), cv::CAP_ANY, m_params.fourcc(),
+                       m_params.fps, m_frameSize, writerParams)) {
+      std::lock_guard lock(m_mtx);
+      m_error = "[VideoSink] Failed to open video writer for " +
+                m_filename.generic_string();
+      return false;
+    }
+  }
+
+  if (frame.size() != m_frameSize) [[unlikely]] {
+    // cv::VideoWriter requires a constant frame size
+    cv::Mat resized;
+    cv::resize(frame, resized, m_frameSize);
+    m_writer.write(resized);
+  } else {
+    m_writer.write(frame);
+  }
+  return true;
+}
+
+} // namespace uspam::io
@@ -0,0 +1,171 @@
+#include "uspam/volumeStore.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace uspam::io {
+
+// NOLINTBEGIN(*-reinterpret-cast,*-pointer-arithmetic)
+
+namespace {
+
+constexpr size_t PAGE_SIZE = 4096;
+
+size_t alignUp(size_t n, size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+bool VolumeStore::open(const fs::path &filename, const Shape &shape) {
+  std::unique_lock lock(m_mtx);
+  m_file.close();
+  m_shape = {};
+
+  if (shape.numFrames <= 0 || shape.numAlines <= 0 ||
+      shape.numSamples[PA] <= 0 || shape.numSamples[US] <= 0) {
+    return false;
+  }
+
+  const size_t flagsSize = static_cast<size_t>(shape.numFrames) * NumChannels;
+  const size_t sizePA = static_cast<size_t>(shape.numFrames) *
+                        shape.numAlines * shape.numSamples[PA];
+  const size_t sizeUS = static_cast<size_t>(shape.numFrames) *
+                        shape.numAlines * shape.numSamples[US];
+  const size_t offsetPA =
+      alignUp(sizeof(VolumeStoreHeader) + flagsSize, PAGE_SIZE);
+  const size_t offsetUS = alignUp(offsetPA + sizePA, PAGE_SIZE);
+  const size_t fileSize = offsetUS + sizeUS;
+
+  if (!m_file.openWritable(filename, fileSize)) {
+    std::cerr << "[VolumeStore] Failed to map " << filename << "\n";
+    return false;
+  }
+
+  VolumeStoreHeader header;
+  header.numFrames = shape.numFrames;
+  header.numAlines = shape.numAlines;
+  header.numSamples = {static_cast<uint32_t>(shape.numSamples[PA]),
+                       static_cast<uint32_t>(shape.numSamples[US])};
+
+  // Start with no frames: those of an earlier session may have been made with
+  // other parameters. Stale samples are ignored since the frames aren't
+  // flagged as stored.
+  auto *data = m_file.mutableData();
+  std::memcpy(data, &header, sizeof(header));
+  std::memset(data + sizeof(header), 0, flagsSize);
+
+  m_path = filename;
+  m_shape = shape;
+  m_offset = {offsetPA, offsetUS};
+  return true;
+}
+
+void VolumeStore::close() {
+  std::unique_lock lock(m_mtx);
+  m_file.close();
+  m_shape = {};
+}
+
+bool VolumeStore::isOpen() const {
+  std::shared_lock lock(m_mtx);
+  return m_file.isOpen();
+}
+
+auto VolumeStore::shape() const -> Shape {
+  std::shared_lock lock(m_mtx);
+  return m_shape;
+}
+
+fs::path VolumeStore::path() const {
+  std::shared_lock lock(m_mtx);
+  return m_path;
+}
+
+uint8_t *VolumeStore::flags(Channel ch) {
+  return reinterpret_cast<uint8_t *>(m_file.mutableData() +
+                                     sizeof(VolumeStoreHeader)) +
+         static_cast<size_t>(ch) * m_shape.numFrames;
+}
+
+const uint8_t *VolumeStore::flags(Channel ch) const {
+  return reinterpret_cast<const uint8_t *>(m_file.data() +
+                                           sizeof(VolumeStoreHeader)) +
+         static_cast<size_t>(ch) * m_shape.numFrames;
+}
+
+const uint8_t *VolumeStore::frameData(Channel ch, int frame) const {
+  return reinterpret_cast<const uint8_t *>(m_file.data() + m_offset[ch]) +
+         static_cast<size_t>(frame) * frameSize(ch);
+}
+
+uint8_t *VolumeStore::frameData(Channel ch, int frame) {
+  return reinterpret_cast<uint8_t *>(m_file.mutableData() + m_offset[ch]) +
+         static_cast<size_t>(frame) * frameSize(ch);
+}
+
+bool VolumeStore::put(Channel ch, int frame, const arma::Mat<uint8_t> &rfLog,
+                      const imutil::ColumnPermutation &perm) {
+  std::unique_lock lock(m_mtx);
+  if (!m_file.isOpen() || frame < 0 || frame >= m_shape.numFrames ||
+      static_cast<int>(rfLog.n_cols) != m_shape.numAlines ||
+      static_cast<int>(rfLog.n_rows) != m_shape.numSamples[ch]) {
+    return false;
+  }
+
+  const int n = m_shape.numAlines;
+  const auto nSamples = static_cast<size_t>(m_shape.numSamples[ch]);
+  auto *dst = frameData(ch, frame);
+  for (int j = 0; j < n; ++j) {
+    std::memcpy(dst + j * nSamples, rfLog.colptr(perm.src(j, n)), nSamples);
+  }
+  flags(ch)[frame] = 1;
+  return true;
+}
+
+bool VolumeStore::has(Channel ch, int frame) const {
+  std::shared_lock lock(m_mtx);
+  return m_file.isOpen() && frame >= 0 && frame < m_shape.numFrames &&
+         flags(ch)[frame] != 0;
+}
+
+cv::Mat VolumeStore::longitudinal(Channel ch, int aline) const {
+  std::shared_lock lock(m_mtx);
+  if (!m_file.isOpen()) {
+    return {};
+  }
+
+  const int n = m_shape.numAlines;
+  const int nSamples = m_shape.numSamples[ch];
+  aline = ((aline % n) + n) % n;
+  const int opposite = (aline + n / 2) % n;
+  const uint8_t *stored = flags(ch);
+
+  // One contiguous A-line pair per frame
+  cv::Mat out(m_shape.numFrames, 2 * nSamples, CV_8UC1);
+  cv::parallel_for_(cv::Range(0, m_shape.numFrames), [&](const cv::Range &r) {
+    for (int f = r.start; f < r.end; ++f) {
+      auto *dst = out.ptr<uint8_t>(f);
+      if (stored[f] == 0) {
+        std::fill_n(dst, 2 * nSamples, 0);
+        continue;
+      }
+      const auto *frame = frameData(ch, f);
+      const auto *a = frame + static_cast<size_t>(aline) * nSamples;
+      const auto *b = frame + static_cast<size_t>(opposite) * nSamples;
+      std::reverse_copy(b, b + nSamples, dst);
+      std::copy(a, a + nSamples, dst + nSamples);
+    }
+  });
+  return out;
+}
+
+bool VolumeStore::flush() {
+  std::unique_lock lock(m_mtx);
+  return m_file.flush();
+}
+
+// NOLINTEND(*-reinterpret-cast,*-pointer-arithmetic)
+
+} // namespace uspam::io
@@ -47,4 +47,167 @@ TEST(SaftApply, Correct) {
   // TODO write tests
 }
 
+// Scatter form of SAFT with linear interpolated delays, one sample at a time
+arma::mat saftReference(const beamformer::TimeDelay<double> &timeDelay,
+                        const arma::mat &rf) {
+  const int nScans = static_cast<int>(rf.n_cols);
+  const int nPts = static_cast<int>(rf.n_rows);
+  arma::mat rf_saft = rf;
+  for (int j = 0; j < nScans; ++j) {
+    for (int iz = timeDelay.zStart; iz < timeDelay.zEnd; ++iz) {
+      const int k = iz - timeDelay.zStart;
+      for (int dj = 0; dj < timeDelay.saftLines(k); ++dj) {
+        const double delayed = iz + timeDelay.timeDelay(k, dj);
+        const int i0 = static_cast<int>(std::floor(delayed));
+        if (i0 < 0 || i0 + 1 >= nPts) {
+          continue;
+        }
+        const double frac = delayed - i0;
+        const double val = (1 - frac) * rf(i0, j) + frac * rf(i0 + 1, j);
+        rf_saft(iz, (j - dj + nScans) % nScans) += val;
+        rf_saft(iz, (j + dj) % nScans) += val;
+      }
+    }
+  }
+  return rf_saft;
+}
+
+TEST(SaftApply, MatchesScatterReference) {
+  const auto saftParams = beamformer::SaftDelayParams<double>::make();
+  const auto timeDelay =
+      beamformer::computeSaftTimeDelay(saftParams, 769, 2450);
+
+  const arma::mat rf(2500, 100, arma::fill::randn);
+  const auto [rf_saft, rf_saft_cf] =
+      beamformer::apply_saft<double, double>(timeDelay, rf);
+
+  const auto expected = saftReference(timeDelay, rf);
+  ASSERT_TRUE(arma::approx_equal(rf_saft, expected, "absdiff", 1e-9));
+
+  // Outside the SAFT window the RF passes through
+  ASSERT_TRUE(arma::approx_equal(rf_saft_cf.head_rows(769),
+                                 rf.head_rows(769), "absdiff", 1e-12));
+}
+
+TEST(DAS, Weightings) {
+  const auto saftParams = beamformer::SaftDelayParams<double>::make();
+  const auto timeDelay =
+      beamformer::computeSaftTimeDelay(saftParams, 769, 2450);
+  const auto table = beamformer::makeSaftDelayTable(timeDelay, 2500);
+
+  const arma::mat rf(2500, 100, arma::fill::randn);
+
+  // Outside the SAFT window the RF passes through
+  arma::mat gcf;
+  beamformer::das(table, rf, gcf, beamformer::GeneralizedCF<double>(2));
+  ASSERT_TRUE(gcf.is_finite());
+  ASSERT_TRUE(arma::approx_equal(gcf.head_rows(769), rf.head_rows(769),
+                                 "absdiff", 1e-12));
+
+  arma::mat slsc;
+  beamformer::das<beamformer::SLSC<double>>(table, rf, slsc);
+  ASSERT_TRUE(slsc.is_finite());
+  ASSERT_TRUE(arma::approx_equal(slsc.head_rows(769), rf.head_rows(769),
+                                 "absdiff", 1e-12));
+}
+
+// Delay table without delays: every line of the aperture is read at the
+// output depth
+beamformer::SaftDelayTable<double> zeroDelayTable(int nPts, int nLines) {
+  beamformer::SaftDelayTable<double> table;
+  table.nPts = nPts;
+  table.zStart = 0;
+  table.zEnd = nPts - 1; // index + 1 stays inside the A-line
+  table.nLines = nLines;
+
+  const int nz = table.nz();
+  table.index.set_size(nz, nLines);
+  for (int dj = 0; dj < nLines; ++dj) {
+    table.index.col(dj) = arma::regspace<arma::Col<int32_t>>(0, nz - 1);
+  }
+  table.w0.ones(nz, nLines);
+  table.w1.zeros(nz, nLines);
+  table.count.set_size(nz);
+  table.count.fill(1 + 2 * nLines);
+  return table;
+}
+
+TEST(DAS, CoherenceWeightsOfKnownApertures) {
+  constexpr int nPts = 64;
+  constexpr int nLines = 3; // L = 5 line positions
+  constexpr int nScans = 10;
+  const auto table = zeroDelayTable(nPts, nLines);
+  const int nz = table.nz();
+
+  const arma::vec a =
+      2 + arma::sin(0.3 * arma::regspace<arma::vec>(0, nPts - 1));
+
+  // Coherent: every line is the same. The weights are 1 and the output is
+  // the mean of the aperture, the A-line itself.
+  {
+    arma::mat rf(nPts, nScans);
+    rf.each_col() = a;
+
+    arma::mat gcf;
+    beamformer::das(table, rf, gcf, beamformer::GeneralizedCF<double>(1));
+    EXPECT_TRUE(arma::approx_equal(gcf.head_rows(nz), rf.head_rows(nz),
+                                   "absdiff", 1e-12));
+
+    arma::mat slsc;
+    beamformer::das<beamformer::SLSC<double>>(table, rf, slsc);
+    EXPECT_TRUE(arma::approx_equal(slsc.head_rows(nz), rf.head_rows(nz),
+                                   "absdiff", 1e-12));
+  }
+
+  // Lines of alternating sign. The aperture of every A-line is
+  // +-[1, -1, 1, -1, 1] a at positions -2 .. 2.
+  {
+    arma::mat rf(nPts, nScans);
+    for (int j = 0; j < nScans; ++j) {
+      rf.col(j) = (j % 2 == 0 ? 1.0 : -1.0) * a;
+    }
+
+    // F(0) = 1, F(1) = 1 - 2 cos(2 pi / 5) + 2 cos(4 pi / 5), energy 5
+    const double f1 = 1 - 2 * std::cos(2 * std::numbers::pi / 5) +
+                      2 * std::cos(4 * std::numbers::pi / 5);
+    const double expectedGCF = (1 + 2 * f1 * f1) / (5.0 * 5.0);
+    // Output sum: the A-line, twice again (dj = 0), lines +-1 and +-2
+    constexpr double sumFct = 1 + 2 - 2 + 2;
+    constexpr double count = 1 + 2 * nLines;
+
+    arma::mat gcf;
+    beamformer::das(table, rf, gcf, beamformer::GeneralizedCF<double>(1));
+    EXPECT_TRUE(arma::approx_equal(gcf.head_rows(nz),
+                                   rf.head_rows(nz) *
+                                       (sumFct * expectedGCF / count),
+                                   "absdiff", 1e-12));
+
+    // Lags 1 .. 4 correlate -1, 1, -1, 1: the SLSC weight is 0
+    arma::mat slsc;
+    beamformer::das<beamformer::SLSC<double>>(table, rf, slsc);
+    EXPECT_LT(arma::abs(slsc.head_rows(nz)).max(), 1e-12);
+  }
+}
+
+TEST(DAS, InPlaceWindow) {
+  const auto saftParams = beamformer::SaftDelayParams<double>::make();
+  const auto timeDelay =
+      beamformer::computeSaftTimeDelay(saftParams, 769, 2450);
+  const auto table = beamformer::makeSaftDelayTable(timeDelay, 2500);
+
+  const arma::mat rf(2500, 100, arma::fill::randn);
+  arma::mat expected;
+  beamformer::das<beamformer::CoherenceFactor<double>>(table, rf, expected);
+
+  arma::mat inplace = rf;
+  const auto *mem = inplace.memptr();
+  beamformer::das<beamformer::CoherenceFactor<double>>(table, inplace);
+  ASSERT_EQ(inplace.memptr(), mem);
+  ASSERT_TRUE(arma::approx_equal(inplace, expected, "absdiff", 1e-12));
+
+  // Rows outside the window are untouched
+  ASSERT_TRUE(arma::approx_equal(inplace.tail_rows(50), rf.tail_rows(50),
+                                 "absdiff", 0.0));
+}
+
 // NOLINTEND(*-magic-numbers,*-constant-array-index,*-global-variables,*-goto)
\ No newline at end of file
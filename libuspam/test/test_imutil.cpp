@@ -2,6 +2,9 @@
 
 #include "uspam/imutil.hpp"
 #include <armadillo>
+#include <cmath>
+#include <cstdlib>
+#include <numbers>
 
 TEST(FlipLRInplace, Correct) {
   arma::mat inp(5, 5, arma::fill::randn);
@@ -9,3 +12,124 @@ TEST(FlipLRInplace, Correct) {
   uspam::imutil::fliplr_inplace(inp);
   ASSERT_TRUE(arma::approx_equal(inp, expected, "absdiff", 1e-9));
 }
+
+TEST(ColumnPermutation, MatchesFlipAndShift) {
+  const int n = 10;
+  arma::mat inp(3, n, arma::fill::randn);
+
+  for (const int rotate : {0, 3, -4, 12}) {
+    const uspam::imutil::ColumnPermutation perm{true, rotate};
+    arma::mat expected = inp;
+    uspam::imutil::fliplr_inplace(expected);
+    expected = arma::shift(expected, rotate, 1);
+
+    for (int j = 0; j < n; ++j) {
+      ASSERT_TRUE(arma::approx_equal(expected.col(j), inp.col(perm.src(j, n)),
+                                     "absdiff", 0.0));
+      ASSERT_EQ(perm.dst(perm.src(j, n), n), j);
+    }
+  }
+}
+
+TEST(MakeRadial, PermutationFoldedIntoLUT) {
+  arma::Mat<uint8_t> inp(200, 100);
+  inp.imbue([] { return static_cast<uint8_t>(std::rand() % 256); });
+
+  const uspam::imutil::ColumnPermutation perm{true, 7};
+  arma::Mat<uint8_t> moved = inp;
+  uspam::imutil::fliplr_inplace(moved);
+  moved = arma::shift(moved, perm.rotate, 1);
+
+  const cv::Mat expected = uspam::imutil::makeRadial(moved);
+  const cv::Mat actual = uspam::imutil::makeRadial(inp, 0, perm);
+  ASSERT_EQ(actual.rows, 100);
+  ASSERT_EQ(cv::norm(expected, actual, cv::NORM_INF), 0);
+}
+
+TEST(MakeRadial, MatchesWarpPolarChain) {
+  // Smooth image, so the two interpolations agree away from the circle edge
+  const int nSamples = 128;
+  const int nAlines = 64;
+  arma::Mat<float> inp(nSamples, nAlines);
+  const double twoPi = 2 * std::numbers::pi;
+  for (int j = 0; j < nAlines; ++j) {
+    for (int i = 0; i < nSamples; ++i) {
+      inp(i, j) = static_cast<float>(
+          100 + 80 * std::sin(twoPi * 2 * i / nSamples) *
+                    std::cos(twoPi * j / nAlines));
+    }
+  }
+
+  for (const int size : {64, 100}) {
+    // Reference: the previous resize -> warpPolar -> rotate -> resize
+    // NOLINTNEXTLINE(*-casting)
+    cv::Mat expected(nAlines, nSamples, CV_32F, (void *)inp.memptr());
+    const int r = std::min(nAlines, nSamples);
+    const cv::Size dsize{r * 2, r * 2};
+    cv::resize(expected, expected, dsize);
+    cv::warpPolar(expected, expected, dsize,
+                  {static_cast<float>(r), static_cast<float>(r)},
+                  static_cast<double>(r),
+                  cv::WARP_INVERSE_MAP | cv::WARP_FILL_OUTLIERS);
+    cv::rotate(expected, expected, cv::ROTATE_90_COUNTERCLOCKWISE);
+    cv::resize(expected, expected, {size, size});
+
+    const cv::Mat actual = uspam::imutil::makeRadial(inp, size);
+    ASSERT_EQ(actual.rows, size);
+    ASSERT_EQ(actual.cols, size);
+
+    // Skip the pixels at the edge of the circle, interpolated with the fill
+    cv::Mat mask(size, size, CV_8UC1, cv::Scalar(0));
+    cv::circle(mask, {size / 2, size / 2}, size / 2 - 2, cv::Scalar(255), -1);
+    cv::Mat diff;
+    cv::absdiff(expected, actual, diff);
+    double maxDiff{};
+    cv::minMaxLoc(diff, nullptr, &maxDiff, nullptr, nullptr, mask);
+    EXPECT_LT(maxDiff, 6.0) << "size " << size;
+    EXPECT_LT(cv::mean(diff, mask)[0], 1.0) << "size " << size;
+  }
+}
+
+TEST(OverlayCompositor, HardMaskMatchesColormapCopy) {
+  cv::Mat US(64, 80, CV_8UC1);
+  cv::Mat PA(64, 80, CV_8UC1);
+  cv::randu(US, 0, 256);
+  cv::randu(PA, 0, 256);
+  const uint8_t thresh = 40;
+
+  // Reference: the previous cvtColor + applyColorMap + threshold + copyTo
+  cv::Mat expected;
+  cv::cvtColor(US, expected, cv::COLOR_GRAY2BGR);
+  cv::Mat PAclr;
+  cv::applyColorMap(PA, PAclr, cv::COLORMAP_HOT);
+  cv::Mat mask;
+  cv::threshold(PA, mask, thresh, 1, cv::THRESH_BINARY);
+  PAclr.copyTo(expected, mask);
+
+  cv::Mat actual;
+  uspam::imutil::OverlayCompositor(thresh).compose(US, PA, actual);
+  ASSERT_EQ(actual.type(), CV_8UC3);
+  ASSERT_EQ(cv::norm(expected, actual, cv::NORM_INF), 0);
+}
+
+TEST(OverlayCompositor, RampBlends) {
+  const cv::Mat US(1, 4, CV_8UC1, cv::Scalar(200));
+  cv::Mat PA(1, 4, CV_8UC1);
+  PA.at<uint8_t>(0, 0) = 10;  // below threshold: US
+  PA.at<uint8_t>(0, 1) = 60;  // half way up the ramp
+  PA.at<uint8_t>(0, 2) = 110; // end of the ramp: PA color
+  PA.at<uint8_t>(0, 3) = 255;
+
+  cv::Mat colors;
+  cv::applyColorMap(PA, colors, cv::COLORMAP_HOT);
+
+  cv::Mat out;
+  uspam::imutil::OverlayCompositor(10, 100).compose(US, PA, out);
+  for (int k = 0; k < 3; ++k) {
+    EXPECT_EQ(out.at<cv::Vec3b>(0, 0)[k], 200);
+    EXPECT_NEAR(out.at<cv::Vec3b>(0, 1)[k],
+                (200 + colors.at<cv::Vec3b>(0, 1)[k]) / 2.0, 1.0);
+    EXPECT_EQ(out.at<cv::Vec3b>(0, 2)[k], colors.at<cv::Vec3b>(0, 2)[k]);
+    EXPECT_EQ(out.at<cv::Vec3b>(0, 3)[k], colors.at<cv::Vec3b>(0, 3)[k]);
+  }
+}
@@ -1,8 +1,19 @@
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <gtest/gtest.h>
 
 // Assuming swap_endian_inplace is defined in `swap_endian_inplace.h`
+#include "uspam/binfileIndex.hpp"
+#include "uspam/binfileSequence.hpp"
 #include "uspam/io.hpp"
+#include "uspam/videoSink.hpp"
+#include "uspam/volumeStore.hpp"
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
 
 // NOLINTBEGIN(*-using-namespace,*-magic-numbers,*-reinterpret-cast,*-pointer-arithmetic)
 
@@ -62,4 +73,335 @@ TEST(SwapEndianInPlaceTest, SwapDouble) {
   EXPECT_EQ(original, expected);
 }
 
+TEST(VideoSinkTest, WritesFramesInOrder) {
+  const std::filesystem::path fname = "tmp_video_sink.avi";
+  {
+    VideoSink sink(fname, {.fps = 10, .quality = 80});
+    ASSERT_TRUE(sink.isOpen());
+
+    // Push out of order. Frames should be reordered by index.
+    for (const int idx : {1, 0, 2, 4, 3}) {
+      cv::Mat frame(64, 64, CV_8UC3, cv::Scalar::all(idx * 40));
+      sink.push(idx, frame);
+    }
+    sink.close();
+
+    EXPECT_TRUE(sink.error().empty()) << sink.error();
+    EXPECT_EQ(sink.framesWritten(), 5);
+  }
+
+  {
+    cv::VideoCapture cap(fname.string());
+    ASSERT_TRUE(cap.isOpened());
+    EXPECT_EQ(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT)), 5);
+  }
+  std::filesystem::remove(fname);
+}
+
+TEST(ByteswapInplaceTest, MatchesScalarSwap) {
+  // Odd length so both the SIMD body and the scalar tail are exercised
+  constexpr size_t n = 1001;
+  std::vector<double> data(n);
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = static_cast<double>(i) * 1.5 - 7.25;
+  }
+  auto expected = data;
+  for (auto &v : expected) {
+    swap_endian_inplace(&v);
+  }
+  byteswap_inplace(reinterpret_cast<std::byte *>(data.data()), sizeof(double),
+                   n);
+  EXPECT_EQ(std::memcmp(data.data(), expected.data(), n * sizeof(double)), 0);
+
+  std::vector<uint16_t> data16(n);
+  for (size_t i = 0; i < n; ++i) {
+    data16[i] = static_cast<uint16_t>(i * 37);
+  }
+  auto expected16 = data16;
+  for (auto &v : expected16) {
+    swap_endian_inplace(&v);
+  }
+  byteswap_inplace(reinterpret_cast<std::byte *>(data16.data()),
+                   sizeof(uint16_t), n);
+  EXPECT_EQ(data16, expected16);
+}
+
+TEST(LoadBinTest, BigEndianDoubleWithShape) {
+  const std::filesystem::path fname = "tmp_load_bin.bin";
+  constexpr size_t rows = 257;
+  constexpr size_t cols = 3;
+
+  std::vector<double> values(rows * cols);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<double>(i) * 0.5 - 100;
+  }
+  {
+    auto swapped = values;
+    for (auto &v : swapped) {
+      swap_endian_inplace(&v);
+    }
+    std::ofstream file(fname, std::ios::binary);
+    const std::array<char, 4> header{};
+    file.write(header.data(), header.size());
+    file.write(reinterpret_cast<const char *>(swapped.data()),
+               static_cast<std::streamsize>(swapped.size() * sizeof(double)));
+  }
+
+  const auto matd = load_bin<double>(fname, rows, cols, DType::Float64,
+                                     std::endian::big, 4);
+  ASSERT_EQ(matd.n_rows, rows);
+  ASSERT_EQ(matd.n_cols, cols);
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(matd(i), values[i]);
+  }
+
+  // Converted straight to float in the same pass
+  const auto matf = load_bin<float>(fname, rows, cols, DType::Float64,
+                                    std::endian::big, 4);
+  ASSERT_EQ(matf.n_elem, values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_FLOAT_EQ(matf(i), static_cast<float>(values[i]));
+  }
+
+  // Shape larger than the file
+  EXPECT_TRUE(load_bin<double>(fname, rows + 1, cols, DType::Float64,
+                               std::endian::big, 4)
+                  .empty());
+
+  std::filesystem::remove(fname);
+}
+
+TEST(BinfileSequenceTest, ConcatenatesFiles) {
+  constexpr int alines = 2;
+  constexpr size_t frameSize = static_cast<size_t>(RF_ALINE_SIZE) * alines;
+  const std::vector<int> framesPerFile{2, 3, 1};
+
+  // Every sample of global frame i is set to i
+  std::vector<std::filesystem::path> files;
+  int globalIdx = 0;
+  for (size_t f = 0; f < framesPerFile.size(); ++f) {
+    files.emplace_back("tmp_sequence_" + std::to_string(f) + ".bin");
+    std::ofstream file(files.back(), std::ios::binary);
+    const char header = 0;
+    file.write(&header, 1);
+    for (int i = 0; i < framesPerFile[f]; ++i, ++globalIdx) {
+      const std::vector<uint16_t> frame(frameSize,
+                                        static_cast<uint16_t>(globalIdx));
+      file.write(reinterpret_cast<const char *>(frame.data()),
+                 static_cast<std::streamsize>(frameSize * sizeof(uint16_t)));
+    }
+  }
+
+  IOParams ioparams{};
+  ioparams.byte_offset = 1;
+
+  {
+    BinfileSequence<uint16_t> seq;
+    seq.setParams(ioparams, alines);
+    seq.open(files);
+
+    ASSERT_EQ(seq.size(), 6);
+    EXPECT_EQ(seq.numFiles(), 3);
+    EXPECT_EQ(seq.fileStart(1), 2);
+    EXPECT_EQ(seq.locate(4), (std::pair{1, 2}));
+    EXPECT_EQ(seq.locate(5), (std::pair{2, 0}));
+
+    // Sequential access (served by the prefetch across file boundaries)
+    arma::Mat<uint16_t> rf;
+    for (int i = 0; i < seq.size(); ++i) {
+      ASSERT_TRUE(seq.get(rf, i));
+      ASSERT_EQ(rf.n_rows, RF_ALINE_SIZE);
+      ASSERT_EQ(rf.n_cols, alines);
+      EXPECT_EQ(rf(0, 0), i);
+      EXPECT_EQ(rf(RF_ALINE_SIZE - 1, alines - 1), i);
+    }
+
+    // Random access and conversion to voltage
+    const auto rff = seq.get<float>(3);
+    EXPECT_FLOAT_EQ(rff(0, 0), 3.0F / (1 << 15) - 1);
+    ASSERT_TRUE(seq.get(rf, 0));
+    EXPECT_EQ(rf(0, 0), 0);
+  }
+
+  for (const auto &file : files) {
+    std::filesystem::remove(file);
+  }
+}
+
+TEST(BinfileIndexTest, BuildLoadAndFlag) {
+  const std::filesystem::path fname = "tmp_binfile_index.bin";
+  const auto idxname = BinfileIndex::indexPath(fname);
+  constexpr int alines = 4;
+  constexpr size_t frameSize = static_cast<size_t>(RF_ALINE_SIZE) * alines;
+
+  // Frame 0 and 1 have signal, frame 2 is zero filled and frame 3 is a copy
+  // of frame 2. A few trailing bytes simulate a truncated recording.
+  std::vector<uint16_t> data(frameSize * 4, 0);
+  for (size_t i = 0; i < frameSize; ++i) {
+    data[i] = static_cast<uint16_t>(32768 + (i % 100));
+    data[frameSize + i] = static_cast<uint16_t>(32768 - (i % 37));
+  }
+  {
+    std::ofstream file(fname, std::ios::binary);
+    const char header = 0;
+    file.write(&header, 1);
+    file.write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size() * sizeof(uint16_t)));
+    file.write("xyz", 3);
+  }
+
+  {
+    BinfileIndex index;
+    ASSERT_TRUE(index.open(fname, 1, alines));
+    ASSERT_EQ(index.size(), 4);
+    EXPECT_EQ(index.header().trailingBytes, 3);
+
+    EXPECT_EQ(index.entry(1).offset, 1 + frameSize * sizeof(uint16_t));
+    EXPECT_FLOAT_EQ(index.entry(0).min, 32768);
+    EXPECT_FLOAT_EQ(index.entry(0).max, 32768 + 99);
+    EXPECT_EQ(index.entry(0).flags, FRAME_OK);
+    EXPECT_EQ(index.entry(1).flags, FRAME_OK);
+    EXPECT_TRUE(index.entry(2).flags & FRAME_FLAT);
+    EXPECT_TRUE(index.entry(3).flags & FRAME_DUPLICATE);
+    EXPECT_EQ(index.flaggedFrames(), (std::vector<int>{2, 3}));
+
+    const auto frame1 = std::as_bytes(
+        std::span{data}.subspan(frameSize, frameSize));
+    EXPECT_TRUE(index.verifyFrame(1, frame1));
+    EXPECT_FALSE(index.verifyFrame(0, frame1));
+
+    const auto thumb = index.thumbnail(0);
+    EXPECT_EQ(thumb.size(),
+              BinfileIndex::THUMB_WIDTH * BinfileIndex::THUMB_HEIGHT);
+  }
+
+  // Reopening maps the existing index
+  {
+    BinfileIndex index;
+    EXPECT_TRUE(index.load(idxname, fname));
+    EXPECT_EQ(index.size(), 4);
+  }
+
+  // A changed binfile invalidates the index
+  {
+    std::ofstream file(fname, std::ios::binary | std::ios::app);
+    file.write("abc", 3);
+  }
+  {
+    BinfileIndex index;
+    EXPECT_FALSE(index.load(idxname, fname));
+    ASSERT_TRUE(index.open(fname, 1, alines));
+    EXPECT_EQ(index.header().trailingBytes, 6);
+  }
+
+  std::filesystem::remove(fname);
+  std::filesystem::remove(idxname);
+}
+
+TEST(BinfileIndexTest, FlatFrameIsNotSaturated) {
+  const std::filesystem::path fname = "tmp_binfile_index_rails.bin";
+  const auto idxname = BinfileIndex::indexPath(fname);
+  constexpr int alines = 4;
+  constexpr size_t frameSize = static_cast<size_t>(RF_ALINE_SIZE) * alines;
+
+  // Frame 0 is zero filled, frame 1 is all at the top rail and frame 2 has
+  // signal with every 10th sample railed
+  std::vector<uint16_t> data(frameSize * 3, 0);
+  for (size_t i = 0; i < frameSize; ++i) {
+    data[frameSize + i] = std::numeric_limits<uint16_t>::max();
+    data[2 * frameSize + i] =
+        i % 10 == 0 ? 0 : static_cast<uint16_t>(32768 + (i % 100));
+  }
+  {
+    std::ofstream file(fname, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size() * sizeof(uint16_t)));
+  }
+
+  {
+    BinfileIndex index;
+    ASSERT_TRUE(index.open(fname, 0, alines));
+    ASSERT_EQ(index.size(), 3);
+    EXPECT_EQ(index.entry(0).flags, FRAME_FLAT);
+    EXPECT_EQ(index.entry(1).flags, FRAME_FLAT);
+    EXPECT_EQ(index.entry(2).flags, FRAME_SATURATED);
+  }
+
+  std::filesystem::remove(fname);
+  std::filesystem::remove(idxname);
+}
+
+TEST(VolumeStoreTest, PutAndLongitudinalCut) {
+  const std::filesystem::path fname = "tmp_volume.bin";
+  std::filesystem::remove(fname);
+
+  VolumeStore::Shape shape{3, 8, {5, 6}};
+  const uspam::imutil::ColumnPermutation perm{true, 2};
+
+  // Sample i of A-line j is 10 * j + i
+  const auto makeFrame = [](int rows, int cols) {
+    arma::Mat<uint8_t> m(rows, cols);
+    for (int j = 0; j < cols; ++j) {
+      for (int i = 0; i < rows; ++i) {
+        m(i, j) = static_cast<uint8_t>(10 * j + i);
+      }
+    }
+    return m;
+  };
+
+  {
+    VolumeStore volume;
+    ASSERT_TRUE(volume.open(fname, shape));
+    EXPECT_TRUE(volume.put(VolumeStore::PA, 1, makeFrame(5, 8)));
+    EXPECT_TRUE(volume.put(VolumeStore::US, 2, makeFrame(6, 8), perm));
+
+    // Size mismatch and out of range frames are rejected
+    EXPECT_FALSE(volume.put(VolumeStore::US, 0, makeFrame(5, 8)));
+    EXPECT_FALSE(volume.put(VolumeStore::PA, 3, makeFrame(5, 8)));
+
+    EXPECT_TRUE(volume.has(VolumeStore::PA, 1));
+    EXPECT_FALSE(volume.has(VolumeStore::PA, 0));
+    EXPECT_FALSE(volume.has(VolumeStore::US, 1));
+
+    // Row 1: A-line 5 (opposite of 1) from the outside in, then A-line 1
+    const auto cut = volume.longitudinal(VolumeStore::PA, 1);
+    ASSERT_EQ(cut.rows, 3);
+    ASSERT_EQ(cut.cols, 10);
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_EQ(cut.at<uint8_t>(1, i), 50 + 4 - i);
+      EXPECT_EQ(cut.at<uint8_t>(1, 5 + i), 10 + i);
+    }
+    // Frames not stored are black
+    EXPECT_EQ(cv::countNonZero(cut.row(0)), 0);
+    EXPECT_EQ(cv::countNonZero(cut.row(2)), 0);
+
+    // A-lines are stored in display order
+    const auto cutUS = volume.longitudinal(VolumeStore::US, 0);
+    EXPECT_EQ(cutUS.at<uint8_t>(2, 6), 10 * perm.src(0, 8));
+
+    EXPECT_TRUE(volume.flush());
+  }
+
+  // Reopening discards the frames of the earlier session, even with the same
+  // shape
+  {
+    VolumeStore volume;
+    ASSERT_TRUE(volume.open(fname, shape));
+    EXPECT_FALSE(volume.has(VolumeStore::PA, 1));
+    EXPECT_FALSE(volume.has(VolumeStore::US, 2));
+    EXPECT_EQ(cv::countNonZero(volume.longitudinal(VolumeStore::PA, 1)), 0);
+  }
+
+  // So does a different shape
+  {
+    shape.numFrames = 4;
+    VolumeStore volume;
+    ASSERT_TRUE(volume.open(fname, shape));
+    EXPECT_FALSE(volume.has(VolumeStore::PA, 1));
+    EXPECT_EQ(volume.shape(), shape);
+  }
+
+  std::filesystem::remove(fname);
+}
+
 // NOLINTEND(*-using-namespace,*-magic-numbers,*-reinterpret-cast,*-pointer-arithmetic)
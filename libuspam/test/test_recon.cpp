@@ -1,9 +1,16 @@
 #include <armadillo>
+#include <cmath>
 #include <filesystem>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "uspam/autoGain.hpp"
+#include "uspam/enface.hpp"
+#include "uspam/fwhm.hpp"
+#include "uspam/recon.hpp"
 #include "uspam/reconParams.hpp"
+#include "uspam/speckle.hpp"
+#include "uspam/temporalFilter.hpp"
 
 namespace fs = std::filesystem;
 
@@ -120,3 +127,399 @@ TEST(ReconParams2Serialize, ToFile) {
   }
   fs::remove(jsonFile);
 }
+
+TEST(ReconParams2Serialize, OverlayGuarded) {
+  uspam::recon::ReconParams2 params{};
+  params.overlayThreshold = 30;
+  params.overlayRamp = 40;
+
+  // Mistyped values are ignored
+  rapidjson::Document doc;
+  doc.Parse(R"({"overlayThreshold": "high", "overlayRamp": 1.5})");
+  ASSERT_TRUE(params.deserialize(doc));
+  EXPECT_EQ(params.overlayThreshold, 30);
+  EXPECT_EQ(params.overlayRamp, 40);
+
+  // Out of range values are clamped to the PA levels
+  doc.Parse(R"({"overlayThreshold": 300, "overlayRamp": -5})");
+  ASSERT_TRUE(params.deserialize(doc));
+  EXPECT_EQ(params.overlayThreshold, 255);
+  EXPECT_EQ(params.overlayRamp, 0);
+}
+
+TEST(ReconParamsTGC, Table) {
+  uspam::recon::ReconParams params{};
+  ASSERT_FALSE(params.hasTGC());
+
+  params.tgcSlope_dBmm = 2.0F;
+  params.tgcDepth_mm = {1.0, 3.0};
+  params.tgcGain_dB = {0.0, 10.0};
+  ASSERT_TRUE(params.hasTGC());
+
+  // Rows at 0, 0.5, ..., 2.5 mm
+  const auto table = params.tgcTable(6, 0.5);
+  const std::vector<double> expected{0.0, 1.0, 2.0, 5.5, 9.0, 12.5};
+  ASSERT_EQ(table.size(), expected.size());
+  for (int i = 0; i < static_cast<int>(expected.size()); ++i) {
+    EXPECT_NEAR(table[i], expected[i], 1e-9);
+  }
+
+  // Round trip through JSON
+  rapidjson::Document doc;
+  doc.SetObject();
+  const auto obj = params.serialize(doc.GetAllocator());
+  const auto params2 = uspam::recon::ReconParams::deserialize(obj);
+  EXPECT_EQ(params2.tgcSlope_dBmm, params.tgcSlope_dBmm);
+  EXPECT_EQ(params2.tgcDepth_mm, params.tgcDepth_mm);
+  EXPECT_EQ(params2.tgcGain_dB, params.tgcGain_dB);
+}
+
+TEST(AutoGain, PercentilesFromHistogram) {
+  // Uniform background around 1 mV with a few bright samples at 1 V
+  arma::Mat<float> env(1000, 100);
+  env.randu();
+  env = env * 1e-3F + 0.5e-3F;
+  for (int j = 0; j < static_cast<int>(env.n_cols); ++j) {
+    for (int i = 0; i < 5; ++i) {
+      env(100 + i * 10, j) = 1.0F;
+    }
+  }
+
+  const auto hist = uspam::recon::EnvelopeHistogram::compute<float>(env);
+  ASSERT_EQ(hist.total, env.n_elem);
+
+  // Bins are 1/16 octave wide
+  EXPECT_NEAR(hist.percentile(50), 1e-3, 0.05e-3);
+  EXPECT_NEAR(hist.percentile(99.9), 1.0, 0.07);
+
+  uspam::recon::AutoGain autoGain(0.5F);
+  ASSERT_FALSE(autoGain.initialized());
+  auto gain = autoGain.update(hist, 50, 99.9);
+  ASSERT_TRUE(autoGain.initialized());
+  EXPECT_NEAR(gain.noiseFloor_mV, 1.0, 0.05);
+  EXPECT_NEAR(gain.dynamicRange_dB, 60.0, 1.0);
+
+  // Smoothing: halfway to a 10x higher background
+  env *= 10.0F;
+  gain = autoGain.update(uspam::recon::EnvelopeHistogram::compute<float>(env),
+                         50, 99.9);
+  EXPECT_NEAR(gain.noiseFloor_mV, std::sqrt(10.0), 0.2);
+}
+
+TEST(FWHM, SubSampleGaussian) {
+  // Gaussian pulses at fractional positions. FWHM = 2 sqrt(2 ln 2) sigma
+  constexpr double sigma = 5.0;
+  const double expected = 2 * std::sqrt(2 * std::log(2.0)) * sigma;
+
+  arma::Mat<double> env(400, 8);
+  for (int j = 0; j < static_cast<int>(env.n_cols); ++j) {
+    const double center = 150.0 + 20.3 * j;
+    for (int i = 0; i < static_cast<int>(env.n_rows); ++i) {
+      const double d = (i - center) / sigma;
+      env(i, j) = std::exp(-0.5 * d * d);
+    }
+  }
+  // An artifact at the start that must be skipped
+  env.head_rows(10).fill(2.0);
+
+  std::vector<uspam::metrics::AlineFWHM> res;
+  uspam::metrics::fwhm<double>(env, res, 20);
+  ASSERT_EQ(res.size(), env.n_cols);
+  for (int j = 0; j < static_cast<int>(env.n_cols); ++j) {
+    EXPECT_TRUE(res[j].bounded);
+    EXPECT_NEAR(res[j].peakPos, 150.0 + 20.3 * j, 0.05);
+    EXPECT_NEAR(res[j].width(), expected, 0.1);
+  }
+
+  uspam::metrics::FWHMTable table(3, static_cast<int>(env.n_cols));
+  ASSERT_FALSE(table.hasFrame(1));
+  table.setFrame(1, res, 0.1F);
+  ASSERT_TRUE(table.hasFrame(1));
+  EXPECT_NEAR(table.get(1, 0, uspam::metrics::FWHMTable::Width),
+              expected * 0.1, 0.01);
+}
+
+TEST(EnFace, ProjectionFusedInLogCompress) {
+  auto params = uspam::recon::ReconParams2::system2024v1().PA;
+  params.autoGain = false;
+  params.decimateEnvelope = false;
+  params.mmPerSample = 0.1F;
+  params.enfaceDepthBegin_mm = 1.0F;
+  params.enfaceDepthEnd_mm = 5.0F;
+  EXPECT_EQ(params.enfaceRows(0.1), (std::pair{10, 50}));
+
+  // A peak per A-line at a different depth. One peak is outside the window.
+  arma::Mat<float> env(100, 5);
+  env.fill(1e-3F);
+  for (int j = 0; j < static_cast<int>(env.n_cols); ++j) {
+    env(20 + 5 * j, j) = 0.5F;
+  }
+  env(5, 4) = 1.0F;
+
+  arma::Mat<uint8_t> rfLog;
+  uspam::metrics::FrameProjection proj;
+  uspam::recon::logCompressForDisplay<float>(
+      params, env, rfLog, static_cast<int>(env.n_rows), nullptr, &proj);
+  ASSERT_EQ(proj.alines.size(), env.n_cols);
+  EXPECT_FLOAT_EQ(proj.mmPerRow, 0.1F);
+
+  for (int j = 0; j < static_cast<int>(env.n_cols); ++j) {
+    const auto &a = proj.alines[j];
+    EXPECT_EQ(a.argmax, 20 + 5 * j);
+    EXPECT_EQ(a.max, rfLog(20 + 5 * j, j));
+
+    // Same as reducing the window of the finished column
+    const auto expected = uspam::metrics::project(
+        std::span<const uint8_t>{rfLog.colptr(j), rfLog.n_rows}, 10, 50);
+    EXPECT_EQ(a.max, expected.max);
+    EXPECT_FLOAT_EQ(a.mean, expected.mean);
+    double sum = 0;
+    for (int i = 10; i < 50; ++i) {
+      sum += rfLog(i, j);
+    }
+    EXPECT_NEAR(a.mean, sum / 40, 1e-4);
+  }
+
+  uspam::metrics::EnFaceMap map(3, static_cast<int>(env.n_cols));
+  ASSERT_FALSE(map.hasFrame(2));
+  map.setFrame(2, proj.alines, proj.mmPerRow);
+  ASSERT_TRUE(map.hasFrame(2));
+  EXPECT_FLOAT_EQ(map.get(2, 1, uspam::metrics::EnFaceMap::DepthOfMax),
+                  2.5F);
+  EXPECT_TRUE(std::isnan(map.get(0, 1, uspam::metrics::EnFaceMap::Max)));
+  EXPECT_FLOAT_EQ(map.max(uspam::metrics::EnFaceMap::DepthOfMax), 4.0F);
+  EXPECT_EQ(map.unit(), "mm");
+
+  // Growing the map for a later frame clears it, the same size keeps it
+  map.fit(3, static_cast<int>(env.n_cols), 1);
+  EXPECT_TRUE(map.hasFrame(2));
+  map.fit(3, static_cast<int>(env.n_cols), 4);
+  EXPECT_EQ(map.numFrames(), 5);
+  EXPECT_FALSE(map.hasFrame(2));
+  EXPECT_TRUE(std::isnan(map.max(uspam::metrics::EnFaceMap::DepthOfMax)));
+}
+
+TEST(TemporalFilter, AlignsFramesAndRestartsOnSeek) {
+  using uspam::imutil::ColumnPermutation;
+  using uspam::recon::TemporalFilterType;
+
+  // Frame whose display column j is base + 10 j
+  const auto makeFrame = [](int base, const ColumnPermutation &perm) {
+    arma::Mat<uint8_t> m(3, 4);
+    for (int j = 0; j < 4; ++j) {
+      m.col(perm.src(j, 4)).fill(static_cast<uint8_t>(base + 10 * j));
+    }
+    return m;
+  };
+  const auto display = [](const arma::Mat<uint8_t> &m,
+                          const ColumnPermutation &perm, int j) {
+    return static_cast<int>(m(1, perm.src(j, 4)));
+  };
+  const ColumnPermutation fwd{};
+  const ColumnPermutation flipped{true, 1};
+
+  uspam::recon::ReconParams params{};
+  params.temporalFilter = TemporalFilterType::Box;
+  params.temporalFrames = 2;
+  uspam::recon::TemporalFilter filter;
+
+  auto f0 = makeFrame(0, fwd);
+  filter.apply(params, 0, f0, fwd);
+  auto f1 = makeFrame(20, flipped);
+  filter.apply(params, 1, f1, flipped);
+  for (int j = 0; j < 4; ++j) {
+    EXPECT_EQ(display(f0, fwd, j), 10 * j);
+    EXPECT_EQ(display(f1, flipped, j), 10 * j + 10); // Same angles averaged
+  }
+
+  // The same frame again replaces its previous version
+  auto f1b = makeFrame(40, flipped);
+  filter.apply(params, 1, f1b, flipped);
+  EXPECT_EQ(filter.size(), 2);
+  EXPECT_EQ(display(f1b, flipped, 0), 20);
+
+  // Filtering on a copy leaves the history of the original as is
+  {
+    auto copy = filter;
+    auto f2 = makeFrame(200, fwd);
+    copy.apply(params, 2, f2, fwd);
+    EXPECT_EQ(display(f2, fwd, 0), 120); // (40 + 200) / 2
+  }
+  // Frame 1 again: averaged with frame 0, which the copy didn't overwrite
+  auto f1c = makeFrame(40, flipped);
+  filter.apply(params, 1, f1c, flipped);
+  EXPECT_EQ(display(f1c, flipped, 0), 20); // (0 + 40) / 2
+
+  // A seek restarts the history
+  auto f5 = makeFrame(100, fwd);
+  filter.apply(params, 5, f5, fwd);
+  EXPECT_EQ(filter.size(), 1);
+  EXPECT_EQ(display(f5, fwd, 2), 120);
+
+  // Median of 3 removes a one frame outlier
+  params.temporalFilter = TemporalFilterType::Median3;
+  auto g0 = makeFrame(10, fwd);
+  auto g1 = makeFrame(200, flipped);
+  auto g2 = makeFrame(12, fwd);
+  filter.apply(params, 0, g0, fwd);
+  filter.apply(params, 1, g1, flipped);
+  filter.apply(params, 2, g2, fwd);
+  for (int j = 0; j < 4; ++j) {
+    EXPECT_EQ(display(g2, fwd, j), 12 + 10 * j);
+  }
+
+  // Exponential persistence
+  params.temporalFilter = TemporalFilterType::Exponential;
+  params.temporalPersistence = 0.5F;
+  auto e0 = makeFrame(0, fwd);
+  auto e1 = makeFrame(40, flipped);
+  filter.apply(params, 0, e0, fwd);
+  filter.apply(params, 1, e1, flipped);
+  EXPECT_EQ(display(e1, flipped, 1), 30);
+
+  // The state of a copy doesn't leak into the original
+  {
+    auto copy = filter;
+    auto e2 = makeFrame(200, fwd);
+    copy.apply(params, 2, e2, fwd);
+  }
+  auto e2 = makeFrame(30, fwd);
+  filter.apply(params, 2, e2, fwd);
+  EXPECT_EQ(display(e2, fwd, 1), 35); // (30 + 40) / 2
+
+  // None leaves the frame as is and drops the history
+  params.temporalFilter = TemporalFilterType::None;
+  auto n = makeFrame(7, fwd);
+  filter.apply(params, 2, n, fwd);
+  EXPECT_EQ(display(n, fwd, 0), 7);
+  EXPECT_EQ(filter.size(), 0);
+}
+
+TEST(Speckle, NativeGridWrapsAroundInAngle) {
+  using uspam::recon::SpeckleFilterType;
+
+  // More A-lines than one tile. Samples x A-lines, 50 except A-lines 1 and
+  // 129, the neighbours of A-line 0 across the wrap.
+  constexpr int nAlines = 130;
+  const auto makeFrame = [] {
+    arma::Mat<uint8_t> m(20, nAlines);
+    m.fill(50);
+    m.col(1).fill(200);
+    m.col(nAlines - 1).fill(200);
+    m(10, 64) = 255; // Impulse on a tile boundary
+    return m;
+  };
+
+  uspam::recon::ReconParams params{};
+  params.speckleRadius = 1;
+
+  // Off: untouched
+  auto off = makeFrame();
+  uspam::recon::reduceSpeckle(params, off);
+  EXPECT_EQ(off(10, 64), 255);
+
+  params.speckleFilter = SpeckleFilterType::Median;
+  auto med = makeFrame();
+  uspam::recon::reduceSpeckle(params, med);
+  EXPECT_EQ(med(10, 64), 50);  // Impulse removed
+  EXPECT_EQ(med(0, 0), 200);   // Filled from both sides of the wrap
+  EXPECT_EQ(med(19, 0), 200);  // Edge samples repeated in depth
+  EXPECT_EQ(med(10, 2), 50);   // Thin lines don't spread
+  EXPECT_EQ(med(10, 1), 50);
+
+  // Edge preserving: a step in depth stays sharp
+  params.speckleFilter = SpeckleFilterType::Bilateral;
+  params.speckleStrength = 10.0F;
+  arma::Mat<uint8_t> step(20, nAlines);
+  step.head_rows(10).fill(50);
+  step.tail_rows(10).fill(200);
+  uspam::recon::reduceSpeckle(params, step);
+  EXPECT_EQ(step(9, 0), 50);
+  EXPECT_EQ(step(10, nAlines - 1), 200);
+
+  // Diffusion spreads the impulse and keeps the mean
+  params.speckleFilter = SpeckleFilterType::Diffusion;
+  params.speckleStrength = 50.0F;
+  auto dif = makeFrame();
+  const double meanBefore = arma::mean(arma::vectorise(
+      arma::conv_to<arma::Mat<double>>::from(dif)));
+  uspam::recon::reduceSpeckle(params, dif);
+  EXPECT_LT(dif(10, 64), 255);
+  EXPECT_GT(dif(10, 63), 50);
+  EXPECT_GT(dif(10, 0), 50); // Across the wrap
+  const double meanAfter = arma::mean(arma::vectorise(
+      arma::conv_to<arma::Mat<double>>::from(dif)));
+  EXPECT_NEAR(meanAfter, meanBefore, 1.0);
+}
+
+TEST(ReconPreview, DecimatedPeakEnvelope) {
+  auto params = uspam::recon::ReconParams2::system2024v1().US;
+  params.truncate = 4;
+  params.autoGain = false;
+  params.tgcSlope_dBmm = 0;
+  params.tgcDepth_mm.clear();
+  params.tgcGain_dB.clear();
+  ASSERT_FALSE(params.hasTGC());
+
+  arma::Mat<float> rf(40, 6, arma::fill::zeros);
+  rf.head_rows(params.truncate).fill(100.0F); // Artifact, ignored
+  for (int j = 0; j < static_cast<int>(rf.n_cols); ++j) {
+    rf(13, j) = -0.01F * (j + 1); // Negative peak in block 1
+    rf(12, j) = 0.001F;
+  }
+
+  arma::Mat<uint8_t> rfLog;
+  uspam::recon::reconPreview<float>(params, rf, rfLog, 2, 8);
+  ASSERT_EQ(rfLog.n_rows, 5);
+  ASSERT_EQ(rfLog.n_cols, 3);
+
+  const auto noiseFloor = params.noiseFloor_mV / 1000.0F;
+  for (int j = 0; j < 3; ++j) {
+    EXPECT_EQ(rfLog(0, j), 0);
+    const auto expected = static_cast<uint8_t>(
+        uspam::recon::logCompress(0.01F * (2 * j + 1), noiseFloor,
+                                  params.desiredDynamicRange) *
+        255.0F);
+    EXPECT_EQ(rfLog(1, j), expected);
+    EXPECT_EQ(rfLog(4, j), 0);
+  }
+}
+
+TEST(ReconOneAline, MatchesFullFrame) {
+  const arma::Mat<float> rf(2500, 100, arma::fill::randn);
+
+  // The default truncation, and one deep inside the SAFT window where
+  // truncating before beamforming would give a different result
+  const auto defaults = uspam::recon::ReconParams2::system2024v1().US;
+  for (const int truncate : {defaults.truncate, 1000}) {
+    for (const auto method : {uspam::recon::EnvelopeMethod::Hilbert,
+                              uspam::recon::EnvelopeMethod::IQ}) {
+      auto params = defaults;
+      params.beamformerType = uspam::beamformer::BeamformerType::SAFT_CF;
+      params.envelopeMethod = method;
+      params.truncate = truncate;
+
+      // Full frame order of the GUI: beamform, then truncate and envelope
+      arma::Mat<float> fullBeamformed;
+      arma::Mat<float> fullEnv;
+      uspam::beamformer::beamform(rf, fullBeamformed, params.beamformerType);
+      fullBeamformed.head_rows(params.truncate - 1).zeros();
+      uspam::recon::envelope<float>(params, fullBeamformed, fullEnv);
+
+      // First and middle A-line (the neighbourhood of 0 wraps around)
+      for (const int j : {0, 50}) {
+        arma::Mat<float> rfBeamformed;
+        arma::Mat<float> rfEnv;
+        uspam::recon::reconOneAline<float>(params, rf, j, rfBeamformed,
+                                           rfEnv);
+        ASSERT_EQ(rfBeamformed.n_cols, 1);
+        ASSERT_EQ(rfEnv.n_rows, fullEnv.n_rows);
+
+        const float scale = arma::abs(fullBeamformed.col(j)).max();
+        EXPECT_LT(arma::abs(rfBeamformed - fullBeamformed.col(j)).max(),
+                  1e-5F * scale);
+        EXPECT_LT(arma::abs(rfEnv - fullEnv.col(j)).max(), 1e-4F * scale);
+      }
+    }
+  }
+}
@@ -1,8 +1,15 @@
 #include <array>
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <tuple>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "uspam/fir.hpp"
 #include "uspam/signal.hpp"
+#include "uspam/timeit.hpp"
 
 // NOLINTBEGIN(*-numbers,*-constant-array-index,*-global-variables,*-goto)
 
@@ -425,4 +432,141 @@ TEST(HilbertTest, CorrectOdd1) {
   }
 }
 
+TEST(DecimateTest, PassesBasebandAndRejectsAliases) {
+  constexpr int factor = 5;
+  constexpr int n = 1000;
+  constexpr int nOut = (n + factor - 1) / factor;
+  const arma::vec kernel = uspam::signal::decimation_kernel(factor);
+  ASSERT_EQ(static_cast<int>(kernel.size()), 8 * factor + 1);
+  EXPECT_NEAR(arma::accu(kernel), 1.0, 1e-12);
+
+  const arma::vec t = arma::regspace<arma::vec>(0, n - 1);
+  arma::vec y(nOut, arma::fill::none);
+
+  // Constant input keeps its amplitude away from the edges
+  {
+    const arma::vec x(n, arma::fill::ones);
+    uspam::signal::decimate<double>(x, kernel, factor, y);
+    for (int i = 10; i < nOut - 10; ++i) {
+      EXPECT_NEAR(y[i], 1.0, 1e-9);
+    }
+  }
+
+  // Well inside the decimated passband
+  {
+    const arma::vec x = arma::sin(std::numbers::pi * 0.05 * t);
+    uspam::signal::decimate<double>(x, kernel, factor, y);
+    const double peak = arma::abs(y.subvec(10, nOut - 11)).max();
+    EXPECT_NEAR(peak, 1.0, 0.02);
+  }
+
+  // Above the decimated Nyquist, would alias without the low-pass. The
+  // frequency is chosen so the output samples don't fall on zeros of the
+  // sine: plain downsampling keeps the full amplitude.
+  {
+    const arma::vec x = arma::sin(std::numbers::pi * 0.63 * t);
+    const arma::vec naive =
+        x.elem(arma::regspace<arma::uvec>(0, factor, n - 1));
+    EXPECT_GT(arma::abs(naive.subvec(10, nOut - 11)).max(), 0.9);
+
+    uspam::signal::decimate<double>(x, kernel, factor, y);
+    const double peak = arma::abs(y.subvec(10, nOut - 11)).max();
+    EXPECT_LT(peak, 2e-3); // Stopband of the Hamming windowed kernel
+  }
+
+  EXPECT_THROW(std::ignore = uspam::signal::decimation_kernel(1),
+               std::invalid_argument);
+}
+
+TEST(FirTest, DirectMatchesFFT) {
+  using uspam::fir::Method;
+
+  // Lengths that aren't multiples of the tile size / column group
+  for (const int n : {7, 95, 1003}) {
+    const arma::mat x(n, 6, arma::fill::randn);
+    const arma::vec kernel(95, arma::fill::randn);
+
+    arma::mat yDirect;
+    arma::mat yFFT;
+    uspam::fir::convolve<double>(x, kernel, yDirect, Method::Direct);
+    uspam::fir::convolve<double>(x, kernel, yFFT, Method::FFT);
+
+    ASSERT_EQ(yDirect.n_rows, x.n_rows);
+    ASSERT_EQ(yDirect.n_cols, x.n_cols);
+    EXPECT_LT(arma::abs(yDirect - yFFT).max(), 1e-9);
+  }
+
+  // Both engines are valid choices of the calibration
+  const auto entry = uspam::fir::Dispatcher::calibrate<float>(1000, 95, 4);
+  EXPECT_TRUE(entry.method == Method::Direct || entry.method == Method::FFT);
+  EXPECT_GT(entry.direct_ms, 0.0F);
+  EXPECT_GT(entry.fft_ms, 0.0F);
+
+  // Shapes that weren't tuned use the heuristic without calibrating
+  auto &dispatcher = uspam::fir::Dispatcher::get();
+  EXPECT_EQ(dispatcher.select<float>(1234, 95, 3),
+            uspam::fir::Dispatcher::heuristic(1234, 95));
+}
+
+TEST(IQDemodTest, MatchesHilbertEnvelope) {
+  constexpr int n = 5300;
+  constexpr double f0 = 0.2;
+  constexpr double halfBandwidth = 0.1;
+
+  // Two Gaussian tone bursts at f0
+  arma::vec x(n);
+  for (int i = 0; i < n; ++i) {
+    const double a = std::exp(-0.5 * std::pow((i - 2000) / 60.0, 2)) +
+                     0.5 * std::exp(-0.5 * std::pow((i - 3500) / 100.0, 2));
+    x(i) = a * std::cos(std::numbers::pi * f0 * i + 0.3);
+  }
+
+  arma::vec envHilbert(n, arma::fill::none);
+  uspam::signal::hilbert_abs_r2c<double>(x, envHilbert);
+
+  for (const int factor : {1, 5, 8}) {
+    const uspam::signal::IQDemodulator<double> demod(f0, halfBandwidth,
+                                                     factor);
+    arma::vec env(demod.outputSize(n), arma::fill::none);
+    demod.envelope(x, env);
+    ASSERT_EQ(static_cast<int>(env.size()), (n + factor - 1) / factor);
+
+    for (int m = 0; m < static_cast<int>(env.size()); ++m) {
+      EXPECT_NEAR(env(m), envHilbert(m * factor), 2e-3) << "factor " << factor;
+    }
+
+    // Baseband phase is the phase of the carrier
+    std::vector<std::complex<double>> iq(env.size());
+    demod.demodulate(x, iq);
+    EXPECT_NEAR(std::abs(iq[2000 / factor]), env(2000 / factor), 1e-9);
+    EXPECT_NEAR(std::arg(iq[2000 / factor]), 0.3, 1e-3);
+  }
+}
+
+TEST(IQDemodTest, Bench) {
+  constexpr int n = 5300;
+  constexpr int nAlines = 1000;
+  constexpr int nRuns = 5;
+  const arma::fmat rf(n, nAlines, arma::fill::randn);
+  arma::fmat env(n, nAlines, arma::fill::none);
+
+  uspam::bench("hilbert_abs_r2c", nRuns, [&] {
+    for (int j = 0; j < nAlines; ++j) {
+      const auto src = rf.unsafe_col(j);
+      auto dst = env.unsafe_col(j);
+      uspam::signal::hilbert_abs_r2c<float>(src, dst);
+    }
+  });
+
+  const uspam::signal::IQDemodulator<float> demod(0.2, 0.1, 5);
+  arma::fmat envIQ(demod.outputSize(n), nAlines, arma::fill::none);
+  uspam::bench("IQDemodulator::envelope (factor 5)", nRuns, [&] {
+    for (int j = 0; j < nAlines; ++j) {
+      const auto src = rf.unsafe_col(j);
+      auto dst = envIQ.unsafe_col(j);
+      demod.envelope(src, dst);
+    }
+  });
+}
+
 // NOLINTEND(*-numbers,*-constant-array-index,*-global-variables,*-goto)